@@ -0,0 +1,320 @@
+#include "arrow_dumper.h"
+#include "async_writer.h"
+#include "cmd_opt.h"
+#include "misc.h"
+#include "utf.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+
+
+constexpr uint32_t ArrowDumper::kBatchSize;
+constexpr int64_t ArrowDumper::kNameDictionary;
+constexpr int64_t ArrowDumper::kOpcodeDictionary;
+constexpr uint32_t ArrowDumper::kNoId;
+
+
+ArrowDumper::ArrowDumper(const DexFile& dex_file, char opt_granu,
+                         const DumpFilter& filter)
+  : dex_file_(dex_file),
+    opt_granu_(opt_granu),
+    filter_(filter),
+    string_ref_ids_(dex_file.NumStringIds(), kNoId),
+    type_ref_ids_(dex_file.NumTypeIds(), kNoId),
+    field_ref_ids_(dex_file.NumFieldIds(), kNoId),
+    method_ref_ids_(dex_file.NumMethodIds(), kNoId)
+{}
+
+bool ArrowDumper::Dump(const char* prefix, bool direct_io)
+{
+    typedef ArrowStreamWriter::Field Field;
+    const int64_t kPlain = ArrowStreamWriter::kNoDictionary;
+
+    std::vector<Field> class_fields = {
+        {"class_def_idx", 32, false, false, kPlain, false},
+        {"name", 32, true, false, kNameDictionary, false},
+        {"superclass", 32, true, true, kNameDictionary, false},
+        {"access_flags", 32, false, false, kPlain, false},
+        {"method_count", 32, false, false, kPlain, false},
+    };
+    std::vector<Field> method_fields = {
+        {"class_def_idx", 32, false, false, kPlain, false},
+        {"class_method_idx", 32, false, false, kPlain, false},
+        {"dex_method_idx", 32, false, false, kPlain, false},
+        {"name", 32, true, false, kNameDictionary, false},
+        {"access_flags", 32, false, false, kPlain, false},
+        {"code_off", 32, false, false, kPlain, false},
+        {"registers_size", 16, false, false, kPlain, false},
+        {"ins_size", 16, false, false, kPlain, false},
+        {"outs_size", 16, false, false, kPlain, false},
+        {"tries_size", 16, false, false, kPlain, false},
+        {"insns_size", 32, false, false, kPlain, false},
+    };
+    std::vector<Field> instruction_fields = {
+        {"class_def_idx", 32, false, false, kPlain, false},
+        {"dex_method_idx", 32, false, false, kPlain, false},
+        {"dex_pc", 32, false, false, kPlain, false},
+        {"opcode", 8, false, false, kOpcodeDictionary, false},
+        {"vA", 32, true, true, kPlain, false},
+        {"vB", 64, true, true, kPlain, false},
+        {"vC", 32, true, true, kPlain, false},
+        {"args", 32, true, true, kPlain, true},
+        {"ref_idx", 32, false, true, kPlain, false},
+        {"ref", 32, true, true, kNameDictionary, false},
+    };
+
+    if (!OpenTable(&classes_, prefix, ".classes.arrows", direct_io, class_fields))
+        return false;
+    if (opt_granu_ != kGranuCodeClass &&
+        !OpenTable(&methods_, prefix, ".methods.arrows", direct_io, method_fields))
+        return false;
+    if (opt_granu_ == kGranuCodeInstruction) {
+        if (!OpenTable(&instructions_, prefix, ".instructions.arrows", direct_io,
+                       instruction_fields))
+            return false;
+        std::vector<std::string> opcodes;
+        for (uint32_t i = 0 ; i < kNumPackedOpcodes ; ++i)
+            opcodes.push_back(Instruction::Name(static_cast<Instruction::Code>(i)));
+        if (!instructions_.writer_->WriteDictionary(kOpcodeDictionary, opcodes, 0,
+                                                     opcodes.size(), false))
+            return false;
+    }
+
+    uint32_t num_class_def = dex_file_.NumClassDefs();
+    for (uint32_t class_def_idx = 0 ; class_def_idx < num_class_def ; ++class_def_idx) {
+        if (filter_.KeepClass(dex_file_, class_def_idx) && !DumpClass(class_def_idx))
+            return false;
+    }
+
+    bool success = CloseTable(&classes_);
+    success = CloseTable(&methods_) && success;
+    success = CloseTable(&instructions_) && success;
+    return success;
+}
+
+bool ArrowDumper::OpenTable(Table* table, const char* prefix, const char* suffix,
+                            bool direct_io, const std::vector<ArrowStreamWriter::Field>& fields)
+{
+    std::string path(prefix);
+    path += suffix;
+    table->sink_.reset(AsyncWriter::Open(path.c_str(), direct_io));
+    if (table->sink_.get() == nullptr)
+        return false;
+    table->writer_.reset(new ArrowStreamWriter(table->sink_.get()));
+    for (const ArrowStreamWriter::Field& field : fields) {
+        table->columns_.emplace_back(new ArrowStreamWriter::Column(field.bit_width_ / 8,
+                                                                   field.is_list_));
+        table->column_ptrs_.push_back(table->columns_.back().get());
+    }
+
+    // The empty name dictionary is sent upfront so that all the later batches
+    // of names can be deltas.
+    table->names_sent_ = 0;
+    return table->writer_->WriteSchema(fields) &&
+           table->writer_->WriteDictionary(kNameDictionary, table->names_, 0, 0, false);
+}
+
+bool ArrowDumper::FlushTable(Table* table, bool force)
+{
+    uint64_t length = (*table)[0].Length();
+    if (length == 0 || (length < kBatchSize && !force))
+        return true;
+
+    if (table->names_sent_ < table->names_.size()) {
+        if (!table->writer_->WriteDictionary(kNameDictionary, table->names_,
+                                             table->names_sent_, table->names_.size(), true))
+            return false;
+        table->names_sent_ = table->names_.size();
+    }
+    if (!table->writer_->WriteRecordBatch(table->column_ptrs_))
+        return false;
+    for (ArrowStreamWriter::Column* column : table->column_ptrs_)
+        column->Clear();
+    return true;
+}
+
+bool ArrowDumper::CloseTable(Table* table)
+{
+    if (table->writer_.get() == nullptr)
+        return true;
+    bool success = FlushTable(table, true) && table->writer_->WriteEnd();
+    return table->sink_->Close() && success;
+}
+
+bool ArrowDumper::DumpClass(uint32_t class_def_idx)
+{
+    const DexFile::ClassDef& class_def = dex_file_.GetClassDef(class_def_idx);
+    uint32_t method_count = 0;
+
+    const byte* class_data = dex_file_.GetClassData(class_def);
+    if (class_data != nullptr) {
+        ClassDataItemIterator it(dex_file_, class_data);
+        SkipAllFields(it);
+        while (it.HasNext()) {
+            if (opt_granu_ != kGranuCodeClass &&
+                filter_.KeepMethod(dex_file_, it.GetMemberIndex()) &&
+                !DumpMethod(class_def_idx, method_count, it))
+                return false;
+            it.Next();
+            ++method_count;
+        }
+    }
+
+    classes_[kClassDefIdx].Append<uint32_t>(class_def_idx);
+    classes_[kClassName].Append<int32_t>(TableName(&classes_, InternType(class_def.class_idx_)));
+    if (class_def.superclass_idx_ == DexFile::kDexNoIndex16)
+        classes_[kClassSuperclass].AppendNull();
+    else
+        classes_[kClassSuperclass].Append<int32_t>(
+            TableName(&classes_, InternType(class_def.superclass_idx_)));
+    classes_[kClassAccessFlags].Append<uint32_t>(class_def.access_flags_);
+    classes_[kClassMethodCount].Append<uint32_t>(method_count);
+    return FlushTable(&classes_, false);
+}
+
+bool ArrowDumper::DumpMethod(uint32_t class_def_idx, uint32_t class_method_idx,
+                             const ClassDataItemIterator& it)
+{
+    uint32_t dex_method_idx = it.GetMemberIndex();
+    const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+    methods_[kMethodClassDefIdx].Append<uint32_t>(class_def_idx);
+    methods_[kMethodClassMethodIdx].Append<uint32_t>(class_method_idx);
+    methods_[kMethodDexMethodIdx].Append<uint32_t>(dex_method_idx);
+    methods_[kMethodName].Append<int32_t>(TableName(&methods_, InternMethod(dex_method_idx)));
+    methods_[kMethodAccessFlags].Append<uint32_t>(it.GetRawMemberAccessFlags());
+    methods_[kMethodCodeOff].Append<uint32_t>(it.GetMethodCodeItemOffset());
+    methods_[kMethodRegistersSize].Append<uint16_t>((code_item)? code_item->registers_size_ : 0);
+    methods_[kMethodInsSize].Append<uint16_t>((code_item)? code_item->ins_size_ : 0);
+    methods_[kMethodOutsSize].Append<uint16_t>((code_item)? code_item->outs_size_ : 0);
+    methods_[kMethodTriesSize].Append<uint16_t>((code_item)? code_item->tries_size_ : 0);
+    methods_[kMethodInsnsSize].Append<uint32_t>(
+        (code_item)? code_item->insns_size_in_code_units_ : 0);
+
+    if (opt_granu_ == kGranuCodeInstruction && code_item != nullptr) {
+        uint32_t dex_pc = 0;
+        while (dex_pc < code_item->insns_size_in_code_units_) {
+            const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+            if (!DumpInstruction(class_def_idx, dex_method_idx, dex_pc, inst))
+                return false;
+            dex_pc += inst->SizeInCodeUnits();
+        }
+    }
+    return FlushTable(&methods_, false);
+}
+
+bool ArrowDumper::DumpInstruction(uint32_t class_def_idx, uint32_t dex_method_idx,
+                                  uint32_t dex_pc, const Instruction* inst)
+{
+    Table& table = instructions_;
+    table[kInsnClassDefIdx].Append<uint32_t>(class_def_idx);
+    table[kInsnDexMethodIdx].Append<uint32_t>(dex_method_idx);
+    table[kInsnDexPc].Append<uint32_t>(dex_pc);
+    table[kInsnOpcode].Append<uint8_t>(inst->Opcode());
+    if (inst->HasVRegA())
+        table[kInsnVRegA].Append<int32_t>(inst->VRegA());
+    else
+        table[kInsnVRegA].AppendNull();
+    if (inst->HasWideVRegB())
+        table[kInsnVRegB].Append<int64_t>(inst->WideVRegB());
+    else if (inst->HasVRegB())
+        table[kInsnVRegB].Append<int64_t>(inst->VRegB());
+    else
+        table[kInsnVRegB].AppendNull();
+    if (inst->HasVRegC())
+        table[kInsnVRegC].Append<int32_t>(inst->VRegC());
+    else
+        table[kInsnVRegC].AppendNull();
+    if (inst->HasVarArgs()) {
+        uint32_t args[Instruction::kMaxVarArgRegs];
+        inst->GetVarArgs(args);
+        table[kInsnArgs].AppendList(args, inst->VRegA_35c());
+    } else {
+        table[kInsnArgs].AppendNull();
+    }
+
+    uint32_t ref = InternReference(inst);
+    if (ref == kNoId) {
+        table[kInsnRefIdx].AppendNull();
+        table[kInsnRef].AppendNull();
+    } else {
+        table[kInsnRefIdx].Append<uint32_t>(inst->GetIndexOperand());
+        table[kInsnRef].Append<int32_t>(TableName(&table, ref));
+    }
+    return FlushTable(&table, false);
+}
+
+uint32_t ArrowDumper::Intern(const std::string& str)
+{
+    // The Arrow utf8 type rejects the NULs and the surrogates of modified
+    // UTF-8.
+    utf8_.clear();
+    ConvertModifiedUtf8ToUtf8(&utf8_, str.data(), str.size());
+    auto iter = name_ids_.find(utf8_);
+    if (iter != name_ids_.end())
+        return iter->second;
+    uint32_t id = names_.size();
+    names_.push_back(utf8_);
+    name_ids_.emplace(utf8_, id);
+    return id;
+}
+
+uint32_t ArrowDumper::TableName(Table* table, uint32_t name_id)
+{
+    if (name_id >= table->name_ids_.size())
+        table->name_ids_.resize(names_.size(), kNoId);
+    uint32_t& id = table->name_ids_[name_id];
+    if (id == kNoId) {
+        id = table->names_.size();
+        table->names_.push_back(names_[name_id]);
+    }
+    return id;
+}
+
+uint32_t ArrowDumper::InternReference(const Instruction* inst)
+{
+    // The quickened instructions carry offsets rather than dex indices.
+    if (inst->GetVerifyIsRuntimeOnly())
+        return kNoId;
+    uint32_t idx = inst->GetIndexOperand();
+    switch (Instruction::IndexTypeOf(inst->Opcode())) {
+      case Instruction::kStringRef:
+        if (idx >= string_ref_ids_.size())
+            return kNoId;
+        if (string_ref_ids_[idx] == kNoId)
+            string_ref_ids_[idx] = Intern(dex_file_.StringDataByIdx(idx));
+        return string_ref_ids_[idx];
+      case Instruction::kTypeRef:
+        if (idx >= type_ref_ids_.size())
+            return kNoId;
+        return InternType(idx);
+      case Instruction::kFieldRef:
+        if (idx >= field_ref_ids_.size())
+            return kNoId;
+        if (field_ref_ids_[idx] == kNoId)
+            field_ref_ids_[idx] = Intern(PrettyField(idx, dex_file_, true));
+        return field_ref_ids_[idx];
+      case Instruction::kMethodRef:
+        if (idx >= method_ref_ids_.size())
+            return kNoId;
+        return InternMethod(idx);
+      default:
+        return kNoId;
+    }
+}
+
+uint32_t ArrowDumper::InternType(uint32_t type_idx)
+{
+    if (type_idx >= type_ref_ids_.size())
+        return Intern(PrettyType(type_idx, dex_file_));
+    if (type_ref_ids_[type_idx] == kNoId)
+        type_ref_ids_[type_idx] = Intern(PrettyType(type_idx, dex_file_));
+    return type_ref_ids_[type_idx];
+}
+
+uint32_t ArrowDumper::InternMethod(uint32_t method_idx)
+{
+    if (method_idx >= method_ref_ids_.size())
+        return Intern(PrettyMethod(method_idx, dex_file_, true));
+    if (method_ref_ids_[method_idx] == kNoId)
+        method_ref_ids_[method_idx] = Intern(PrettyMethod(method_idx, dex_file_, true));
+    return method_ref_ids_[method_idx];
+}
@@ -0,0 +1,160 @@
+#ifndef _DUMPER_ARROW_DUMPER_H_
+#define _DUMPER_ARROW_DUMPER_H_
+
+
+#include <unordered_map>
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+#include "arrow_writer.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "dump_filter.h"
+
+
+// Export a dex file as Apache Arrow IPC streams, one per table, named by
+// appending the table suffix to the output prefix. The granularity decides
+// which tables are written:
+//
+//   <prefix>.classes.arrows      : class_def_idx, name, superclass,
+//                                  access_flags, method_count
+//   <prefix>.methods.arrows      : class_def_idx, class_method_idx,
+//                                  dex_method_idx, name, access_flags,
+//                                  code_off, registers_size, ins_size,
+//                                  outs_size, tries_size, insns_size
+//   <prefix>.instructions.arrows : class_def_idx, dex_method_idx, dex_pc,
+//                                  opcode, vA, vB, vC, args, ref_idx, ref
+//
+// The names are converted from modified UTF-8 to UTF-8 and dictionary encoded.
+// Each stream has its own dictionary holding only the names its rows refer
+// to, and sends the names added since its previous batch as a delta
+// dictionary. The opcode is dictionary encoded as uint8 against the opcode
+// names, and the absent operands and references are nulls. The args column
+// is the list<int32> of the argument registers of the invokes and the
+// filled-new-array of the 35c format, the ranges being given by vA and vC.
+class ArrowDumper
+{
+  public:
+    // The number of rows per record batch.
+    static constexpr uint32_t kBatchSize = 64 * KB;
+
+    static constexpr int64_t kNameDictionary = 0;
+    static constexpr int64_t kOpcodeDictionary = 1;
+
+    // The filter is not owned and must outlive the dumper.
+    ArrowDumper(const DexFile& dex_file, char opt_granu, const DumpFilter& filter);
+
+    bool Dump(const char* prefix, bool direct_io) WARN_UNUSED;
+
+  private:
+    // An output stream and the columns of the batch being built.
+    struct Table
+    {
+        std::unique_ptr<OutputSink> sink_;
+        std::unique_ptr<ArrowStreamWriter> writer_;
+        std::vector<std::unique_ptr<ArrowStreamWriter::Column>> columns_;
+        std::vector<ArrowStreamWriter::Column*> column_ptrs_;
+
+        // The names of the dictionary of the stream, and their ids by name
+        // table id, kNoId for the names the stream does not refer to.
+        std::vector<std::string> names_;
+        std::vector<uint32_t> name_ids_;
+        size_t names_sent_;
+
+        ArrowStreamWriter::Column& operator[](uint32_t idx)
+        {
+            return *column_ptrs_[idx];
+        }
+    };
+
+    enum ClassColumn
+    {
+        kClassDefIdx = 0,
+        kClassName,
+        kClassSuperclass,
+        kClassAccessFlags,
+        kClassMethodCount,
+    };
+
+    enum MethodColumn
+    {
+        kMethodClassDefIdx = 0,
+        kMethodClassMethodIdx,
+        kMethodDexMethodIdx,
+        kMethodName,
+        kMethodAccessFlags,
+        kMethodCodeOff,
+        kMethodRegistersSize,
+        kMethodInsSize,
+        kMethodOutsSize,
+        kMethodTriesSize,
+        kMethodInsnsSize,
+    };
+
+    enum InstructionColumn
+    {
+        kInsnClassDefIdx = 0,
+        kInsnDexMethodIdx,
+        kInsnDexPc,
+        kInsnOpcode,
+        kInsnVRegA,
+        kInsnVRegB,
+        kInsnVRegC,
+        kInsnArgs,
+        kInsnRefIdx,
+        kInsnRef,
+    };
+
+    bool OpenTable(Table* table, const char* prefix, const char* suffix, bool direct_io,
+                   const std::vector<ArrowStreamWriter::Field>& fields);
+
+    // Send the pending names and the batch if it is full, or if forced.
+    bool FlushTable(Table* table, bool force);
+    bool CloseTable(Table* table);
+
+    bool DumpClass(uint32_t class_def_idx);
+    bool DumpMethod(uint32_t class_def_idx, uint32_t class_method_idx,
+                    const ClassDataItemIterator& it);
+    bool DumpInstruction(uint32_t class_def_idx, uint32_t dex_method_idx,
+                         uint32_t dex_pc, const Instruction* inst);
+
+    // Returns the name table id of the given modified UTF-8 string, adding it
+    // if necessary.
+    uint32_t Intern(const std::string& str);
+
+    // Returns the dictionary id of the name in the stream of the table,
+    // adding it if necessary.
+    uint32_t TableName(Table* table, uint32_t name_id);
+
+    // Returns the name of the entity referred by the instruction, or kNoId.
+    uint32_t InternReference(const Instruction* inst);
+    uint32_t InternType(uint32_t type_idx);
+    uint32_t InternMethod(uint32_t method_idx);
+
+    static constexpr uint32_t kNoId = 0xFFFFFFFF;
+
+    const DexFile& dex_file_;
+    const char opt_granu_;
+    const DumpFilter& filter_;
+
+    Table classes_;
+    Table methods_;
+    Table instructions_;
+
+    // The UTF-8 names referred by any table, and the conversion buffer.
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, uint32_t> name_ids_;
+    std::string utf8_;
+
+    // The name table ids of the already resolved dex indices.
+    std::vector<uint32_t> string_ref_ids_;
+    std::vector<uint32_t> type_ref_ids_;
+    std::vector<uint32_t> field_ref_ids_;
+    std::vector<uint32_t> method_ref_ids_;
+
+    DISALLOW_COPY_AND_ASSIGN(ArrowDumper);
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "binary_dumper.h"
+#include "cmd_opt.h"
+#include "misc.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+
+
+const byte BinaryDumper::kMagic[8] = { 'y', 'a', 'd', 'd', 'b', 'i', 'n', '\0' };
+constexpr uint32_t BinaryDumper::kVersion;
+constexpr uint32_t BinaryDumper::kEndianConstant;
+constexpr uint32_t BinaryDumper::kNoId;
+
+static_assert(sizeof(BinaryDumper::ClassRecord) == 24, "Unexpected class record size.");
+static_assert(sizeof(BinaryDumper::MethodRecord) == 40, "Unexpected method record size.");
+static_assert(sizeof(BinaryDumper::InstructionRecord) == 32,
+              "Unexpected instruction record size.");
+static_assert(sizeof(BinaryDumper::Header) % 8 == 0, "Unexpected header size.");
+
+
+BinaryDumper::BinaryDumper(const DexFile& dex_file, char opt_granu,
+                           const DumpFilter& filter)
+  : dex_file_(dex_file),
+    opt_granu_(opt_granu),
+    filter_(filter),
+    string_offsets_(1, 0),
+    string_ref_ids_(dex_file.NumStringIds(), kNoId),
+    type_ref_ids_(dex_file.NumTypeIds(), kNoId),
+    field_ref_ids_(dex_file.NumFieldIds(), kNoId),
+    method_ref_ids_(dex_file.NumMethodIds(), kNoId)
+{}
+
+bool BinaryDumper::Dump(OutputSink& sink)
+{
+    uint32_t num_class_def = dex_file_.NumClassDefs();
+    classes_.reserve(num_class_def);
+    for (uint32_t class_def_idx = 0 ; class_def_idx < num_class_def ; ++class_def_idx) {
+        if (filter_.KeepClass(dex_file_, class_def_idx))
+            AddClass(class_def_idx);
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic_, kMagic, sizeof(kMagic));
+    header.version_ = kVersion;
+    header.endian_tag_ = kEndianConstant;
+    header.granularity_ = opt_granu_;
+    header.num_sections_ = kNumSections;
+
+    const void* data[kNumSections] = {
+        string_offsets_.data(), string_data_.data(), classes_.data(),
+        methods_.data(), instructions_.data() };
+    header.sections_[kSectionStringOffsets].size_ = string_offsets_.size() * sizeof(uint64_t);
+    header.sections_[kSectionStringOffsets].count_ = string_offsets_.size() - 1;
+    header.sections_[kSectionStringData].size_ = string_data_.size();
+    header.sections_[kSectionStringData].count_ = string_offsets_.size() - 1;
+    header.sections_[kSectionClasses].size_ = classes_.size() * sizeof(ClassRecord);
+    header.sections_[kSectionClasses].count_ = classes_.size();
+    header.sections_[kSectionMethods].size_ = methods_.size() * sizeof(MethodRecord);
+    header.sections_[kSectionMethods].count_ = methods_.size();
+    header.sections_[kSectionInstructions].size_ =
+        instructions_.size() * sizeof(InstructionRecord);
+    header.sections_[kSectionInstructions].count_ = instructions_.size();
+
+    uint64_t offset = sizeof(Header);
+    for (SectionEntry& section : header.sections_) {
+        section.offset_ = offset;
+        offset += (section.size_ + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    uint64_t pos = 0;
+    if (!WriteSection(sink, &header, sizeof(header), &pos))
+        return false;
+    for (uint32_t i = 0 ; i < kNumSections ; ++i) {
+        if (!WriteSection(sink, data[i], header.sections_[i].size_, &pos))
+            return false;
+    }
+    return true;
+}
+
+bool BinaryDumper::WriteSection(OutputSink& sink, const void* data, size_t size,
+                                uint64_t* pos)
+{
+    static const char kPadding[8] = { 0 };
+    if (size > 0 && !sink.Write(reinterpret_cast<const char*>(data), size))
+        return false;
+    *pos += size;
+    size_t padding = (8 - (*pos & 7)) & 7;
+    *pos += padding;
+    return sink.Write(kPadding, padding);
+}
+
+uint32_t BinaryDumper::Intern(const char* str, size_t len)
+{
+    std::string key(str, len);
+    auto iter = string_ids_.find(key);
+    if (iter != string_ids_.end())
+        return iter->second;
+
+    uint32_t id = string_offsets_.size() - 1;
+    string_data_.append(str, len);
+    string_data_ += '\0';
+    string_offsets_.push_back(string_data_.size());
+    string_ids_.emplace(std::move(key), id);
+    return id;
+}
+
+uint32_t BinaryDumper::InternReference(const Instruction* inst)
+{
+    // The quickened instructions carry offsets rather than dex indices.
+    if (inst->GetVerifyIsRuntimeOnly())
+        return kNoId;
+    uint32_t idx = inst->GetIndexOperand();
+    switch (Instruction::IndexTypeOf(inst->Opcode())) {
+      case Instruction::kStringRef:
+        if (idx >= string_ref_ids_.size())
+            return kNoId;
+        if (string_ref_ids_[idx] == kNoId) {
+            const char* str = dex_file_.StringDataByIdx(idx);
+            string_ref_ids_[idx] = Intern(str, strlen(str));
+        }
+        return string_ref_ids_[idx];
+      case Instruction::kTypeRef:
+        if (idx >= type_ref_ids_.size())
+            return kNoId;
+        if (type_ref_ids_[idx] == kNoId)
+            type_ref_ids_[idx] = Intern(PrettyType(idx, dex_file_));
+        return type_ref_ids_[idx];
+      case Instruction::kFieldRef:
+        if (idx >= field_ref_ids_.size())
+            return kNoId;
+        if (field_ref_ids_[idx] == kNoId)
+            field_ref_ids_[idx] = Intern(PrettyField(idx, dex_file_, true));
+        return field_ref_ids_[idx];
+      case Instruction::kMethodRef:
+        if (idx >= method_ref_ids_.size())
+            return kNoId;
+        if (method_ref_ids_[idx] == kNoId)
+            method_ref_ids_[idx] = Intern(PrettyMethod(idx, dex_file_, true));
+        return method_ref_ids_[idx];
+      default:
+        return kNoId;
+    }
+}
+
+void BinaryDumper::AddClass(uint32_t class_def_idx)
+{
+    const DexFile::ClassDef& class_def = dex_file_.GetClassDef(class_def_idx);
+    ClassRecord record;
+    record.class_def_idx_ = class_def_idx;
+    record.descriptor_id_ = Intern(PrettyClass(class_def_idx, dex_file_));
+    record.superclass_id_ = (class_def.superclass_idx_ == DexFile::kDexNoIndex16)? kNoId :
+                            Intern(PrettyType(class_def.superclass_idx_, dex_file_));
+    record.access_flags_ = class_def.access_flags_;
+    record.method_begin_ = methods_.size();
+    record.method_count_ = 0;
+
+    const byte* class_data = dex_file_.GetClassData(class_def);
+    if (opt_granu_ != kGranuCodeClass && class_data != nullptr) {
+        ClassDataItemIterator it(dex_file_, class_data);
+        SkipAllFields(it);
+        while (it.HasNext()) {
+            if (filter_.KeepMethod(dex_file_, it.GetMemberIndex()))
+                AddMethod(it.GetMemberIndex(), it.GetRawMemberAccessFlags(),
+                          it.GetMethodCodeItemOffset());
+            it.Next();
+        }
+        record.method_count_ = methods_.size() - record.method_begin_;
+    }
+    classes_.push_back(record);
+}
+
+void BinaryDumper::AddMethod(uint32_t dex_method_idx, uint32_t access_flags,
+                             uint32_t code_off)
+{
+    MethodRecord record;
+    memset(&record, 0, sizeof(record));
+    record.dex_method_idx_ = dex_method_idx;
+    if (dex_method_idx < method_ref_ids_.size()) {
+        if (method_ref_ids_[dex_method_idx] == kNoId)
+            method_ref_ids_[dex_method_idx] = Intern(PrettyMethod(dex_method_idx, dex_file_, true));
+        record.signature_id_ = method_ref_ids_[dex_method_idx];
+    } else
+        record.signature_id_ = Intern(PrettyMethod(dex_method_idx, dex_file_, true));
+    record.access_flags_ = access_flags;
+    record.code_off_ = code_off;
+    record.insn_begin_ = instructions_.size();
+
+    const DexFile::CodeItem* code_item = dex_file_.GetCodeItem(code_off);
+    if (code_item != nullptr) {
+        record.registers_size_ = code_item->registers_size_;
+        record.ins_size_ = code_item->ins_size_;
+        record.outs_size_ = code_item->outs_size_;
+        record.tries_size_ = code_item->tries_size_;
+        record.insns_size_ = code_item->insns_size_in_code_units_;
+        if (opt_granu_ == kGranuCodeInstruction)
+            AddInstructions(code_item);
+    }
+    record.insn_count_ = instructions_.size() - record.insn_begin_;
+    methods_.push_back(record);
+}
+
+void BinaryDumper::AddInstructions(const DexFile::CodeItem* code_item)
+{
+    size_t inst_off = 0;
+    while (inst_off < code_item->insns_size_in_code_units_) {
+        const Instruction* inst = Instruction::At(&code_item->insns_[inst_off]);
+        Instruction::Code opcode = inst->Opcode();
+
+        InstructionRecord record;
+        memset(&record, 0, sizeof(record));
+        record.dex_pc_ = inst_off;
+        record.opcode_ = opcode;
+        record.format_ = Instruction::FormatOf(opcode);
+        record.size_ = inst->SizeInCodeUnits();
+        if (inst->HasVRegA())
+            record.vreg_a_ = inst->VRegA();
+        if (inst->HasWideVRegB())
+            record.vreg_b_ = inst->WideVRegB();
+        else if (inst->HasVRegB())
+            record.vreg_b_ = inst->VRegB();
+        if (inst->HasVRegC())
+            record.vreg_c_ = inst->VRegC();
+        if (inst->HasVarArgs()) {
+            uint32_t args[Instruction::kMaxVarArgRegs];
+            inst->GetVarArgs(args);
+            for (uint32_t i = 0 ; i < static_cast<uint32_t>(inst->VRegA_35c()) ; ++i)
+                record.var_args_ |= (args[i] & 0xf) << (i * 4);
+        }
+        record.ref_id_ = InternReference(inst);
+        instructions_.push_back(record);
+        inst_off += record.size_;
+    }
+}
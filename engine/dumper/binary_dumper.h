@@ -0,0 +1,151 @@
+#ifndef _DUMPER_BINARY_DUMPER_H_
+#define _DUMPER_BINARY_DUMPER_H_
+
+
+#include <unordered_map>
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "dump_filter.h"
+
+
+// Dump a dex file into a compact sectioned binary file. The header at the
+// front locates each section, and the sections are 8 byte aligned so that a
+// reader can mmap the file and index the fixed width records directly:
+//
+//   Header
+//   kSectionStringOffsets : uint64_t[count + 1], the dictionary string i
+//                           spans [offsets[i], offsets[i + 1] - 1) and is
+//                           followed by a NUL byte
+//   kSectionStringData    : the dictionary bytes
+//   kSectionClasses       : ClassRecord[count], in class_def order
+//   kSectionMethods       : MethodRecord[count], grouped by class
+//   kSectionInstructions  : InstructionRecord[count], grouped by method
+//
+// Every name is stored once in the dictionary and referred by its id. All
+// the values are in the host byte order, which is recorded by endian_tag_.
+class BinaryDumper
+{
+  public:
+    static const byte kMagic[8];
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kEndianConstant = 0x12345678;
+
+    // The dictionary id of an absent string.
+    static constexpr uint32_t kNoId = 0xFFFFFFFF;
+
+    enum Section
+    {
+        kSectionStringOffsets = 0,
+        kSectionStringData,
+        kSectionClasses,
+        kSectionMethods,
+        kSectionInstructions,
+        kNumSections,
+    };
+
+    struct SectionEntry
+    {
+        uint64_t offset_;  // file offset of the section
+        uint64_t size_;  // size of the section in bytes
+        uint64_t count_;  // number of records or strings in the section
+    };
+
+    struct Header
+    {
+        byte magic_[8];
+        uint32_t version_;
+        uint32_t endian_tag_;
+        uint32_t granularity_;  // the kGranuCode* the file is dumped with
+        uint32_t num_sections_;
+        SectionEntry sections_[kNumSections];
+    };
+
+    struct ClassRecord
+    {
+        uint32_t class_def_idx_;
+        uint32_t descriptor_id_;  // pretty class name
+        uint32_t superclass_id_;  // pretty superclass name, or kNoId
+        uint32_t access_flags_;
+        uint32_t method_begin_;  // index of the first method record
+        uint32_t method_count_;
+    };
+
+    struct MethodRecord
+    {
+        uint32_t dex_method_idx_;
+        uint32_t signature_id_;  // pretty method with signature
+        uint32_t access_flags_;
+        uint32_t code_off_;  // 0 for native and abstract methods
+        uint16_t registers_size_;
+        uint16_t ins_size_;
+        uint16_t outs_size_;
+        uint16_t tries_size_;
+        uint32_t insns_size_;  // size of the code in 2 byte code units
+        uint32_t insn_count_;
+        uint64_t insn_begin_;  // index of the first instruction record
+    };
+
+    struct InstructionRecord
+    {
+        uint32_t dex_pc_;
+        uint8_t opcode_;
+        uint8_t format_;  // Instruction::Format
+        uint16_t size_;  // size in 2 byte code units
+        int32_t vreg_a_;
+        int32_t vreg_c_;  // for 35c, the first argument register
+        int64_t vreg_b_;  // the wide literal for 51l
+        uint32_t ref_id_;  // the referred string, type, field or method, or kNoId
+        uint32_t var_args_;  // the 35c argument registers, 4 bits each
+    };
+
+    // The filter is not owned and must outlive the dumper.
+    BinaryDumper(const DexFile& dex_file, char opt_granu, const DumpFilter& filter);
+
+    bool Dump(OutputSink& sink) WARN_UNUSED;
+
+  private:
+    // Returns the dictionary id of the given string, adding it if necessary.
+    uint32_t Intern(const char* str, size_t len);
+    uint32_t Intern(const std::string& str)
+    {
+        return Intern(str.data(), str.size());
+    }
+
+    // Returns the dictionary id of the entity referred by the instruction.
+    uint32_t InternReference(const Instruction* inst);
+
+    void AddClass(uint32_t class_def_idx);
+    void AddMethod(uint32_t dex_method_idx, uint32_t access_flags, uint32_t code_off);
+    void AddInstructions(const DexFile::CodeItem* code_item);
+
+    bool WriteSection(OutputSink& sink, const void* data, size_t size, uint64_t* pos);
+
+    const DexFile& dex_file_;
+    const char opt_granu_;
+    const DumpFilter& filter_;
+
+    // The string dictionary.
+    std::string string_data_;
+    std::vector<uint64_t> string_offsets_;
+    std::unordered_map<std::string, uint32_t> string_ids_;
+
+    // The dictionary ids of the already resolved dex indices, indexed by the
+    // dex index of each kind. They spare re-rendering the pretty names.
+    std::vector<uint32_t> string_ref_ids_;
+    std::vector<uint32_t> type_ref_ids_;
+    std::vector<uint32_t> field_ref_ids_;
+    std::vector<uint32_t> method_ref_ids_;
+
+    std::vector<ClassRecord> classes_;
+    std::vector<MethodRecord> methods_;
+    std::vector<InstructionRecord> instructions_;
+
+    DISALLOW_COPY_AND_ASSIGN(BinaryDumper);
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "call_graph.h"
+#include "async_writer.h"
+#include "leb128.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+#include "misc.h"
+
+
+const byte CallGraph::kMagic[8] = { 'y', 'a', 'd', 'd', 'c', 'g', '\0', '\0' };
+constexpr uint32_t CallGraph::kVersion;
+constexpr uint32_t CallGraph::kEndianConstant;
+constexpr uint16_t CallGraph::kExternal;
+
+static_assert(sizeof(CallGraph::Header) == 48, "Unexpected call graph header size.");
+
+
+CallGraph::CallGraph()
+  : offsets_(1, 0),
+    num_files_(0)
+{}
+
+void CallGraph::Build(const std::vector<const DexFile*>& dex_files, const DumpFilter& filter,
+                      ThreadPool* pool)
+{
+    CHECK_LT(dex_files.size(), kExternal);
+    num_files_ = dex_files.size();
+
+    // Key the method_ids of every file.
+    std::vector<uint32_t> num_method_ids;
+    for (const DexFile* dex_file : dex_files)
+        num_method_ids.push_back(dex_file->NumMethodIds());
+    std::vector<std::vector<std::string>> keys(num_files_);
+    for (uint32_t file = 0 ; file < num_files_ ; ++file)
+        keys[file].resize(num_method_ids[file]);
+    std::vector<Task> key_tasks = SplitTasks(num_method_ids, kIdChunkSize);
+    pool->ParallelFor(key_tasks.size(), [&](uint32_t idx) {
+        const Task& task = key_tasks[idx];
+        for (uint32_t method_idx = task.begin_ ; method_idx < task.end_ ; ++method_idx)
+            keys[task.file_][method_idx] = KeyOf(*dex_files[task.file_], method_idx);
+    });
+
+    // Merge the keys into the global ids, in file then method_id order.
+    std::unordered_map<std::string, uint32_t> ids;
+    global_ids_.assign(num_files_, std::vector<uint32_t>());
+    names_.clear();
+    for (uint32_t file = 0 ; file < num_files_ ; ++file) {
+        global_ids_[file].resize(num_method_ids[file]);
+        for (uint32_t method_idx = 0 ; method_idx < num_method_ids[file] ; ++method_idx) {
+            std::string& key = keys[file][method_idx];
+            auto iter = ids.find(key);
+            if (iter == ids.end()) {
+                iter = ids.emplace(key, names_.size()).first;
+                names_.push_back(std::move(key));
+            }
+            global_ids_[file][method_idx] = iter->second;
+        }
+        std::vector<std::string>().swap(keys[file]);
+    }
+
+    // Extract the invokes of every chunk of classes.
+    std::vector<uint32_t> num_class_defs;
+    for (const DexFile* dex_file : dex_files)
+        num_class_defs.push_back(dex_file->NumClassDefs());
+    std::vector<Task> scan_tasks = SplitTasks(num_class_defs, kClassChunkSize);
+    std::vector<Edges> task_edges(scan_tasks.size());
+    std::vector<std::vector<uint32_t>> task_defined(scan_tasks.size());
+    pool->ParallelFor(scan_tasks.size(), [&](uint32_t idx) {
+        const Task& task = scan_tasks[idx];
+        for (uint32_t class_def_idx = task.begin_ ; class_def_idx < task.end_ ; ++class_def_idx)
+            ScanClass(*dex_files[task.file_], global_ids_[task.file_], filter, class_def_idx,
+                      &task_edges[idx], &task_defined[idx]);
+    });
+
+    // The first file defining a method wins, as the runtime class loader
+    // would pick it.
+    defining_files_.assign(names_.size(), kExternal);
+    for (uint32_t idx = 0 ; idx < scan_tasks.size() ; ++idx) {
+        for (uint32_t id : task_defined[idx]) {
+            if (defining_files_[id] == kExternal)
+                defining_files_[id] = scan_tasks[idx].file_;
+        }
+    }
+    FillRows(task_edges, pool);
+}
+
+std::vector<CallGraph::Task> CallGraph::SplitTasks(const std::vector<uint32_t>& counts,
+                                                   uint32_t chunk_size)
+{
+    std::vector<Task> tasks;
+    for (uint32_t file = 0 ; file < counts.size() ; ++file) {
+        for (uint32_t begin = 0 ; begin < counts[file] ; begin += chunk_size) {
+            Task task = {file, begin, std::min(begin + chunk_size, counts[file])};
+            tasks.push_back(task);
+        }
+    }
+    return tasks;
+}
+
+void CallGraph::ScanClass(const DexFile& dex_file, const std::vector<uint32_t>& global_ids,
+                          const DumpFilter& filter, uint32_t class_def_idx,
+                          Edges* edges, std::vector<uint32_t>* defined) const
+{
+    const byte* class_data = dex_file.GetClassData(dex_file.GetClassDef(class_def_idx));
+    if (class_data == nullptr)
+        return;
+
+    // The methods of a filtered out class are still defined by the file,
+    // only their invokes are left out.
+    bool keep_class = filter.KeepClass(dex_file, class_def_idx);
+    uint32_t num_method_ids = global_ids.size();
+    ClassDataItemIterator it(dex_file, class_data);
+    SkipAllFields(it);
+    for ( ; it.HasNext() ; it.Next()) {
+        uint32_t dex_method_idx = it.GetMemberIndex();
+        if (dex_method_idx >= num_method_ids)
+            continue;
+        uint32_t caller = global_ids[dex_method_idx];
+        defined->push_back(caller);
+
+        const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+        if (!keep_class || code_item == nullptr || !filter.KeepMethod(dex_file, dex_method_idx))
+            continue;
+        uint32_t dex_pc = 0;
+        while (dex_pc < code_item->insns_size_in_code_units_) {
+            const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+            dex_pc += inst->SizeInCodeUnits();
+            if (!inst->IsInvoke() || inst->GetVerifyIsRuntimeOnly() ||
+                Instruction::IndexTypeOf(inst->Opcode()) != Instruction::kMethodRef)
+                continue;
+            uint32_t method_idx = inst->GetIndexOperand();
+            if (method_idx < num_method_ids)
+                edges->emplace_back(caller, global_ids[method_idx]);
+        }
+    }
+}
+
+void CallGraph::FillRows(const std::vector<Edges>& task_edges, ThreadPool* pool)
+{
+    uint32_t num_methods = names_.size();
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> callees;
+    Bucket(task_edges.data(), task_edges.size(), num_methods, &offsets, &callees);
+
+    // Sort and deduplicate the rows in parallel chunks, then compact them.
+    std::vector<uint32_t> degrees(num_methods);
+    pool->ParallelForChunks(0, num_methods, kIdChunkSize,
+                            [&](uint32_t, uint32_t, uint32_t begin, uint32_t end) {
+        for (uint32_t id = begin ; id < end ; ++id) {
+            uint32_t* row_begin = callees.data() + offsets[id];
+            uint32_t* row_end = callees.data() + offsets[id + 1];
+            std::sort(row_begin, row_end);
+            degrees[id] = std::unique(row_begin, row_end) - row_begin;
+        }
+    });
+
+    offsets_.assign(num_methods + 1, 0);
+    callees_.clear();
+    for (uint32_t id = 0 ; id < num_methods ; ++id) {
+        const uint32_t* row = callees.data() + offsets[id];
+        callees_.insert(callees_.end(), row, row + degrees[id]);
+        offsets_[id + 1] = callees_.size();
+    }
+}
+
+bool CallGraph::Write(const char* path) const
+{
+    uint32_t num_methods = names_.size();
+    std::vector<uint16_t> defining_files(defining_files_);
+    while (defining_files.size() % 4 != 0)
+        defining_files.push_back(kExternal);
+
+    std::string edge_data;
+    uint8_t leb[5];
+    for (uint32_t id = 0 ; id < num_methods ; ++id) {
+        Range<uint32_t> row = Callees(id);
+        uint8_t* end = EncodeUnsignedLeb128(leb, row.size());
+        edge_data.append(reinterpret_cast<char*>(leb), end - leb);
+        uint32_t prev = 0;
+        for (uint32_t callee : row) {
+            end = EncodeUnsignedLeb128(leb, callee - prev);
+            edge_data.append(reinterpret_cast<char*>(leb), end - leb);
+            prev = callee;
+        }
+    }
+
+    std::string name_data;
+    for (const std::string& name : names_) {
+        name_data += name;
+        name_data += '\0';
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic_, kMagic, sizeof(kMagic));
+    header.version_ = kVersion;
+    header.endian_tag_ = kEndianConstant;
+    header.file_count_ = num_files_;
+    header.method_count_ = num_methods;
+    header.edge_count_ = callees_.size();
+    header.edge_data_size_ = edge_data.size();
+    header.name_data_size_ = name_data.size();
+
+    std::unique_ptr<OutputSink> sink(AsyncWriter::Open(path, false));
+    if (sink.get() == nullptr)
+        return false;
+    bool success =
+        sink->Write(reinterpret_cast<const char*>(&header), sizeof(header)) &&
+        sink->Write(reinterpret_cast<const char*>(defining_files.data()),
+                    defining_files.size() * sizeof(uint16_t)) &&
+        sink->Write(edge_data) &&
+        sink->Write(name_data);
+    return sink->Close() && success;
+}
+
+std::string CallGraph::KeyOf(const DexFile& dex_file, uint32_t method_idx)
+{
+    const DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+    std::string key(dex_file.GetMethodDeclaringClassDescriptor(method_id));
+    key += "->";
+    key += dex_file.GetMethodName(method_id);
+    key += dex_file.GetMethodSignature(method_id).ToString();
+    return key;
+}
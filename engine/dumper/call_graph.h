@@ -0,0 +1,142 @@
+#ifndef _DUMPER_CALL_GRAPH_H_
+#define _DUMPER_CALL_GRAPH_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "range.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dump_filter.h"
+
+
+// A call graph over all the dex files of an app. A method is identified
+// across the files by its declaring class descriptor, name and signature, as
+// in "Lcom/a/B;->run(I)V", so an invoke in one file is linked to the method
+// defined in another. The methods get dense ids in the order they are first
+// met, file by file in method_id order, and the ones that no file defines,
+// such as the framework methods, are kept as external nodes.
+//
+// The invoke targets are taken as they are named by the instruction; the
+// virtual dispatch to the overriding methods is not resolved.
+//
+// The build runs in three parallel phases: the method_ids of every file are
+// keyed, the keys are merged into the global ids, and the invokes of every
+// chunk of classes are extracted as edges. The edges are then bucketed by
+// caller into a compressed sparse row, with each row sorted and deduplicated.
+//
+// The serialized graph is
+//
+//   Header
+//   uint16_t[method_count]  : the index of the file defining each method, or
+//                             kExternal, padded to 8 bytes
+//   byte[edge_data_size]    : per method, the ULEB128 callee count followed
+//                             by the ULEB128 deltas of the sorted callee ids
+//   char[name_data_size]    : the NUL terminated method keys in id order
+//
+// All the fixed width values are in the host byte order, which is recorded
+// by endian_tag_.
+class CallGraph
+{
+  public:
+    static const byte kMagic[8];
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kEndianConstant = 0x12345678;
+    static constexpr uint16_t kExternal = 0xFFFF;
+
+    struct Header
+    {
+        byte magic_[8];
+        uint32_t version_;
+        uint32_t endian_tag_;
+        uint32_t file_count_;
+        uint32_t method_count_;
+        uint64_t edge_count_;
+        uint64_t edge_data_size_;
+        uint64_t name_data_size_;
+    };
+
+    CallGraph();
+
+    // Build the graph of the given files, at most kExternal of them. The
+    // filter selects the calling code, while every class of the files still
+    // defines its methods. The files are not owned.
+    void Build(const std::vector<const DexFile*>& dex_files, const DumpFilter& filter,
+               ThreadPool* pool);
+
+    uint32_t NumMethods() const
+    {
+        return names_.size();
+    }
+
+    uint64_t NumEdges() const
+    {
+        return callees_.size();
+    }
+
+    const std::string& MethodKey(uint32_t id) const
+    {
+        return names_[id];
+    }
+
+    // Returns the index of the file defining the method, or kExternal.
+    uint16_t DefiningFile(uint32_t id) const
+    {
+        return defining_files_[id];
+    }
+
+    // Returns the id of a method_id of one of the files, so that an invoke
+    // is resolved with a single lookup.
+    uint32_t GlobalId(uint16_t file, uint32_t method_idx) const
+    {
+        return global_ids_[file][method_idx];
+    }
+
+    // The callees of a method.
+    Range<uint32_t> Callees(uint32_t id) const
+    {
+        const uint32_t* base = callees_.data();
+        return Range<uint32_t>(base + offsets_[id], base + offsets_[id + 1]);
+    }
+
+    bool Write(const char* path) const WARN_UNUSED;
+
+    // Returns the key identifying the given method across the dex files.
+    static std::string KeyOf(const DexFile& dex_file, uint32_t method_idx);
+
+  private:
+    // A unit of work over the dex files: a range of method_ids to key, or of
+    // classes to scan, in one file.
+    struct Task
+    {
+        uint32_t file_;
+        uint32_t begin_;
+        uint32_t end_;
+    };
+
+    // The invokes found by a class scanning task, as (caller, callee) pairs of
+    // global ids.
+    typedef std::vector<std::pair<uint32_t, uint32_t>> Edges;
+
+    static std::vector<Task> SplitTasks(const std::vector<uint32_t>& counts,
+                                        uint32_t chunk_size);
+
+    void ScanClass(const DexFile& dex_file, const std::vector<uint32_t>& global_ids,
+                   const DumpFilter& filter, uint32_t class_def_idx, Edges* edges,
+                   std::vector<uint32_t>* defined) const;
+
+    // Bucket the edges by caller, then sort and deduplicate every row.
+    void FillRows(const std::vector<Edges>& task_edges, ThreadPool* pool);
+
+    std::vector<std::string> names_;
+    std::vector<uint16_t> defining_files_;
+    std::vector<std::vector<uint32_t>> global_ids_;  // by file and method_idx
+    std::vector<uint32_t> offsets_;  // of size NumMethods() + 1
+    std::vector<uint32_t> callees_;
+    uint32_t num_files_;
+
+    DISALLOW_COPY_AND_ASSIGN(CallGraph);
+};
+
+#endif
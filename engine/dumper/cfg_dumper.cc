@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <cstring>
+
+#include "cfg_dumper.h"
+#include "misc.h"
+#include "stringprintf.h"
+#include "cmd_opt.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+
+
+// Returns true for the classes through which code is loaded or reached
+// reflectively.
+static bool IsReflectionClass(const char* descriptor)
+{
+    return strcmp(descriptor, "Ljava/lang/Class;") == 0 ||
+           strcmp(descriptor, "Ljava/lang/ClassLoader;") == 0 ||
+           strncmp(descriptor, "Ljava/lang/reflect/", 19) == 0 ||
+           strncmp(descriptor, "Ldalvik/system/", 15) == 0;
+}
+
+
+CfgDumper::CfgDumper(const DexFile& dex_file, char opt_granu, const DumpFilter& filter)
+  : dex_file_(dex_file),
+    opt_granu_(opt_granu),
+    filter_(filter)
+{}
+
+bool CfgDumper::Dump(OutputSink& sink, ThreadPool* pool)
+{
+    uint32_t num_class_def = dex_file_.NumClassDefs();
+    uint32_t num_workers = pool->NumChunkWorkers(num_class_def, kClassChunkSize);
+    uint32_t round_size = num_workers * kChunksPerWorker;
+
+    if (opt_granu_ == kGranuCodeReflection) {
+        reflection_methods_.assign(dex_file_.NumMethodIds(), false);
+        for (uint32_t method_idx = 0 ; method_idx < dex_file_.NumMethodIds() ; ++method_idx) {
+            const DexFile::MethodId& method_id = dex_file_.GetMethodId(method_idx);
+            reflection_methods_[method_idx] =
+                IsReflectionClass(dex_file_.StringByTypeIdx(method_id.class_idx_));
+        }
+    }
+
+    std::vector<Worker> workers(num_workers);
+    std::vector<std::string> outs(round_size);
+    uint32_t round_classes = round_size * kClassChunkSize;
+    for (uint32_t round_begin = 0 ; round_begin < num_class_def ; round_begin += round_classes) {
+        uint32_t round_end = std::min(round_begin + round_classes, num_class_def);
+        pool->ParallelForChunks(round_begin, round_end, kClassChunkSize,
+                                [&](uint32_t worker, uint32_t chunk, uint32_t begin,
+                                    uint32_t end) {
+            std::string* out = &outs[chunk];
+            out->clear();
+            for (uint32_t class_def_idx = begin ; class_def_idx < end ; ++class_def_idx) {
+                if (filter_.KeepClass(dex_file_, class_def_idx))
+                    DumpClass(&workers[worker], out, class_def_idx);
+            }
+        });
+
+        uint32_t num_chunks = (round_end - round_begin + kClassChunkSize - 1) / kClassChunkSize;
+        for (uint32_t chunk = 0 ; chunk < num_chunks ; ++chunk) {
+            if (!sink.Write(outs[chunk]))
+                return false;
+        }
+    }
+    return true;
+}
+
+void CfgDumper::DumpClass(Worker* worker, std::string* out, uint32_t class_def_idx) const
+{
+    const byte* class_data = dex_file_.GetClassData(dex_file_.GetClassDef(class_def_idx));
+    if (class_data == nullptr)
+        return;
+    ClassDataItemIterator it(dex_file_, class_data);
+    SkipAllFields(it);
+    for ( ; it.HasNext() ; it.Next()) {
+        const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+        if (code_item != nullptr && filter_.KeepMethod(dex_file_, it.GetMemberIndex()))
+            DumpMethod(worker, out, it.GetMemberIndex(), it.GetRawMemberAccessFlags(),
+                       code_item);
+    }
+}
+
+void CfgDumper::DumpMethod(Worker* worker, std::string* out, uint32_t dex_method_idx,
+                           uint32_t access_flags, const DexFile::CodeItem* code_item) const
+{
+    if (opt_granu_ == kGranuCodeReflection && !CallsReflection(code_item))
+        return;
+    StringAppendF(out, "%s (dex_method_idx=%u)",
+                  PrettyMethod(dex_method_idx, dex_file_, true).c_str(), dex_method_idx);
+    if (!worker->cfg_.Build(code_item)) {
+        *out += " invalid control flow\n";
+        return;
+    }
+    worker->dominance_.Compute(worker->cfg_);
+    if (opt_granu_ == kGranuCodeCfg) {
+        DumpCfg(*worker, out);
+        return;
+    }
+    if (opt_granu_ == kGranuCodeTypes) {
+        if (!worker->types_.Build(dex_file_, dex_method_idx, access_flags, code_item,
+                                  worker->cfg_)) {
+            *out += " invalid registers\n";
+            return;
+        }
+        DumpTypes(worker, out, code_item);
+        return;
+    }
+    if (!worker->ssa_.Build(dex_file_, dex_method_idx, access_flags, code_item, worker->cfg_,
+                            worker->dominance_)) {
+        *out += " invalid registers\n";
+        return;
+    }
+    if (opt_granu_ == kGranuCodeReflection) {
+        worker->constants_.Run(code_item, worker->cfg_, worker->ssa_);
+        DumpConstants(*worker, out, code_item);
+        return;
+    }
+    DumpSsa(*worker, out, code_item);
+}
+
+bool CfgDumper::CallsReflection(const DexFile::CodeItem* code_item) const
+{
+    // A plain scan of the instructions, so that most of the methods are
+    // skipped before building anything.
+    uint32_t insns_size = code_item->insns_size_in_code_units_;
+    for (uint32_t dex_pc = 0 ; dex_pc < insns_size ; ) {
+        const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+        if (inst->IsInvoke()) {
+            uint32_t method_idx = inst->VRegB();
+            if (method_idx < reflection_methods_.size() && reflection_methods_[method_idx])
+                return true;
+        }
+        dex_pc += inst->SizeInCodeUnits();
+    }
+    return false;
+}
+
+void CfgDumper::DumpCfg(const Worker& worker, std::string* out)
+{
+    const MethodCfg& cfg = worker.cfg_;
+    const Dominance& dominance = worker.dominance_;
+    const std::vector<Dominance::Loop>& loops = dominance.Loops();
+    StringAppendF(out, " blocks %u loops %zu irreducible %u\n", cfg.NumBlocks(), loops.size(),
+                  dominance.NumIrreducibleEdges());
+
+    for (uint32_t block = 0 ; block < cfg.NumBlocks() ; ++block) {
+        const MethodCfg::Block& range = cfg.GetBlock(block);
+        StringAppendF(out, "\tB%u [0x%04x, 0x%04x)", block, range.start_pc_, range.end_pc_);
+        if (!cfg.IsReachable(block)) {
+            *out += " unreachable\n";
+            continue;
+        }
+        AppendBlock(out, " idom ", dominance.ImmediateDominator(block));
+        AppendBlock(out, " ipdom ", dominance.ImmediatePostDominator(block));
+        StringAppendF(out, " depth %u", dominance.LoopDepth(block));
+
+        const char* prefix = " succ";
+        for (const MethodCfg::Edge& edge : cfg.Successors(block)) {
+            if (edge.kind_ != MethodCfg::kException) {
+                *out += prefix;
+                prefix = "";
+                AppendBlock(out, " ", edge.block_);
+            }
+        }
+        prefix = " catch";
+        for (const MethodCfg::Edge& edge : cfg.Successors(block)) {
+            if (edge.kind_ == MethodCfg::kException) {
+                *out += prefix;
+                prefix = "";
+                AppendBlock(out, " ", edge.block_);
+            }
+        }
+        *out += '\n';
+    }
+
+    const std::vector<uint32_t>& back_edges = dominance.BackEdges();
+    for (uint32_t idx = 0 ; idx < loops.size() ; ++idx) {
+        const Dominance::Loop& loop = loops[idx];
+        StringAppendF(out, "\tL%u header B%u depth %u parent ", idx, loop.header_, loop.depth_);
+        if (loop.parent_ == Dominance::kNone)
+            *out += '-';
+        else
+            StringAppendF(out, "L%u", loop.parent_);
+        StringAppendF(out, " blocks %u back", loop.num_blocks_);
+        for (uint32_t i = loop.back_edges_begin_ ; i < loop.back_edges_end_ ; ++i)
+            AppendBlock(out, " ", back_edges[i]);
+        *out += '\n';
+    }
+}
+
+void CfgDumper::DumpSsa(const Worker& worker, std::string* out,
+                        const DexFile::CodeItem* code_item) const
+{
+    const MethodCfg& cfg = worker.cfg_;
+    const MethodSsa& ssa = worker.ssa_;
+    uint32_t num_phis = ssa.PhisEnd(cfg.NumBlocks() - 1) - ssa.PhisBegin(0);
+    StringAppendF(out, " values %u phis %u\n", ssa.NumValues(), num_phis);
+
+    if (ssa.NumParameters() > 0) {
+        *out += "\tparams";
+        for (uint32_t value = 1 ; value <= ssa.NumParameters() ; ++value)
+            StringAppendF(out, " v%u=%%%u", ssa.GetValue(value).reg_, value);
+        *out += '\n';
+    }
+
+    const std::vector<MethodSsa::Insn>& insns = ssa.Insns();
+    uint32_t next_insn = 0;
+    for (uint32_t block = 0 ; block < cfg.NumBlocks() ; ++block) {
+        if (!cfg.IsReachable(block))
+            continue;
+        StringAppendF(out, "\tB%u\n", block);
+        for (uint32_t phi = ssa.PhisBegin(block) ; phi < ssa.PhisEnd(block) ; ++phi) {
+            StringAppendF(out, "\t\tphi v%u=%%%u", ssa.GetValue(phi).reg_, phi);
+            for (uint32_t operand : ssa.Operands(phi))
+                AppendValue(out, operand);
+            *out += '\n';
+        }
+
+        uint32_t end_pc = cfg.GetBlock(block).end_pc_;
+        for ( ; next_insn < insns.size() && insns[next_insn].dex_pc_ < end_pc ; ++next_insn) {
+            const MethodSsa::Insn& insn = insns[next_insn];
+            StringAppendF(out, "\t\t0x%04x: ", insn.dex_pc_);
+            if (insn.def_ != MethodSsa::kNoValue)
+                StringAppendF(out, "v%u=%%%u ", ssa.GetValue(insn.def_).reg_, insn.def_);
+            *out += Instruction::At(&code_item->insns_[insn.dex_pc_])->Name();
+            for (uint32_t use : ssa.Uses(insn))
+                AppendValue(out, use);
+            *out += '\n';
+        }
+    }
+}
+
+void CfgDumper::DumpTypes(Worker* worker, std::string* out,
+                          const DexFile::CodeItem* code_item) const
+{
+    const MethodCfg& cfg = worker->cfg_;
+    const RegisterTypes& types = worker->types_;
+    StringAppendF(out, " registers %u\n", code_item->registers_size_);
+
+    // Replay each block from its entry line.
+    std::vector<RegisterTypes::Type>& line = worker->line_;
+    for (uint32_t block = 0 ; block < cfg.NumBlocks() ; ++block) {
+        if (!cfg.IsReachable(block))
+            continue;
+        line.assign(types.EntryLine(block), types.EntryLine(block) + types.LineSize());
+        StringAppendF(out, "\tB%u", block);
+        for (uint32_t reg = 0 ; reg < code_item->registers_size_ ; ++reg) {
+            RegisterTypes::Kind kind = line[reg].kind_;
+            const char* name = RegisterTypes::Name(line[reg]);
+            if (kind != RegisterTypes::kUndefined && kind != RegisterTypes::kConflict &&
+                name != nullptr)
+                StringAppendF(out, " v%u=%s", reg, name);
+        }
+        *out += '\n';
+
+        const MethodCfg::Block& range = cfg.GetBlock(block);
+        for (uint32_t dex_pc = range.start_pc_ ; dex_pc < range.end_pc_ ; ) {
+            const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+            StringAppendF(out, "\t\t0x%04x: %s", dex_pc, inst->Name());
+            uint32_t reg = types.Apply(inst, dex_pc, line.data());
+            if (reg != RegisterTypes::kNoReg)
+                StringAppendF(out, " v%u=%s", reg, RegisterTypes::Name(line[reg]));
+            *out += '\n';
+            dex_pc += inst->SizeInCodeUnits();
+        }
+    }
+}
+
+void CfgDumper::DumpConstants(const Worker& worker, std::string* out,
+                              const DexFile::CodeItem* code_item) const
+{
+    // The arguments follow the shorty of the callee, a wide one taking two
+    // registers, after the receiver of a non static invoke.
+    const MethodCfg& cfg = worker.cfg_;
+    const MethodSsa& ssa = worker.ssa_;
+    const ConstantPropagation& constants = worker.constants_;
+    *out += '\n';
+    for (const MethodSsa::Insn& insn : ssa.Insns()) {
+        const Instruction* inst = Instruction::At(&code_item->insns_[insn.dex_pc_]);
+        if (!inst->IsInvoke() || !constants.IsExecutable(cfg.BlockOf(insn.dex_pc_)))
+            continue;
+        uint32_t method_idx = inst->VRegB();
+        if (method_idx >= dex_file_.NumMethodIds())
+            continue;
+        Range<uint32_t> uses = ssa.Uses(insn);
+        bool resolved = false;
+        for (uint32_t value : uses) {
+            ConstantPropagation::Kind kind = constants.ValueOf(value).kind_;
+            resolved |= kind != ConstantPropagation::kTop && kind != ConstantPropagation::kBottom;
+        }
+        if (!resolved)
+            continue;
+
+        StringAppendF(out, "\t0x%04x: %s", insn.dex_pc_,
+                      PrettyMethod(method_idx, dex_file_, true).c_str());
+        Instruction::Code opcode = inst->Opcode();
+        uint32_t pos = 0;
+        if (opcode != Instruction::INVOKE_STATIC && opcode != Instruction::INVOKE_STATIC_RANGE)
+            AppendConstant(out, constants.ValueOf(uses.begin()[pos++]));
+        const char* shorty = dex_file_.GetMethodShorty(dex_file_.GetMethodId(method_idx));
+        for (const char* param = shorty + 1 ; *param != '\0' && pos < uses.size() ; ++param) {
+            AppendConstant(out, constants.ValueOf(uses.begin()[pos]));
+            pos += (*param == 'J' || *param == 'D')? 2 : 1;
+        }
+        *out += '\n';
+    }
+}
+
+void CfgDumper::AppendConstant(std::string* out,
+                               const ConstantPropagation::Constant& constant) const
+{
+    switch (constant.kind_) {
+      case ConstantPropagation::kInteger:
+        StringAppendF(out, " %" PRId64, constant.bits_);
+        break;
+      case ConstantPropagation::kLong:
+        StringAppendF(out, " %" PRId64 "L", constant.bits_);
+        break;
+      case ConstantPropagation::kString:
+        *out += ' ';
+        AppendPrintableString(out, dex_file_.StringDataByIdx(constant.bits_));
+        break;
+      default:
+        *out += " ?";
+        break;
+    }
+}
+
+void CfgDumper::AppendBlock(std::string* out, const char* prefix, uint32_t block)
+{
+    if (block == Dominance::kNone)
+        StringAppendF(out, "%s-", prefix);
+    else
+        StringAppendF(out, "%sB%u", prefix, block);
+}
+
+void CfgDumper::AppendValue(std::string* out, uint32_t value)
+{
+    if (value == MethodSsa::kUndefinedValue)
+        *out += " undef";
+    else
+        StringAppendF(out, " %%%u", value);
+}
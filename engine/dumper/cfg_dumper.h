@@ -0,0 +1,119 @@
+#ifndef _DUMPER_CFG_DUMPER_H_
+#define _DUMPER_CFG_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dump_filter.h"
+#include "method_cfg.h"
+#include "dominance.h"
+#include "method_ssa.h"
+#include "register_types.h"
+#include "constant_propagation.h"
+
+
+// Dump the analyses of the control flow of each kept code item. The classes
+// are handed out to the workers in chunks, each worker rebuilding its own
+// analyses in place, and the chunks of a round are written in class_def
+// order once all of them are rendered.
+//
+// The cfg granularity gives the blocks with their dominators,
+// post-dominators and loop nest:
+//
+//   int C0.foo(int, long) (dex_method_idx=53) blocks 8 loops 1 irreducible 0
+//       B0 [0x0000, 0x0005) idom - ipdom B1 depth 0 succ B1
+//       B1 [0x0005, 0x0007) idom B0 ipdom B3 depth 1 succ B2 B3
+//       B2 [0x0007, 0x000e) idom B1 ipdom B1 depth 1 succ B1
+//       B3 [0x000e, 0x0011) idom B1 ipdom - depth 0 succ B4 B5 B6
+//       ...
+//       B7 [0x0018, 0x0020) unreachable
+//       L0 header B1 depth 1 parent - blocks 2 back B2
+//
+// The exceptional successors are listed after "catch". A block only
+// post-dominated by the virtual exit shows no immediate post-dominator.
+//
+// The ssa granularity gives the parameters, then the phis and the
+// instructions of the reachable blocks, with the register and the value
+// written and the values read:
+//
+//   int C0.foo(int, long) (dex_method_idx=53) values 13 phis 1
+//       params v4=%1 v5=%2 v6=%3
+//       B0
+//           0x0000: v0=%5 const/4
+//           ...
+//       B1
+//           phi v0=%4 %7 %11
+//           0x0005: if-eqz %4
+//
+// A read of a register never written on some path shows undef.
+//
+// The types granularity gives the types of the registers at the entry of
+// each reachable block, then the type written by each instruction:
+//
+//   int C0.foo(int, long) (dex_method_idx=53) registers 8
+//       B0 v4=Lcom/target/app/C0; v5=I v6=J
+//           0x0000: const/4 v0=const
+//           ...
+//
+// The undefined and conflicting registers are left out of the block lines.
+//
+// The reflection granularity only keeps the methods invoking a method of
+// java.lang.Class, java.lang.ClassLoader, java.lang.reflect or
+// dalvik.system, found by a plain scan of their code. It propagates the
+// constants over their SSA form and gives each invoke with a constant
+// argument, the receiver first, unresolved arguments showing "?":
+//
+//   void C0.run() (dex_method_idx=55)
+//       0x0004: java.lang.Class java.lang.Class.forName(java.lang.String) "com.foo.Bar"
+//       0x000e: java.lang.String C0.decode(java.lang.String, int) ? "eW8=" 3
+class CfgDumper
+{
+  public:
+    // The filter is not owned and must outlive the dumper.
+    CfgDumper(const DexFile& dex_file, char opt_granu, const DumpFilter& filter);
+
+    bool Dump(OutputSink& sink, ThreadPool* pool) WARN_UNUSED;
+
+  private:
+    // The analyses of a worker, rebuilt for each method.
+    struct Worker
+    {
+        MethodCfg cfg_;
+        Dominance dominance_;
+        MethodSsa ssa_;
+        RegisterTypes types_;
+        std::vector<RegisterTypes::Type> line_;
+        ConstantPropagation constants_;
+    };
+
+    void DumpClass(Worker* worker, std::string* out, uint32_t class_def_idx) const;
+    void DumpMethod(Worker* worker, std::string* out, uint32_t dex_method_idx,
+                    uint32_t access_flags, const DexFile::CodeItem* code_item) const;
+    static void DumpCfg(const Worker& worker, std::string* out);
+    void DumpSsa(const Worker& worker, std::string* out,
+                 const DexFile::CodeItem* code_item) const;
+    void DumpTypes(Worker* worker, std::string* out, const DexFile::CodeItem* code_item) const;
+    bool CallsReflection(const DexFile::CodeItem* code_item) const;
+    void DumpConstants(const Worker& worker, std::string* out,
+                       const DexFile::CodeItem* code_item) const;
+    void AppendConstant(std::string* out, const ConstantPropagation::Constant& constant) const;
+
+    static void AppendBlock(std::string* out, const char* prefix, uint32_t block);
+    static void AppendValue(std::string* out, uint32_t value);
+
+    const DexFile& dex_file_;
+    const char opt_granu_;
+    const DumpFilter& filter_;
+
+    // The method ids of the reflection classes, for the reflection
+    // granularity.
+    std::vector<bool> reflection_methods_;
+
+    DISALLOW_COPY_AND_ASSIGN(CfgDumper);
+};
+
+#endif
@@ -0,0 +1,273 @@
+#include <algorithm>
+
+#include "class_hierarchy.h"
+#include "modifiers.h"
+#include "dex_file-inl.h"
+#include "misc.h"
+
+
+constexpr uint32_t ClassHierarchy::kNoClass;
+constexpr uint32_t ClassHierarchy::kNoInterface;
+
+
+ClassHierarchy::ClassHierarchy()
+  : num_interfaces_(0),
+    interface_words_(0),
+    vtable_offsets_(1, 0)
+{}
+
+void ClassHierarchy::Build(const std::vector<const DexFile*>& dex_files)
+{
+    for (const DexFile* dex_file : dex_files) {
+        uint32_t num_class_def = dex_file->NumClassDefs();
+        for (uint32_t class_def_idx = 0 ; class_def_idx < num_class_def ; ++class_def_idx) {
+            const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_idx);
+            uint32_t class_id = InternClass(dex_file->GetClassDescriptor(class_def));
+            if (defs_[class_id].dex_file_ != nullptr)
+                continue;
+            defs_[class_id].dex_file_ = dex_file;
+            defs_[class_id].class_def_ = &class_def;
+            if ((class_def.access_flags_ & kAccInterface) != 0)
+                InternInterface(class_id);
+
+            if (class_def.superclass_idx_ != DexFile::kDexNoIndex16) {
+                uint32_t super = InternClass(dex_file->StringByTypeIdx(class_def.superclass_idx_));
+                if (super != class_id)
+                    superclasses_[class_id] = super;
+            }
+            const DexFile::TypeList* interfaces = dex_file->GetInterfacesList(class_def);
+            if (interfaces == nullptr)
+                continue;
+            for (uint32_t i = 0 ; i < interfaces->Size() ; ++i) {
+                uint16_t type_idx = interfaces->GetTypeItem(i).type_idx_;
+                uint32_t interface = InternClass(dex_file->StringByTypeIdx(type_idx));
+                InternInterface(interface);
+                if (interface != class_id)
+                    direct_interfaces_[class_id].push_back(interface);
+            }
+        }
+    }
+
+    NumberForest();
+    std::vector<uint32_t> order = DependencyOrder();
+    FillInterfaceSets(order);
+    FillVirtualMethods(order);
+}
+
+uint32_t ClassHierarchy::FindClass(const std::string& descriptor) const
+{
+    auto iter = class_ids_.find(descriptor);
+    return (iter != class_ids_.end())? iter->second : kNoClass;
+}
+
+bool ClassHierarchy::Implements(uint32_t class_id, uint32_t interface_class_id) const
+{
+    uint32_t interface_id = interface_ids_[interface_class_id];
+    if (interface_id == kNoInterface)
+        return false;
+    uint64_t word = interface_sets_[class_id * interface_words_ + interface_id / 64];
+    return (word >> (interface_id % 64)) & 1;
+}
+
+void ClassHierarchy::GetInterfaces(uint32_t class_id, std::vector<uint32_t>* interfaces) const
+{
+    interfaces->clear();
+    const uint64_t* words = interface_sets_.data() + class_id * interface_words_;
+    for (uint32_t i = 0 ; i < interface_words_ ; ++i) {
+        for (uint64_t word = words[i] ; word != 0 ; word &= word - 1)
+            interfaces->push_back(interface_classes_[i * 64 + __builtin_ctzll(word)]);
+    }
+    std::sort(interfaces->begin(), interfaces->end());
+}
+
+uint32_t ClassHierarchy::InternClass(const char* descriptor)
+{
+    auto iter = class_ids_.find(descriptor);
+    if (iter != class_ids_.end())
+        return iter->second;
+
+    uint32_t class_id = descriptors_.size();
+    class_ids_.emplace(descriptor, class_id);
+    descriptors_.emplace_back(descriptor);
+    ClassDefRef def = {nullptr, nullptr};
+    defs_.push_back(def);
+    superclasses_.push_back(kNoClass);
+    direct_interfaces_.emplace_back();
+    interface_ids_.push_back(kNoInterface);
+    return class_id;
+}
+
+uint32_t ClassHierarchy::InternInterface(uint32_t class_id)
+{
+    if (interface_ids_[class_id] == kNoInterface) {
+        interface_ids_[class_id] = num_interfaces_++;
+        interface_classes_.push_back(class_id);
+    }
+    return interface_ids_[class_id];
+}
+
+void ClassHierarchy::NumberForest()
+{
+    uint32_t num_classes = NumClasses();
+    std::vector<std::pair<uint32_t, uint32_t>> edges;  // (superclass, class)
+    for (uint32_t class_id = 0 ; class_id < num_classes ; ++class_id) {
+        if (superclasses_[class_id] != kNoClass)
+            edges.emplace_back(superclasses_[class_id], class_id);
+    }
+    std::vector<uint32_t> child_offsets;
+    std::vector<uint32_t> children;
+    Bucket(edges, num_classes, &child_offsets, &children);
+
+    // Walk from the roots first, then from whatever a superclass cycle left
+    // unvisited, so that every class is numbered once.
+    preorder_.assign(num_classes, kNoClass);
+    last_.assign(num_classes, 0);
+    uint32_t counter = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> stack;  // (class, next child)
+    for (uint32_t pass = 0 ; pass < 2 ; ++pass) {
+        for (uint32_t root = 0 ; root < num_classes ; ++root) {
+            if (preorder_[root] != kNoClass)
+                continue;
+            if (pass == 0 && superclasses_[root] != kNoClass)
+                continue;
+            preorder_[root] = counter++;
+            stack.emplace_back(root, child_offsets[root]);
+            while (!stack.empty()) {
+                uint32_t class_id = stack.back().first;
+                uint32_t& next = stack.back().second;
+                if (next == child_offsets[class_id + 1]) {
+                    last_[class_id] = counter - 1;
+                    stack.pop_back();
+                    continue;
+                }
+                uint32_t child = children[next++];
+                if (preorder_[child] != kNoClass)
+                    continue;
+                preorder_[child] = counter++;
+                stack.emplace_back(child, child_offsets[child]);
+            }
+        }
+    }
+}
+
+std::vector<uint32_t> ClassHierarchy::DependencyOrder() const
+{
+    uint32_t num_classes = NumClasses();
+    std::vector<uint32_t> num_deps(num_classes, 0);
+    std::vector<std::vector<uint32_t>> dependents(num_classes);
+    for (uint32_t class_id = 0 ; class_id < num_classes ; ++class_id) {
+        if (superclasses_[class_id] != kNoClass) {
+            dependents[superclasses_[class_id]].push_back(class_id);
+            ++num_deps[class_id];
+        }
+        for (uint32_t interface : direct_interfaces_[class_id]) {
+            dependents[interface].push_back(class_id);
+            ++num_deps[class_id];
+        }
+    }
+
+    std::vector<uint32_t> order;
+    std::vector<bool> placed(num_classes, false);
+    for (uint32_t class_id = 0 ; class_id < num_classes ; ++class_id) {
+        if (num_deps[class_id] == 0) {
+            order.push_back(class_id);
+            placed[class_id] = true;
+        }
+    }
+    for (uint32_t head = 0 ; head < order.size() ; ++head) {
+        for (uint32_t dependent : dependents[order[head]]) {
+            if (--num_deps[dependent] == 0) {
+                order.push_back(dependent);
+                placed[dependent] = true;
+            }
+        }
+    }
+
+    // The classes in a cycle come last, with their sets partially merged.
+    for (uint32_t class_id = 0 ; class_id < num_classes ; ++class_id) {
+        if (!placed[class_id])
+            order.push_back(class_id);
+    }
+    return order;
+}
+
+void ClassHierarchy::FillInterfaceSets(const std::vector<uint32_t>& order)
+{
+    interface_words_ = (num_interfaces_ + 63) / 64;
+    interface_sets_.assign(static_cast<size_t>(NumClasses()) * interface_words_, 0);
+    for (uint32_t class_id : order) {
+        uint64_t* set = &interface_sets_[class_id * interface_words_];
+        uint32_t super = superclasses_[class_id];
+        if (super != kNoClass) {
+            const uint64_t* super_set = &interface_sets_[super * interface_words_];
+            for (uint32_t word = 0 ; word < interface_words_ ; ++word)
+                set[word] |= super_set[word];
+        }
+        for (uint32_t interface : direct_interfaces_[class_id]) {
+            uint32_t interface_id = interface_ids_[interface];
+            set[interface_id / 64] |= UINT64_C(1) << (interface_id % 64);
+            const uint64_t* interface_set = &interface_sets_[interface * interface_words_];
+            for (uint32_t word = 0 ; word < interface_words_ ; ++word)
+                set[word] |= interface_set[word];
+        }
+    }
+}
+
+void ClassHierarchy::FillVirtualMethods(const std::vector<uint32_t>& order)
+{
+    uint32_t num_classes = NumClasses();
+    std::vector<std::vector<uint32_t>> vtables(num_classes);
+    std::unordered_map<std::string, uint32_t> signature_ids;
+    std::vector<uint32_t> method_signatures;  // the signature id of each method id
+    std::unordered_map<uint32_t, uint32_t> slots;  // signature id to vtable slot
+    std::string signature;
+
+    for (uint32_t class_id : order) {
+        std::vector<uint32_t>& vtable = vtables[class_id];
+        if (superclasses_[class_id] != kNoClass)
+            vtable = vtables[superclasses_[class_id]];
+        const ClassDefRef& def = defs_[class_id];
+        if (def.dex_file_ == nullptr)
+            continue;
+        const byte* class_data = def.dex_file_->GetClassData(*def.class_def_);
+        if (class_data == nullptr)
+            continue;
+
+        slots.clear();
+        for (uint32_t slot = 0 ; slot < vtable.size() ; ++slot)
+            slots[method_signatures[vtable[slot]]] = slot;
+
+        const DexFile& dex_file = *def.dex_file_;
+        ClassDataItemIterator it(dex_file, class_data);
+        SkipAllFields(it);
+        while (it.HasNextDirectMethod())
+            it.Next();
+        for ( ; it.HasNextVirtualMethod() ; it.Next()) {
+            if (it.GetMemberIndex() >= dex_file.NumMethodIds())
+                continue;
+            const DexFile::MethodId& method_id = dex_file.GetMethodId(it.GetMemberIndex());
+            signature = dex_file.GetMethodName(method_id);
+            signature += dex_file.GetMethodSignature(method_id).ToString();
+            auto iter = signature_ids.emplace(signature, signature_ids.size()).first;
+
+            uint32_t method = method_keys_.size();
+            method_keys_.push_back(descriptors_[class_id] + "->" + signature);
+            method_signatures.push_back(iter->second);
+            auto slot = slots.find(iter->second);
+            if (slot != slots.end())
+                vtable[slot->second] = method;
+            else {
+                slots.emplace(iter->second, vtable.size());
+                vtable.push_back(method);
+            }
+        }
+    }
+
+    vtable_offsets_.assign(num_classes + 1, 0);
+    vtable_entries_.clear();
+    for (uint32_t class_id = 0 ; class_id < num_classes ; ++class_id) {
+        vtable_entries_.insert(vtable_entries_.end(), vtables[class_id].begin(),
+                               vtables[class_id].end());
+        vtable_offsets_[class_id + 1] = vtable_entries_.size();
+    }
+}
@@ -0,0 +1,160 @@
+#ifndef _DUMPER_CLASS_HIERARCHY_H_
+#define _DUMPER_CLASS_HIERARCHY_H_
+
+
+#include <unordered_map>
+
+#include "globals.h"
+#include "macros.h"
+#include "range.h"
+
+#include "dex_file.h"
+
+
+// The class hierarchy over one or more dex files. Every class defined or
+// referred as a superclass or an interface gets a dense id in the order it
+// is first met, file by file in class_def order, and is identified across
+// the files by its descriptor. The first file defining a class wins, and the
+// classes no file defines, such as the framework ones, are kept as external
+// classes with no known superclass.
+//
+// The superclass forest is numbered by a preorder walk, so that the classes
+// inheriting from c are exactly those whose preorder number falls in
+// [pre(c), last(c)], and IsSubclass() is two comparisons. The interfaces get
+// their own dense ids, and each class holds a bitset of all the interfaces
+// it implements, directly or through its superclasses and superinterfaces.
+//
+// The virtual method table of a class is the table of its superclass, with
+// the slots of the overridden methods replaced by the overriding ones and
+// the new virtual methods appended. The methods are matched by name and
+// signature; the package private visibility is not modeled.
+class ClassHierarchy
+{
+  public:
+    static constexpr uint32_t kNoClass = 0xFFFFFFFF;
+    static constexpr uint32_t kNoInterface = 0xFFFFFFFF;
+
+    ClassHierarchy();
+
+    // Build the hierarchy of the given files. The files are not owned and
+    // must outlive the hierarchy.
+    void Build(const std::vector<const DexFile*>& dex_files);
+
+    uint32_t NumClasses() const
+    {
+        return descriptors_.size();
+    }
+
+    // Returns the id of the class of the given descriptor, or kNoClass.
+    uint32_t FindClass(const std::string& descriptor) const;
+
+    const std::string& Descriptor(uint32_t class_id) const
+    {
+        return descriptors_[class_id];
+    }
+
+    bool IsDefined(uint32_t class_id) const
+    {
+        return defs_[class_id].dex_file_ != nullptr;
+    }
+
+    bool IsInterface(uint32_t class_id) const
+    {
+        return interface_ids_[class_id] != kNoInterface;
+    }
+
+    // Returns the superclass, or kNoClass for the roots and the external
+    // classes.
+    uint32_t Superclass(uint32_t class_id) const
+    {
+        return superclasses_[class_id];
+    }
+
+    // Returns true if sub is super or inherits from it.
+    bool IsSubclass(uint32_t sub, uint32_t super) const
+    {
+        return preorder_[super] <= preorder_[sub] && preorder_[sub] <= last_[super];
+    }
+
+    // Returns true if the class implements the interface, directly or not.
+    bool Implements(uint32_t class_id, uint32_t interface_class_id) const;
+
+    // Fill the interfaces the class implements, directly or not, in class id
+    // order, by a walk of the set bits of its bitset.
+    void GetInterfaces(uint32_t class_id, std::vector<uint32_t>* interfaces) const;
+
+    // Returns true if a value of type sub can be assigned to type super.
+    bool IsSubtype(uint32_t sub, uint32_t super) const
+    {
+        return IsSubclass(sub, super) || Implements(sub, super);
+    }
+
+    // Returns the preorder number and the last preorder number of the
+    // subtree of the class in the superclass forest.
+    uint32_t Preorder(uint32_t class_id) const
+    {
+        return preorder_[class_id];
+    }
+
+    uint32_t LastDescendant(uint32_t class_id) const
+    {
+        return last_[class_id];
+    }
+
+    // Returns the virtual method table of the class, as method ids.
+    Range<uint32_t> VirtualMethods(uint32_t class_id) const
+    {
+        const uint32_t* base = vtable_entries_.data();
+        return Range<uint32_t>(base + vtable_offsets_[class_id],
+                               base + vtable_offsets_[class_id + 1]);
+    }
+
+    // Returns the key of a method of a virtual method table, such as
+    // "Lcom/a/B;->run(I)V".
+    const std::string& MethodKey(uint32_t method_id) const
+    {
+        return method_keys_[method_id];
+    }
+
+  private:
+    // The definition of a class.
+    struct ClassDefRef
+    {
+        const DexFile* dex_file_;
+        const DexFile::ClassDef* class_def_;
+    };
+
+    uint32_t InternClass(const char* descriptor);
+    uint32_t InternInterface(uint32_t class_id);
+
+    // Returns the classes in an order where each follows its superclass and
+    // its direct interfaces, cycles aside.
+    std::vector<uint32_t> DependencyOrder() const;
+
+    void NumberForest();
+    void FillInterfaceSets(const std::vector<uint32_t>& order);
+    void FillVirtualMethods(const std::vector<uint32_t>& order);
+
+    std::vector<std::string> descriptors_;
+    std::unordered_map<std::string, uint32_t> class_ids_;
+    std::vector<ClassDefRef> defs_;
+    std::vector<uint32_t> superclasses_;
+    std::vector<std::vector<uint32_t>> direct_interfaces_;
+
+    std::vector<uint32_t> preorder_;
+    std::vector<uint32_t> last_;
+
+    std::vector<uint32_t> interface_ids_;  // per class, kNoInterface if none
+    std::vector<uint32_t> interface_classes_;  // per interface id
+    uint32_t num_interfaces_;
+    uint32_t interface_words_;  // the number of uint64_t per class bitset
+    std::vector<uint64_t> interface_sets_;
+
+    std::vector<uint32_t> vtable_offsets_;  // of size NumClasses() + 1
+    std::vector<uint32_t> vtable_entries_;
+    std::vector<std::string> method_keys_;
+
+    DISALLOW_COPY_AND_ASSIGN(ClassHierarchy);
+};
+
+#endif
@@ -0,0 +1,44 @@
+#include "class_hierarchy_dumper.h"
+#include "stringprintf.h"
+#include "class_hierarchy.h"
+
+
+ClassHierarchyDumper::ClassHierarchyDumper(const std::vector<const DexFile*>& dex_files)
+  : dex_files_(dex_files)
+{}
+
+bool ClassHierarchyDumper::Dump(OutputSink& sink)
+{
+    ClassHierarchy hierarchy;
+    hierarchy.Build(dex_files_);
+
+    std::vector<uint32_t> interfaces;
+    uint32_t num_classes = hierarchy.NumClasses();
+    std::string buf;
+    for (uint32_t class_id = 0 ; class_id < num_classes ; ++class_id) {
+        if (!hierarchy.IsDefined(class_id))
+            continue;
+        StringAppendF(&buf, "%s %s [%u, %u]",
+                      (hierarchy.IsInterface(class_id))? "interface" : "class",
+                      hierarchy.Descriptor(class_id).c_str(), hierarchy.Preorder(class_id),
+                      hierarchy.LastDescendant(class_id));
+        uint32_t super = hierarchy.Superclass(class_id);
+        if (super != ClassHierarchy::kNoClass)
+            StringAppendF(&buf, " extends %s", hierarchy.Descriptor(super).c_str());
+        buf += '\n';
+        hierarchy.GetInterfaces(class_id, &interfaces);
+        for (uint32_t interface : interfaces)
+            StringAppendF(&buf, "\timplements %s\n", hierarchy.Descriptor(interface).c_str());
+        Range<uint32_t> vtable = hierarchy.VirtualMethods(class_id);
+        for (uint32_t slot = 0 ; slot < vtable.size() ; ++slot)
+            StringAppendF(&buf, "\tvtable[%u] %s\n", slot,
+                          hierarchy.MethodKey(vtable.begin()[slot]).c_str());
+        buf += '\n';
+        if (buf.size() >= kBufferSize) {
+            if (!sink.Write(buf))
+                return false;
+            buf.clear();
+        }
+    }
+    return sink.Write(buf);
+}
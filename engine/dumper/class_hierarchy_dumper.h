@@ -0,0 +1,41 @@
+#ifndef _DUMPER_CLASS_HIERARCHY_DUMPER_H_
+#define _DUMPER_CLASS_HIERARCHY_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+
+#include "dex_file.h"
+
+
+// List the classes defined by the dex files, in the order of their ids in
+// the ClassHierarchy, each with its preorder interval in the superclass
+// forest and its superclass, followed by every interface it implements,
+// directly or not, and by its virtual method table:
+//
+//   class Lcom/a/B; [1, 654] extends Ljava/lang/Object;
+//   	implements Ljava/lang/Runnable;
+//   	vtable[0] Lcom/a/B;->bar(Ljava/lang/String;)Ljava/lang/String;
+//   	vtable[1] Lcom/a/B;->run()V
+//
+// The classes no file defines, such as the framework ones, are only named as
+// superclasses and interfaces.
+class ClassHierarchyDumper
+{
+  public:
+    // The number of bytes of text held before writing them.
+    static constexpr size_t kBufferSize = 64 * KB;
+
+    // The files are not owned and must outlive the dumper.
+    explicit ClassHierarchyDumper(const std::vector<const DexFile*>& dex_files);
+
+    bool Dump(OutputSink& sink) WARN_UNUSED;
+
+  private:
+    const std::vector<const DexFile*>& dex_files_;
+
+    DISALLOW_COPY_AND_ASSIGN(ClassHierarchyDumper);
+};
+
+#endif
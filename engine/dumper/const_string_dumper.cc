@@ -0,0 +1,79 @@
+#include <algorithm>
+
+#include "const_string_dumper.h"
+#include "misc.h"
+#include "stringprintf.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+
+
+ConstStringDumper::ConstStringDumper(const DexFile& dex_file, const DumpFilter& filter)
+  : dex_file_(dex_file),
+    filter_(filter)
+{}
+
+bool ConstStringDumper::Dump(OutputSink& sink)
+{
+    uint32_t num_class_def = dex_file_.NumClassDefs();
+    for (uint32_t class_def_idx = 0 ; class_def_idx < num_class_def ; ++class_def_idx) {
+        if (!filter_.KeepClass(dex_file_, class_def_idx))
+            continue;
+        const byte* class_data = dex_file_.GetClassData(dex_file_.GetClassDef(class_def_idx));
+        if (class_data == nullptr)
+            continue;
+        ClassDataItemIterator it(dex_file_, class_data);
+        SkipAllFields(it);
+        for ( ; it.HasNext() ; it.Next()) {
+            const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+            if (code_item != nullptr && filter_.KeepMethod(dex_file_, it.GetMemberIndex()))
+                ScanCode(it.GetMemberIndex(), code_item);
+        }
+    }
+
+    std::vector<uint32_t> string_idxs;
+    string_idxs.reserve(loads_.size());
+    for (const auto& load : loads_)
+        string_idxs.push_back(load.first);
+    std::sort(string_idxs.begin(), string_idxs.end());
+
+    std::string buf;
+    for (uint32_t string_idx : string_idxs) {
+        StringAppendF(&buf, "%u\t%s\t", string_idx,
+                      PrintableString(dex_file_.StringDataByIdx(string_idx)).c_str());
+        const std::vector<uint32_t>& methods = loads_[string_idx];
+        for (uint32_t i = 0 ; i < methods.size() ; ++i)
+            StringAppendF(&buf, (i == 0)? "%u" : " %u", methods[i]);
+        buf += '\n';
+        if (buf.size() >= kBufferSize) {
+            if (!sink.Write(buf))
+                return false;
+            buf.clear();
+        }
+    }
+    return sink.Write(buf);
+}
+
+void ConstStringDumper::ScanCode(uint32_t dex_method_idx, const DexFile::CodeItem* code_item)
+{
+    uint32_t dex_pc = 0;
+    while (dex_pc < code_item->insns_size_in_code_units_) {
+        const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+        Instruction::Code opcode = inst->Opcode();
+        if (opcode == Instruction::CONST_STRING)
+            AddLoad(inst->VRegB_21c(), dex_method_idx);
+        else if (opcode == Instruction::CONST_STRING_JUMBO)
+            AddLoad(inst->VRegB_31c(), dex_method_idx);
+        dex_pc += inst->SizeInCodeUnits();
+    }
+}
+
+void ConstStringDumper::AddLoad(uint32_t string_idx, uint32_t dex_method_idx)
+{
+    if (string_idx >= dex_file_.NumStringIds())
+        return;
+    // The methods are scanned one at a time, so a repeated load of the same
+    // method can only be the last one recorded.
+    std::vector<uint32_t>& methods = loads_[string_idx];
+    if (methods.empty() || methods.back() != dex_method_idx)
+        methods.push_back(dex_method_idx);
+}
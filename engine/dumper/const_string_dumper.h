@@ -0,0 +1,50 @@
+#ifndef _DUMPER_CONST_STRING_DUMPER_H_
+#define _DUMPER_CONST_STRING_DUMPER_H_
+
+
+#include <unordered_map>
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "dump_filter.h"
+
+
+// Extract the strings loaded by const-string and const-string/jumbo from the
+// kept methods. Only the opcode of each instruction is examined, and nothing
+// but the loaded strings is formatted. Each string is listed once, in
+// string_idx order, with the methods loading it:
+//
+//   72	"http://evil.example.com/c2"	52 55
+//
+// where the columns are the string_idx, the printable string and the
+// dex_method_idx of the loading methods in visiting order, tab separated.
+class ConstStringDumper
+{
+  public:
+    // The number of bytes of text buffered before writing them.
+    static constexpr size_t kBufferSize = 64 * KB;
+
+    // The filter is not owned and must outlive the dumper.
+    ConstStringDumper(const DexFile& dex_file, const DumpFilter& filter);
+
+    bool Dump(OutputSink& sink) WARN_UNUSED;
+
+  private:
+    void ScanCode(uint32_t dex_method_idx, const DexFile::CodeItem* code_item);
+    void AddLoad(uint32_t string_idx, uint32_t dex_method_idx);
+
+    const DexFile& dex_file_;
+    const DumpFilter& filter_;
+
+    // The loading methods of each string seen so far, deduplicated by
+    // string_idx since the string_ids of a dex file are unique.
+    std::unordered_map<uint32_t, std::vector<uint32_t>> loads_;
+
+    DISALLOW_COPY_AND_ASSIGN(ConstStringDumper);
+};
+
+#endif
@@ -0,0 +1,395 @@
+#include <algorithm>
+
+#include "constant_propagation.h"
+#include "dex_instruction-inl.h"
+
+
+constexpr uint32_t ConstantPropagation::kPhiUser;
+
+
+// Fold an int operation, numbered as in the runs of the binary operations
+// from add-int: add, sub, mul, div, rem, and, or, xor, shl, shr, ushr. The
+// division of the smallest value by -1 wraps around as in Java.
+static bool FoldInt(uint32_t op, int32_t lhs, int32_t rhs, int32_t* result)
+{
+    uint32_t a = lhs, b = rhs;
+    switch (op) {
+      case 0: *result = a + b; return true;
+      case 1: *result = a - b; return true;
+      case 2: *result = a * b; return true;
+      case 3:
+      case 4:
+        if (rhs == 0)
+            return false;
+        if (rhs == -1)
+            *result = (op == 3)? 0 - a : 0;
+        else
+            *result = (op == 3)? lhs / rhs : lhs % rhs;
+        return true;
+      case 5: *result = a & b; return true;
+      case 6: *result = a | b; return true;
+      case 7: *result = a ^ b; return true;
+      case 8: *result = a << (b & 0x1f); return true;
+      case 9: *result = lhs >> (b & 0x1f); return true;
+      case 10: *result = a >> (b & 0x1f); return true;
+      default: return false;
+    }
+}
+
+static bool FoldLong(uint32_t op, int64_t lhs, int64_t rhs, int64_t* result)
+{
+    uint64_t a = lhs, b = rhs;
+    switch (op) {
+      case 0: *result = a + b; return true;
+      case 1: *result = a - b; return true;
+      case 2: *result = a * b; return true;
+      case 3:
+      case 4:
+        if (rhs == 0)
+            return false;
+        if (rhs == -1)
+            *result = (op == 3)? 0 - a : 0;
+        else
+            *result = (op == 3)? lhs / rhs : lhs % rhs;
+        return true;
+      case 5: *result = a & b; return true;
+      case 6: *result = a | b; return true;
+      case 7: *result = a ^ b; return true;
+      case 8: *result = a << (b & 0x3f); return true;
+      case 9: *result = lhs >> (b & 0x3f); return true;
+      case 10: *result = a >> (b & 0x3f); return true;
+      default: return false;
+    }
+}
+
+
+void ConstantPropagation::Run(const DexFile::CodeItem* code_item, const MethodCfg& cfg,
+                              const MethodSsa& ssa)
+{
+    // The values defined by no instruction, the undefined one and the
+    // parameters, are varying, the phis and the definitions start unknown.
+    Constant top = {kTop, 0};
+    Constant bottom = {kBottom, 0};
+    values_.assign(ssa.NumValues(), top);
+    for (uint32_t value = 0 ; value <= ssa.NumParameters() ; ++value)
+        values_[value] = bottom;
+
+    uint32_t num_blocks = cfg.NumBlocks();
+    visited_.assign(num_blocks, false);
+    edge_offsets_.resize(num_blocks + 1);
+    edge_offsets_[0] = 0;
+    for (uint32_t block = 0 ; block < num_blocks ; ++block)
+        edge_offsets_[block + 1] = edge_offsets_[block] + cfg.Predecessors(block).size();
+    executable_.assign(edge_offsets_[num_blocks], false);
+    FillUsers(cfg, ssa);
+
+    flow_worklist_.assign(1, std::make_pair(MethodCfg::kNoBlock, 0));
+    value_worklist_.clear();
+    while (!flow_worklist_.empty() || !value_worklist_.empty()) {
+        while (!flow_worklist_.empty()) {
+            uint32_t target = flow_worklist_.back().second;
+            flow_worklist_.pop_back();
+            if (!visited_[target])
+                VisitBlock(code_item, cfg, ssa, target);
+            else {
+                for (uint32_t phi = ssa.PhisBegin(target) ; phi < ssa.PhisEnd(target) ; ++phi)
+                    EvaluatePhi(ssa, phi);
+            }
+        }
+        while (!value_worklist_.empty()) {
+            uint32_t value = value_worklist_.back();
+            value_worklist_.pop_back();
+            for (uint32_t i = user_offsets_[value] ; i < user_offsets_[value + 1] ; ++i) {
+                uint32_t user = users_[i];
+                if ((user & kPhiUser) != 0)
+                    EvaluatePhi(ssa, user & ~kPhiUser);
+                else if (visited_[cfg.BlockOf(ssa.Insns()[user].dex_pc_)])
+                    EvaluateInsn(code_item, cfg, ssa, user);
+            }
+        }
+    }
+}
+
+void ConstantPropagation::FillUsers(const MethodCfg& cfg, const MethodSsa& ssa)
+{
+    // Count the uses of each value, then scatter the users into their rows,
+    // which moves each offset to the start of the next row.
+    uint32_t num_values = ssa.NumValues();
+    uint32_t phis_begin = ssa.PhisBegin(0);
+    uint32_t phis_end = ssa.PhisEnd(cfg.NumBlocks() - 1);
+    const std::vector<MethodSsa::Insn>& insns = ssa.Insns();
+    user_offsets_.assign(num_values + 1, 0);
+    for (const MethodSsa::Insn& insn : insns) {
+        for (uint32_t value : ssa.Uses(insn))
+            ++user_offsets_[value + 1];
+    }
+    for (uint32_t phi = phis_begin ; phi < phis_end ; ++phi) {
+        for (uint32_t value : ssa.Operands(phi))
+            ++user_offsets_[value + 1];
+    }
+    for (uint32_t value = 0 ; value < num_values ; ++value)
+        user_offsets_[value + 1] += user_offsets_[value];
+
+    users_.resize(user_offsets_[num_values]);
+    for (uint32_t idx = 0 ; idx < insns.size() ; ++idx) {
+        for (uint32_t value : ssa.Uses(insns[idx]))
+            users_[user_offsets_[value]++] = idx;
+    }
+    for (uint32_t phi = phis_begin ; phi < phis_end ; ++phi) {
+        for (uint32_t value : ssa.Operands(phi))
+            users_[user_offsets_[value]++] = phi | kPhiUser;
+    }
+    for (uint32_t value = num_values ; value > 0 ; --value)
+        user_offsets_[value] = user_offsets_[value - 1];
+    user_offsets_[0] = 0;
+}
+
+void ConstantPropagation::MarkEdge(const MethodCfg& cfg, uint32_t source, uint32_t target)
+{
+    // The predecessors are sorted by source block, without duplicates.
+    Range<uint32_t> preds = cfg.Predecessors(target);
+    uint32_t pos = std::lower_bound(preds.begin(), preds.end(), source) - preds.begin();
+    uint32_t edge = edge_offsets_[target] + pos;
+    if (executable_[edge])
+        return;
+    executable_[edge] = true;
+    flow_worklist_.push_back(std::make_pair(source, target));
+}
+
+void ConstantPropagation::MarkSuccessors(const MethodCfg& cfg, const MethodSsa& ssa,
+                                         uint32_t block, const Instruction* inst,
+                                         const MethodSsa::Insn& insn)
+{
+    Range<MethodCfg::Edge> succs = cfg.Successors(block);
+    Instruction::Code opcode = inst->Opcode();
+    if (opcode < Instruction::IF_EQ || opcode > Instruction::IF_LEZ || succs.size() != 2) {
+        for (const MethodCfg::Edge& edge : succs)
+            MarkEdge(cfg, block, edge.block_);
+        return;
+    }
+
+    // An if waits for its operands, and takes a single edge if they are
+    // constant ints, the second operand of the z forms being zero.
+    Range<uint32_t> uses = ssa.Uses(insn);
+    Constant lhs = values_[uses.begin()[0]];
+    Constant rhs = {kInteger, 0};
+    if (uses.size() > 1)
+        rhs = values_[uses.begin()[1]];
+    if (lhs.kind_ == kTop || rhs.kind_ == kTop)
+        return;
+    if (lhs.kind_ != kInteger || rhs.kind_ != kInteger) {
+        for (const MethodCfg::Edge& edge : succs)
+            MarkEdge(cfg, block, edge.block_);
+        return;
+    }
+
+    bool taken;
+    switch ((opcode >= Instruction::IF_EQZ)? opcode - Instruction::IF_EQZ :
+                                             opcode - Instruction::IF_EQ) {
+      case 0: taken = lhs.bits_ == rhs.bits_; break;
+      case 1: taken = lhs.bits_ != rhs.bits_; break;
+      case 2: taken = lhs.bits_ < rhs.bits_; break;
+      case 3: taken = lhs.bits_ >= rhs.bits_; break;
+      case 4: taken = lhs.bits_ > rhs.bits_; break;
+      default: taken = lhs.bits_ <= rhs.bits_; break;
+    }
+    MethodCfg::EdgeKind kind = (taken)? MethodCfg::kBranch : MethodCfg::kFallthrough;
+    for (const MethodCfg::Edge& edge : succs) {
+        if (edge.kind_ == kind)
+            MarkEdge(cfg, block, edge.block_);
+    }
+}
+
+void ConstantPropagation::VisitBlock(const DexFile::CodeItem* code_item, const MethodCfg& cfg,
+                                     const MethodSsa& ssa, uint32_t block)
+{
+    visited_[block] = true;
+    for (uint32_t phi = ssa.PhisBegin(block) ; phi < ssa.PhisEnd(block) ; ++phi)
+        EvaluatePhi(ssa, phi);
+
+    // The instructions of a block are consecutive in the table.
+    const MethodCfg::Block& range = cfg.GetBlock(block);
+    uint32_t idx = ssa.InsnAt(range.start_pc_) - ssa.Insns().data();
+    for ( ; idx < ssa.Insns().size() && ssa.Insns()[idx].dex_pc_ < range.end_pc_ ; ++idx)
+        EvaluateInsn(code_item, cfg, ssa, idx);
+}
+
+void ConstantPropagation::EvaluatePhi(const MethodSsa& ssa, uint32_t phi)
+{
+    // The method entry is an executable operand of the phis of the entry
+    // block.
+    uint32_t block = ssa.GetValue(phi).block_;
+    if (!visited_[block])
+        return;
+    Range<uint32_t> operands = ssa.Operands(phi);
+    uint32_t first = 0;
+    Constant constant = {kTop, 0};
+    if (block == 0) {
+        constant = values_[operands.begin()[0]];
+        first = 1;
+    }
+    for (uint32_t i = first ; i < operands.size() ; ++i) {
+        if (executable_[edge_offsets_[block] + i - first])
+            constant = Meet(constant, values_[operands.begin()[i]]);
+    }
+    Lower(phi, constant);
+}
+
+void ConstantPropagation::EvaluateInsn(const DexFile::CodeItem* code_item, const MethodCfg& cfg,
+                                       const MethodSsa& ssa, uint32_t idx)
+{
+    const MethodSsa::Insn& insn = ssa.Insns()[idx];
+    const Instruction* inst = Instruction::At(&code_item->insns_[insn.dex_pc_]);
+    if (insn.def_ != MethodSsa::kNoValue)
+        Lower(insn.def_, Fold(inst, ssa, insn));
+
+    uint32_t block = cfg.BlockOf(insn.dex_pc_);
+    if (insn.dex_pc_ == cfg.GetBlock(block).last_pc_)
+        MarkSuccessors(cfg, ssa, block, inst, insn);
+}
+
+ConstantPropagation::Constant ConstantPropagation::Fold(const Instruction* inst,
+                                                        const MethodSsa& ssa,
+                                                        const MethodSsa::Insn& insn) const
+{
+    Constant top = {kTop, 0};
+    Constant bottom = {kBottom, 0};
+    Constant result = bottom;
+    Range<uint32_t> uses = ssa.Uses(insn);
+    for (uint32_t value : uses) {
+        if (values_[value].kind_ == kTop)
+            return top;
+    }
+
+    Instruction::Code opcode = inst->Opcode();
+    switch (opcode) {
+      case Instruction::CONST_4:
+      case Instruction::CONST_16:
+      case Instruction::CONST:
+        result.kind_ = kInteger;
+        result.bits_ = inst->VRegB();
+        return result;
+      case Instruction::CONST_HIGH16:
+        result.kind_ = kInteger;
+        result.bits_ = static_cast<int32_t>(inst->VRegB_21h() << 16);
+        return result;
+      case Instruction::CONST_WIDE_16:
+      case Instruction::CONST_WIDE_32:
+        result.kind_ = kLong;
+        result.bits_ = inst->VRegB();
+        return result;
+      case Instruction::CONST_WIDE:
+        result.kind_ = kLong;
+        result.bits_ = inst->WideVRegB();
+        return result;
+      case Instruction::CONST_WIDE_HIGH16:
+        result.kind_ = kLong;
+        result.bits_ = static_cast<int64_t>(static_cast<uint64_t>(inst->VRegB_21h()) << 48);
+        return result;
+      case Instruction::CONST_STRING:
+      case Instruction::CONST_STRING_JUMBO:
+        result.kind_ = kString;
+        result.bits_ = static_cast<uint32_t>(inst->VRegB());
+        return result;
+      case Instruction::MOVE:
+      case Instruction::MOVE_FROM16:
+      case Instruction::MOVE_16:
+      case Instruction::MOVE_WIDE:
+      case Instruction::MOVE_WIDE_FROM16:
+      case Instruction::MOVE_WIDE_16:
+      case Instruction::MOVE_OBJECT:
+      case Instruction::MOVE_OBJECT_FROM16:
+      case Instruction::MOVE_OBJECT_16:
+        return values_[uses.begin()[0]];
+      default:
+        break;
+    }
+
+    // The arithmetic folds constants of the kind of its operands only.
+    if (uses.size() == 0)
+        return bottom;
+    const Constant& lhs = values_[uses.begin()[0]];
+    if (opcode >= Instruction::NEG_INT && opcode <= Instruction::INT_TO_SHORT) {
+        int64_t bits = lhs.bits_;
+        switch (opcode) {
+          case Instruction::NEG_INT:
+            return (lhs.kind_ == kInteger)?
+                   Constant{kInteger, static_cast<int32_t>(0 - static_cast<uint32_t>(bits))} :
+                   bottom;
+          case Instruction::NOT_INT:
+            return (lhs.kind_ == kInteger)? Constant{kInteger, ~bits} : bottom;
+          case Instruction::NEG_LONG:
+            return (lhs.kind_ == kLong)?
+                   Constant{kLong, static_cast<int64_t>(0 - static_cast<uint64_t>(bits))} :
+                   bottom;
+          case Instruction::NOT_LONG:
+            return (lhs.kind_ == kLong)? Constant{kLong, ~bits} : bottom;
+          case Instruction::INT_TO_LONG:
+            return (lhs.kind_ == kInteger)? Constant{kLong, bits} : bottom;
+          case Instruction::LONG_TO_INT:
+            return (lhs.kind_ == kLong)? Constant{kInteger, static_cast<int32_t>(bits)} : bottom;
+          case Instruction::INT_TO_BYTE:
+            return (lhs.kind_ == kInteger)? Constant{kInteger, static_cast<int8_t>(bits)} : bottom;
+          case Instruction::INT_TO_CHAR:
+            return (lhs.kind_ == kInteger)? Constant{kInteger, static_cast<uint16_t>(bits)} :
+                                            bottom;
+          case Instruction::INT_TO_SHORT:
+            return (lhs.kind_ == kInteger)? Constant{kInteger, static_cast<int16_t>(bits)} :
+                                            bottom;
+          default:
+            return bottom;
+        }
+    }
+
+    if (opcode >= Instruction::ADD_INT && opcode <= Instruction::REM_DOUBLE_2ADDR &&
+        uses.size() == 2) {
+        // The int and the long operations, in two runs, a long shift
+        // taking an int distance.
+        const Constant& rhs = values_[uses.begin()[1]];
+        uint32_t op = (opcode - Instruction::ADD_INT) % 32;
+        if (op < 11 && lhs.kind_ == kInteger && rhs.kind_ == kInteger) {
+            int32_t folded;
+            if (FoldInt(op, lhs.bits_, rhs.bits_, &folded))
+                return Constant{kInteger, folded};
+        } else if (op >= 11 && op < 22 && lhs.kind_ == kLong &&
+                   rhs.kind_ == ((op >= 19)? kInteger : kLong)) {
+            int64_t folded;
+            if (FoldLong(op - 11, lhs.bits_, rhs.bits_, &folded))
+                return Constant{kLong, folded};
+        }
+        return bottom;
+    }
+
+    if (opcode >= Instruction::ADD_INT_LIT16 && opcode <= Instruction::USHR_INT_LIT8 &&
+        lhs.kind_ == kInteger) {
+        // The literal forms run add, rsub, mul, div, rem, and, or, xor, then
+        // the shifts for lit8 only.
+        uint32_t op = (opcode >= Instruction::ADD_INT_LIT8)? opcode - Instruction::ADD_INT_LIT8 :
+                                                             opcode - Instruction::ADD_INT_LIT16;
+        int32_t literal = inst->VRegC();
+        int32_t folded;
+        bool ok = (op == 1)? FoldInt(1, literal, lhs.bits_, &folded) :
+                             FoldInt(op, lhs.bits_, literal, &folded);
+        return (ok)? Constant{kInteger, folded} : bottom;
+    }
+    return bottom;
+}
+
+void ConstantPropagation::Lower(uint32_t value, const Constant& constant)
+{
+    Constant lowered = Meet(values_[value], constant);
+    if (lowered.kind_ == values_[value].kind_ && lowered.bits_ == values_[value].bits_)
+        return;
+    values_[value] = lowered;
+    value_worklist_.push_back(value);
+}
+
+ConstantPropagation::Constant ConstantPropagation::Meet(const Constant& lhs, const Constant& rhs)
+{
+    if (lhs.kind_ == kTop)
+        return rhs;
+    if (rhs.kind_ == kTop || (lhs.kind_ == rhs.kind_ && lhs.bits_ == rhs.bits_))
+        return lhs;
+    Constant bottom = {kBottom, 0};
+    return bottom;
+}
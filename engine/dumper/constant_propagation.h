@@ -0,0 +1,100 @@
+#ifndef _DUMPER_CONSTANT_PROPAGATION_H_
+#define _DUMPER_CONSTANT_PROPAGATION_H_
+
+
+#include "globals.h"
+#include "macros.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "method_cfg.h"
+#include "method_ssa.h"
+
+
+// The sparse conditional constant propagation of Wegman and Zadeck over the
+// SSA form of a method.
+//
+// The values start unknown (top) and are only lowered, to a constant then
+// to varying (bottom). The const, const-wide and const-string instructions
+// give constants, the moves copy them and the int and long arithmetic,
+// conversions and literal operations fold them, a division by zero staying
+// varying. A phi meets the operands flowing along the executable edges
+// only, and an if whose operands are constant only makes the edge it takes
+// executable, so the values of a dead branch do not spoil a join. The
+// parameters, the invoke results and everything else are varying.
+//
+// Two worklists drive the pass: the edges newly found executable, whose
+// target gets its phis evaluated, and its instructions on the first visit,
+// and the values newly lowered, whose users are evaluated again. A value is
+// lowered at most twice, which bounds the work by the size of the form.
+class ConstantPropagation
+{
+  public:
+    enum Kind
+    {
+        kTop = 0,
+        kInteger,  // also a float, or null for zero
+        kLong,     // also a double
+        kString,
+        kBottom,
+    };
+
+    struct Constant
+    {
+        Kind kind_;
+        int64_t bits_;  // the integer, sign extended, or the string_idx
+    };
+
+    ConstantPropagation() {}
+
+    // Propagate over the form of the code item, which is not retained.
+    void Run(const DexFile::CodeItem* code_item, const MethodCfg& cfg, const MethodSsa& ssa);
+
+    const Constant& ValueOf(uint32_t value) const
+    {
+        return values_[value];
+    }
+
+    bool IsExecutable(uint32_t block) const
+    {
+        return visited_[block];
+    }
+
+  private:
+    static constexpr uint32_t kPhiUser = 0x80000000;
+
+    void FillUsers(const MethodCfg& cfg, const MethodSsa& ssa);
+    void MarkEdge(const MethodCfg& cfg, uint32_t source, uint32_t target);
+    void MarkSuccessors(const MethodCfg& cfg, const MethodSsa& ssa, uint32_t block,
+                        const Instruction* inst, const MethodSsa::Insn& insn);
+    void VisitBlock(const DexFile::CodeItem* code_item, const MethodCfg& cfg,
+                    const MethodSsa& ssa, uint32_t block);
+    void EvaluatePhi(const MethodSsa& ssa, uint32_t phi);
+    void EvaluateInsn(const DexFile::CodeItem* code_item, const MethodCfg& cfg,
+                      const MethodSsa& ssa, uint32_t idx);
+    Constant Fold(const Instruction* inst, const MethodSsa& ssa,
+                  const MethodSsa::Insn& insn) const;
+    void Lower(uint32_t value, const Constant& constant);
+
+    static Constant Meet(const Constant& lhs, const Constant& rhs);
+
+    std::vector<Constant> values_;
+    std::vector<bool> visited_;
+
+    // The executable edges, by target block and position among its
+    // predecessors.
+    std::vector<uint32_t> edge_offsets_;  // of size NumBlocks() + 1
+    std::vector<bool> executable_;
+
+    // The instructions and the phis reading each value, a phi user being
+    // flagged by kPhiUser.
+    std::vector<uint32_t> user_offsets_;
+    std::vector<uint32_t> users_;
+
+    std::vector<std::pair<uint32_t, uint32_t>> flow_worklist_;
+    std::vector<uint32_t> value_worklist_;
+
+    DISALLOW_COPY_AND_ASSIGN(ConstantPropagation);
+};
+
+#endif
@@ -1010,4 +1010,14 @@ class ClassDataItemIterator
     DISALLOW_IMPLICIT_CONSTRUCTORS(ClassDataItemIterator);
 };
 
+// Advance the iterator past the static and instance fields, to the first
+// method if any.
+inline void SkipAllFields(ClassDataItemIterator& it)
+{
+    while (it.HasNextStaticField())
+        it.Next();
+    while (it.HasNextInstanceField())
+        it.Next();
+}
+
 #endif
\ No newline at end of file
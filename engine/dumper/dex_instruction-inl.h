@@ -70,6 +70,7 @@ inline int32_t Instruction::VRegA() const
       default:
         LOG(FATAL) << "Tried to access vA of instruction " << Name()
         << " which has no A operand.";
+        return 0;
     }
 }
 
@@ -248,7 +249,7 @@ inline bool Instruction::HasVRegB() const
 
 inline bool Instruction::HasWideVRegB() const
 {
-    return FormatOf(Opcode()), k51l;
+    return FormatOf(Opcode()) == k51l;
 }
 
 inline int32_t Instruction::VRegB() const
@@ -276,6 +277,7 @@ inline int32_t Instruction::VRegB() const
       default:
         LOG(FATAL) << "Tried to access vB of instruction " << Name()
         << " which has no B operand.";
+        return 0;
     }
 }
 
@@ -429,6 +431,7 @@ inline int32_t Instruction::VRegC() const
       default:
         LOG(FATAL) << "Tried to access vC of instruction " << Name()
         << " which has no C operand.";
+        return 0;
     }
 }
 
@@ -476,7 +479,7 @@ inline uint16_t Instruction::VRegC_3rc() const
 
 inline bool Instruction::HasVarArgs() const
 {
-    return FormatOf(Opcode()), k35c;
+    return FormatOf(Opcode()) == k35c;
 }
 
 inline void Instruction::GetVarArgs(uint32_t arg[5], uint16_t inst_data) const
@@ -515,4 +518,19 @@ inline void Instruction::GetVarArgs(uint32_t arg[5], uint16_t inst_data) const
     }
 }
 
+//------------------------------------------------------------------------------
+// Index operand
+//------------------------------------------------------------------------------
+inline uint32_t Instruction::GetIndexOperand() const
+{
+    switch (FormatOf(Opcode())) {
+      case k21c: return VRegB_21c();
+      case k22c: return VRegC_22c();
+      case k31c: return VRegB_31c();
+      case k35c: return VRegB_35c();
+      case k3rc: return VRegB_3rc();
+      default: return kNoIndexOperand;
+    }
+}
+
 #endif
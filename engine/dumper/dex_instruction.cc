@@ -42,6 +42,24 @@ int const Instruction::kInstructionVerifyFlags[] =
     #undef INSTRUCTION_VERIFY_FLAGS
 };
 
+bool const Instruction::kInstructionWritesRegisterA[] =
+{
+    #define INSTRUCTION_WRITES_REGISTER_A(o, c, p, f, writes, i, a, v) writes,
+    #include "dex_instruction_list.h"
+        DEX_INSTRUCTION_LIST(INSTRUCTION_WRITES_REGISTER_A)
+    #undef DEX_INSTRUCTION_LIST
+    #undef INSTRUCTION_WRITES_REGISTER_A
+};
+
+Instruction::IndexType const Instruction::kInstructionIndexTypes[] =
+{
+    #define INSTRUCTION_INDEX_TYPE(o, c, p, f, r, index, a, v) index,
+    #include "dex_instruction_list.h"
+        DEX_INSTRUCTION_LIST(INSTRUCTION_INDEX_TYPE)
+    #undef DEX_INSTRUCTION_LIST
+    #undef INSTRUCTION_INDEX_TYPE
+};
+
 int const Instruction::kInstructionSizeInCodeUnits[] =
 {
     #define INSTRUCTION_SIZE(opcode, c, p, format, r, i, a, v) \
@@ -137,6 +137,17 @@ class Instruction
         kRegBFieldOrConstant = 0x800000,  // is the second virtual register a field or literal constant (vB)
     };
 
+    // The kind of constant pool index an instruction refers to.
+    enum IndexType
+    {
+        kUnknown = 0,
+        kNone,       // has no index
+        kStringRef,  // string reference index
+        kTypeRef,    // type reference index
+        kFieldRef,   // field reference index
+        kMethodRef,  // method reference index
+    };
+
     enum VerifyFlag
     {
         kVerifyNone               = 0x000000,
@@ -519,6 +530,18 @@ class Instruction
         return kInstructionVerifyFlags[opcode];
     }
 
+    // Returns the kind of index referred by the given opcode.
+    static IndexType IndexTypeOf(Code opcode)
+    {
+        return kInstructionIndexTypes[opcode];
+    }
+
+    // Returns the constant pool index operand of this instruction, or
+    // kNoIndexOperand if its format does not carry one.
+    uint32_t GetIndexOperand() const;
+
+    static constexpr uint32_t kNoIndexOperand = 0xFFFFFFFF;
+
     // Returns true if this instruction is a branch.
     bool IsBranch() const
     {
@@ -544,6 +567,15 @@ class Instruction
         return (kInstructionFlags[Opcode()] & kSwitch) != 0;
     }
 
+    // Returns true if this is the payload of a switch or of a fill-array-data,
+    // encoded as a nop followed by the payload data.
+    bool IsPayload() const
+    {
+        uint16_t ident = Fetch16(0);
+        return ident == kPackedSwitchSignature || ident == kSparseSwitchSignature ||
+               ident == kArrayDataSignature;
+    }
+
     // Returns true if this instruction can throw.
     bool IsThrow() const
     {
@@ -568,6 +600,12 @@ class Instruction
         return (kInstructionFlags[Opcode()] & kInvoke) != 0;
     }
 
+    // Returns true if this instruction writes its vA register.
+    bool WritesRegisterA() const
+    {
+        return kInstructionWritesRegisterA[Opcode()];
+    }
+
     int GetVerifyTypeArgumentA() const
     {
         return (kInstructionVerifyFlags[Opcode()] & (kVerifyRegA | kVerifyRegAWide));
@@ -661,6 +699,8 @@ class Instruction
     static Format const kInstructionFormats[];
     static int const kInstructionFlags[];
     static int const kInstructionVerifyFlags[];
+    static bool const kInstructionWritesRegisterA[];
+    static IndexType const kInstructionIndexTypes[];
     static int const kInstructionSizeInCodeUnits[];
     DISALLOW_IMPLICIT_CONSTRUCTORS(Instruction);
 };
@@ -0,0 +1,246 @@
+#include <algorithm>
+
+#include "dominance.h"
+
+
+constexpr uint32_t Dominance::kNone;
+
+
+void Dominance::Compute(const MethodCfg& cfg)
+{
+    ComputeDominators(cfg);
+    ComputePostDominators(cfg);
+    NumberDominatorTree(cfg);
+    FindLoops(cfg);
+}
+
+void Dominance::ComputeIdoms(const std::vector<uint32_t>& pred_offsets,
+                             const std::vector<uint32_t>& preds, std::vector<uint32_t>* idoms)
+{
+    uint32_t num_nodes = pred_offsets.size() - 1;
+    std::vector<uint32_t>& idom = *idoms;
+    idom.assign(num_nodes, kNone);
+    idom[0] = 0;
+
+    // A node always has a predecessor numbered before it, its parent in the
+    // depth first search, so every node gets a dominator in the first pass
+    // and the next passes only refine them.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t node = 1 ; node < num_nodes ; ++node) {
+            uint32_t new_idom = kNone;
+            for (uint32_t i = pred_offsets[node] ; i < pred_offsets[node + 1] ; ++i) {
+                uint32_t pred = preds[i];
+                if (idom[pred] == kNone)
+                    continue;
+                if (new_idom == kNone) {
+                    new_idom = pred;
+                    continue;
+                }
+                // Walk both fingers up to their nearest common dominator.
+                uint32_t finger = pred;
+                while (finger != new_idom) {
+                    while (finger > new_idom)
+                        finger = idom[finger];
+                    while (new_idom > finger)
+                        new_idom = idom[new_idom];
+                }
+            }
+            if (idom[node] != new_idom) {
+                idom[node] = new_idom;
+                changed = true;
+            }
+        }
+    }
+}
+
+void Dominance::ComputeDominators(const MethodCfg& cfg)
+{
+    const std::vector<uint32_t>& rpo = cfg.ReversePostorder();
+    uint32_t num_nodes = rpo.size();
+    node_pred_offsets_.resize(num_nodes + 1);
+    node_preds_.clear();
+    for (uint32_t node = 0 ; node < num_nodes ; ++node) {
+        node_pred_offsets_[node] = node_preds_.size();
+        for (uint32_t pred : cfg.Predecessors(rpo[node])) {
+            if (cfg.IsReachable(pred))
+                node_preds_.push_back(cfg.RpoNumber(pred));
+        }
+    }
+    node_pred_offsets_[num_nodes] = node_preds_.size();
+    ComputeIdoms(node_pred_offsets_, node_preds_, &node_idoms_);
+
+    idom_.assign(cfg.NumBlocks(), kNone);
+    for (uint32_t node = 1 ; node < num_nodes ; ++node)
+        idom_[rpo[node]] = rpo[node_idoms_[node]];
+}
+
+void Dominance::ComputePostDominators(const MethodCfg& cfg)
+{
+    // Search the reversed graph from each exit block in turn, which is a
+    // depth first search from the virtual exit. The number_ of a block
+    // holds the position of its next predecessor to visit meanwhile.
+    uint32_t num_blocks = cfg.NumBlocks();
+    number_.assign(num_blocks, kNone);
+    order_.clear();
+    for (uint32_t exit : cfg.ReversePostorder()) {
+        if (cfg.Successors(exit).size() != 0 || number_[exit] != kNone)
+            continue;
+        number_[exit] = 0;
+        stack_.assign(1, exit);
+        while (!stack_.empty()) {
+            uint32_t block = stack_.back();
+            Range<uint32_t> preds = cfg.Predecessors(block);
+            uint32_t& next = number_[block];
+            while (next < preds.size() && (!cfg.IsReachable(preds.begin()[next]) ||
+                                           number_[preds.begin()[next]] != kNone))
+                ++next;
+            if (next < preds.size()) {
+                uint32_t pred = preds.begin()[next++];
+                number_[pred] = 0;
+                stack_.push_back(pred);
+                continue;
+            }
+            order_.push_back(block);
+            stack_.pop_back();
+        }
+    }
+
+    // Node 0 is the virtual exit, followed by the blocks in reverse
+    // postorder of the reversed graph.
+    order_.push_back(kNone);
+    std::reverse(order_.begin(), order_.end());
+    uint32_t num_nodes = order_.size();
+    for (uint32_t node = 1 ; node < num_nodes ; ++node)
+        number_[order_[node]] = node;
+
+    node_pred_offsets_.resize(num_nodes + 1);
+    node_pred_offsets_[0] = 0;
+    node_preds_.clear();
+    for (uint32_t node = 1 ; node < num_nodes ; ++node) {
+        node_pred_offsets_[node] = node_preds_.size();
+        Range<MethodCfg::Edge> succs = cfg.Successors(order_[node]);
+        if (succs.size() == 0)
+            node_preds_.push_back(0);
+        for (const MethodCfg::Edge& edge : succs) {
+            // The successors that cannot reach the exit were not numbered.
+            if (cfg.IsReachable(edge.block_) && number_[edge.block_] != kNone)
+                node_preds_.push_back(number_[edge.block_]);
+        }
+    }
+    node_pred_offsets_[num_nodes] = node_preds_.size();
+    ComputeIdoms(node_pred_offsets_, node_preds_, &node_idoms_);
+
+    ipdom_.assign(num_blocks, kNone);
+    for (uint32_t node = 1 ; node < num_nodes ; ++node) {
+        if (node_idoms_[node] != 0)
+            ipdom_[order_[node]] = order_[node_idoms_[node]];
+    }
+}
+
+void Dominance::NumberDominatorTree(const MethodCfg& cfg)
+{
+    // Bucket the reachable blocks by their immediate dominator, in reverse
+    // postorder.
+    const std::vector<uint32_t>& rpo = cfg.ReversePostorder();
+    uint32_t num_blocks = cfg.NumBlocks();
+    child_offsets_.assign(num_blocks + 1, 0);
+    for (uint32_t i = 1 ; i < rpo.size() ; ++i)
+        ++child_offsets_[idom_[rpo[i]] + 1];
+    for (uint32_t i = 0 ; i < num_blocks ; ++i)
+        child_offsets_[i + 1] += child_offsets_[i];
+    children_.resize(child_offsets_[num_blocks]);
+    number_.assign(child_offsets_.begin(), child_offsets_.end() - 1);
+    for (uint32_t i = 1 ; i < rpo.size() ; ++i)
+        children_[number_[idom_[rpo[i]]]++] = rpo[i];
+
+    // Number the tree in preorder, last_ being the greatest number in the
+    // subtree, while number_ holds the position of the next child to visit.
+    preorder_.assign(num_blocks, kNone);
+    last_.assign(num_blocks, kNone);
+    number_.assign(child_offsets_.begin(), child_offsets_.end() - 1);
+    uint32_t counter = 0;
+    preorder_[0] = counter++;
+    stack_.assign(1, 0);
+    while (!stack_.empty()) {
+        uint32_t block = stack_.back();
+        if (number_[block] < child_offsets_[block + 1]) {
+            uint32_t child = children_[number_[block]++];
+            preorder_[child] = counter++;
+            stack_.push_back(child);
+            continue;
+        }
+        last_[block] = counter - 1;
+        stack_.pop_back();
+    }
+}
+
+void Dominance::FindLoops(const MethodCfg& cfg)
+{
+    loops_.clear();
+    back_edges_.clear();
+    loop_of_.assign(cfg.NumBlocks(), kNone);
+    num_irreducible_edges_ = 0;
+
+    // The retreating edges are the ones going to a block not after their
+    // source in reverse postorder.
+    const std::vector<uint32_t>& rpo = cfg.ReversePostorder();
+    for (uint32_t i = 0 ; i < rpo.size() ; ++i) {
+        uint32_t header = rpo[i];
+        uint32_t begin = back_edges_.size();
+        for (uint32_t pred : cfg.Predecessors(header)) {
+            if (!cfg.IsReachable(pred) || cfg.RpoNumber(pred) < i)
+                continue;
+            if (Dominates(header, pred))
+                back_edges_.push_back(pred);
+            else
+                ++num_irreducible_edges_;
+        }
+        if (back_edges_.size() > begin) {
+            Loop loop = {header, kNone, 0, 0, begin, static_cast<uint32_t>(back_edges_.size())};
+            loops_.push_back(loop);
+        }
+    }
+
+    // Collect the bodies from the innermost headers out. A block already
+    // claimed by a nested loop stands for the whole outermost loop found so
+    // far around it, which becomes a child of the current one, and the
+    // search resumes from the entries of that loop.
+    for (uint32_t idx = loops_.size() ; idx-- > 0 ; ) {
+        Loop& loop = loops_[idx];
+        loop_of_[loop.header_] = idx;
+        loop.num_blocks_ = 1;
+        stack_.assign(back_edges_.begin() + loop.back_edges_begin_,
+                      back_edges_.begin() + loop.back_edges_end_);
+        while (!stack_.empty()) {
+            uint32_t block = stack_.back();
+            stack_.pop_back();
+            if (loop_of_[block] == kNone) {
+                loop_of_[block] = idx;
+                ++loop.num_blocks_;
+            } else {
+                uint32_t inner = OutermostLoop(loop_of_[block]);
+                if (inner == idx)
+                    continue;
+                loops_[inner].parent_ = idx;
+                loop.num_blocks_ += loops_[inner].num_blocks_;
+                block = loops_[inner].header_;
+            }
+            for (uint32_t pred : cfg.Predecessors(block)) {
+                if (cfg.IsReachable(pred))
+                    stack_.push_back(pred);
+            }
+        }
+    }
+
+    for (Loop& loop : loops_)
+        loop.depth_ = (loop.parent_ == kNone)? 1 : loops_[loop.parent_].depth_ + 1;
+}
+
+uint32_t Dominance::OutermostLoop(uint32_t loop) const
+{
+    while (loops_[loop].parent_ != kNone)
+        loop = loops_[loop].parent_;
+    return loop;
+}
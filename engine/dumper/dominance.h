@@ -0,0 +1,140 @@
+#ifndef _DUMPER_DOMINANCE_H_
+#define _DUMPER_DOMINANCE_H_
+
+
+#include "globals.h"
+#include "macros.h"
+
+#include "method_cfg.h"
+
+
+// The dominators, the post-dominators and the natural loops of a method
+// control flow graph.
+//
+// Both trees are computed by the iterative algorithm of Cooper, Harvey and
+// Kennedy, over the nodes renumbered in reverse postorder so that the finger
+// walks of the intersection compare plain numbers. The post-dominators are
+// the dominators of the reversed graph, rooted at a virtual exit reached from
+// every block without successors. A block that cannot reach the exit, such as
+// the body of an endless loop, has no immediate post-dominator.
+//
+// An edge whose target dominates its source is a back edge, and the natural
+// loop of a header is the union of the blocks reaching its back edges without
+// going through it. The loops are numbered by the reverse postorder of their
+// headers, so an enclosing loop comes before the loops nested in it. A
+// retreating edge whose target does not dominate its source enters a cycle
+// with several entries, it is counted as irreducible and forms no loop.
+class Dominance
+{
+  public:
+    static constexpr uint32_t kNone = MethodCfg::kNoBlock;
+
+    struct Loop
+    {
+        uint32_t header_;
+        uint32_t parent_;  // the enclosing loop, or kNone
+        uint32_t depth_;   // 1 for an outermost loop
+        uint32_t num_blocks_;  // including the blocks of the nested loops
+        uint32_t back_edges_begin_;  // into the sources of BackEdges()
+        uint32_t back_edges_end_;
+    };
+
+    Dominance() {}
+
+    // Compute the trees and the loops of the graph, which is not retained.
+    void Compute(const MethodCfg& cfg);
+
+    // Returns the immediate dominator of the block, or kNone for the entry
+    // and the unreachable blocks.
+    uint32_t ImmediateDominator(uint32_t block) const
+    {
+        return idom_[block];
+    }
+
+    // Returns the immediate post-dominator of the block, or kNone if it is
+    // only post-dominated by the virtual exit.
+    uint32_t ImmediatePostDominator(uint32_t block) const
+    {
+        return ipdom_[block];
+    }
+
+    // Returns true if every path from the entry to block b goes through
+    // block a. Answered in constant time by the preorder intervals of the
+    // dominator tree.
+    bool Dominates(uint32_t a, uint32_t b) const
+    {
+        return preorder_[b] != kNone && preorder_[a] <= preorder_[b] &&
+               preorder_[b] <= last_[a];
+    }
+
+    // The children of the block in the dominator tree, in reverse postorder.
+    Range<uint32_t> DominatorTreeChildren(uint32_t block) const
+    {
+        const uint32_t* base = children_.data();
+        return Range<uint32_t>(base + child_offsets_[block], base + child_offsets_[block + 1]);
+    }
+
+    const std::vector<Loop>& Loops() const
+    {
+        return loops_;
+    }
+
+    // The sources of the back edges of the loops, by loop.
+    const std::vector<uint32_t>& BackEdges() const
+    {
+        return back_edges_;
+    }
+
+    // Returns the innermost loop containing the block, or kNone.
+    uint32_t LoopOf(uint32_t block) const
+    {
+        return loop_of_[block];
+    }
+
+    uint32_t LoopDepth(uint32_t block) const
+    {
+        return (loop_of_[block] == kNone)? 0 : loops_[loop_of_[block]].depth_;
+    }
+
+    uint32_t NumIrreducibleEdges() const
+    {
+        return num_irreducible_edges_;
+    }
+
+  private:
+    // Fill the immediate dominators of the nodes 1..n-1 of a graph numbered
+    // in reverse postorder from its root 0, given the predecessors of the
+    // nodes as compressed sparse rows.
+    static void ComputeIdoms(const std::vector<uint32_t>& pred_offsets,
+                             const std::vector<uint32_t>& preds, std::vector<uint32_t>* idoms);
+
+    void ComputeDominators(const MethodCfg& cfg);
+    void ComputePostDominators(const MethodCfg& cfg);
+    void NumberDominatorTree(const MethodCfg& cfg);
+    void FindLoops(const MethodCfg& cfg);
+    uint32_t OutermostLoop(uint32_t loop) const;
+
+    std::vector<uint32_t> idom_;
+    std::vector<uint32_t> ipdom_;
+    std::vector<uint32_t> child_offsets_;  // of size NumBlocks() + 1
+    std::vector<uint32_t> children_;
+    std::vector<uint32_t> preorder_;
+    std::vector<uint32_t> last_;
+
+    std::vector<Loop> loops_;
+    std::vector<uint32_t> back_edges_;
+    std::vector<uint32_t> loop_of_;
+    uint32_t num_irreducible_edges_;
+
+    // The scratch arrays, kept across the methods for their capacity.
+    std::vector<uint32_t> order_;
+    std::vector<uint32_t> number_;
+    std::vector<uint32_t> node_pred_offsets_;
+    std::vector<uint32_t> node_preds_;
+    std::vector<uint32_t> node_idoms_;
+    std::vector<uint32_t> stack_;
+
+    DISALLOW_COPY_AND_ASSIGN(Dominance);
+};
+
+#endif
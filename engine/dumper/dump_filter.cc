@@ -0,0 +1,32 @@
+#include "dump_filter.h"
+#include "dex_file-inl.h"
+
+
+DumpFilter::DumpFilter(const DumperOption& opt)
+{
+    for (const char* pattern : opt.includes)
+        includes_.Add(pattern);
+    for (const char* pattern : opt.excludes)
+        excludes_.Add(pattern);
+    for (const char* pattern : opt.methods)
+        methods_.Add(pattern);
+}
+
+bool DumpFilter::KeepClass(const DexFile& dex_file, uint32_t class_def_idx) const
+{
+    if (includes_.Empty() && excludes_.Empty())
+        return true;
+    const char* descriptor = dex_file.GetClassDescriptor(dex_file.GetClassDef(class_def_idx));
+    if (!includes_.Empty() && !includes_.Match(descriptor))
+        return false;
+    return excludes_.Empty() || !excludes_.Match(descriptor);
+}
+
+bool DumpFilter::KeepMethod(const DexFile& dex_file, uint32_t dex_method_idx) const
+{
+    if (methods_.Empty())
+        return true;
+    if (dex_method_idx >= dex_file.NumMethodIds())
+        return false;
+    return methods_.Match(dex_file.GetMethodName(dex_file.GetMethodId(dex_method_idx)));
+}
@@ -0,0 +1,37 @@
+#ifndef _DUMPER_DUMP_FILTER_H_
+#define _DUMPER_DUMP_FILTER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "cmd_opt.h"
+#include "glob_matcher.h"
+
+#include "dex_file.h"
+
+
+// The classes and methods selected by --include, --exclude and --method.
+// The globs are matched against the raw class descriptors, such as
+// "Lcom/target/*", and the raw method names, so the filtered out entities
+// are dropped before any pretty printing or decoding.
+class DumpFilter
+{
+  public:
+    explicit DumpFilter(const DumperOption& opt);
+
+    // A class is kept if it matches an --include, or if there is none, and
+    // it matches no --exclude.
+    bool KeepClass(const DexFile& dex_file, uint32_t class_def_idx) const;
+
+    // A method is kept if it matches a --method, or if there is none.
+    bool KeepMethod(const DexFile& dex_file, uint32_t dex_method_idx) const;
+
+  private:
+    GlobMatcher includes_;
+    GlobMatcher excludes_;
+    GlobMatcher methods_;
+
+    DISALLOW_COPY_AND_ASSIGN(DumpFilter);
+};
+
+#endif
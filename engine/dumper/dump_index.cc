@@ -0,0 +1,87 @@
+#include "dump_index.h"
+#include "async_writer.h"
+#include "dex_file-inl.h"
+
+
+const byte DumpIndex::kMagic[8] = { 'y', 'a', 'd', 'd', 'i', 'd', 'x', '\0' };
+constexpr uint32_t DumpIndex::kVersion;
+constexpr uint32_t DumpIndex::kEndianConstant;
+
+static_assert(sizeof(DumpIndex::Header) == 32, "Unexpected index header size.");
+static_assert(sizeof(DumpIndex::ClassEntry) == 24, "Unexpected class entry size.");
+static_assert(sizeof(DumpIndex::MethodEntry) == 24, "Unexpected method entry size.");
+
+
+DumpIndex::DumpIndex(const DexFile& dex_file)
+  : dex_file_(dex_file)
+{}
+
+void DumpIndex::AddClass(uint32_t class_def_idx, uint64_t offset, uint64_t length)
+{
+    ClassEntry entry;
+    entry.offset_ = offset;
+    entry.length_ = length;
+    entry.class_def_idx_ = class_def_idx;
+    entry.descriptor_off_ = string_data_.size();
+    string_data_ += dex_file_.GetClassDescriptor(dex_file_.GetClassDef(class_def_idx));
+    string_data_ += '\0';
+    classes_.push_back(entry);
+}
+
+void DumpIndex::AddMethod(uint32_t dex_method_idx, uint32_t class_def_idx,
+                          uint64_t offset, uint64_t length)
+{
+    MethodEntry entry;
+    entry.offset_ = offset;
+    entry.length_ = length;
+    entry.dex_method_idx_ = dex_method_idx;
+    entry.class_def_idx_ = class_def_idx;
+    methods_.push_back(entry);
+}
+
+bool DumpIndex::Write(const char* path)
+{
+    std::sort(classes_.begin(), classes_.end(),
+              [](const ClassEntry& lhs, const ClassEntry& rhs)
+              { return lhs.class_def_idx_ < rhs.class_def_idx_; });
+    std::stable_sort(methods_.begin(), methods_.end(),
+                     [](const MethodEntry& lhs, const MethodEntry& rhs)
+                     { return lhs.dex_method_idx_ < rhs.dex_method_idx_; });
+
+    // The descriptor order refers to the classes by their position, since the
+    // filtered out classes leave holes in the class_def_idx.
+    std::vector<uint32_t> by_descriptor(classes_.size());
+    for (uint32_t i = 0 ; i < classes_.size() ; ++i)
+        by_descriptor[i] = i;
+    const char* strings = string_data_.data();
+    std::stable_sort(by_descriptor.begin(), by_descriptor.end(),
+                     [&](uint32_t lhs, uint32_t rhs) {
+                         return strcmp(strings + classes_[lhs].descriptor_off_,
+                                       strings + classes_[rhs].descriptor_off_) < 0;
+                     });
+    if (by_descriptor.size() % 2 != 0)
+        by_descriptor.push_back(0);
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic_, kMagic, sizeof(kMagic));
+    header.version_ = kVersion;
+    header.endian_tag_ = kEndianConstant;
+    header.class_count_ = classes_.size();
+    header.method_count_ = methods_.size();
+    header.string_data_size_ = string_data_.size();
+
+    std::unique_ptr<OutputSink> sink(AsyncWriter::Open(path, false));
+    if (sink.get() == nullptr)
+        return false;
+    bool success =
+        sink->Write(reinterpret_cast<const char*>(&header), sizeof(header)) &&
+        sink->Write(reinterpret_cast<const char*>(classes_.data()),
+                    classes_.size() * sizeof(ClassEntry)) &&
+        sink->Write(reinterpret_cast<const char*>(by_descriptor.data()),
+                    by_descriptor.size() * sizeof(uint32_t)) &&
+        sink->Write(reinterpret_cast<const char*>(methods_.data()),
+                    methods_.size() * sizeof(MethodEntry)) &&
+        sink->Write(string_data_);
+    return sink->Close() && success;
+}
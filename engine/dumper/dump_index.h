@@ -0,0 +1,75 @@
+#ifndef _DUMPER_DUMP_INDEX_H_
+#define _DUMPER_DUMP_INDEX_H_
+
+
+#include "globals.h"
+#include "macros.h"
+
+#include "dex_file.h"
+
+
+// A sidecar index locating the class and method sections of a text dump, so
+// that a viewer can pread the slice it needs. The offsets are relative to
+// the start of the uncompressed dump. The index file is
+//
+//   Header
+//   ClassEntry[class_count]      : sorted by class_def_idx
+//   uint32_t[class_count]        : the positions in the ClassEntry table of
+//                                  the classes sorted by descriptor, padded
+//                                  to 8 bytes
+//   MethodEntry[method_count]    : sorted by dex_method_idx
+//   char[string_data_size]       : the NUL terminated class descriptors
+//
+// All the values are in the host byte order, which is recorded by
+// endian_tag_.
+class DumpIndex
+{
+  public:
+    static const byte kMagic[8];
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kEndianConstant = 0x12345678;
+
+    struct Header
+    {
+        byte magic_[8];
+        uint32_t version_;
+        uint32_t endian_tag_;
+        uint32_t class_count_;
+        uint32_t method_count_;
+        uint64_t string_data_size_;
+    };
+
+    struct ClassEntry
+    {
+        uint64_t offset_;
+        uint64_t length_;
+        uint32_t class_def_idx_;
+        uint32_t descriptor_off_;  // offset of the descriptor in the string data
+    };
+
+    struct MethodEntry
+    {
+        uint64_t offset_;
+        uint64_t length_;
+        uint32_t dex_method_idx_;
+        uint32_t class_def_idx_;
+    };
+
+    explicit DumpIndex(const DexFile& dex_file);
+
+    void AddClass(uint32_t class_def_idx, uint64_t offset, uint64_t length);
+    void AddMethod(uint32_t dex_method_idx, uint32_t class_def_idx, uint64_t offset,
+                   uint64_t length);
+
+    bool Write(const char* path) WARN_UNUSED;
+
+  private:
+    const DexFile& dex_file_;
+    std::vector<ClassEntry> classes_;
+    std::vector<MethodEntry> methods_;
+    std::string string_data_;
+
+    DISALLOW_COPY_AND_ASSIGN(DumpIndex);
+};
+
+#endif
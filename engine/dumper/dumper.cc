@@ -1,4 +1,3 @@
-
 #include "globals.h"
 #include "cmd_opt.h"
 #include "log.h"
@@ -6,28 +5,169 @@
 #include "scoped_fd.h"
 #include "scoped_map.h"
 #include "stringprintf.h"
+#include "async_writer.h"
+#include "gzip_writer.h"
+#include "thread_pool.h"
 
 #include "dex_file.h"
 #include "dex_instruction.h"
+#include "binary_dumper.h"
+#include "json_dumper.h"
+#include "arrow_dumper.h"
+#include "stats_dumper.h"
+#include "const_string_dumper.h"
+#include "cfg_dumper.h"
+#include "text_dumper.h"
+#include "pwrite_dumper.h"
+#include "shard_dumper.h"
+#include "string_table_dumper.h"
+#include "xref_dumper.h"
+#include "class_hierarchy_dumper.h"
+#include "taint_dumper.h"
+#include "pattern_dumper.h"
+#include "ioc_dumper.h"
+#include "call_graph.h"
+#include "dump_index.h"
+#include "dump_filter.h"
+
+
+// The number of code units decoded per window in the offset ordered traversal.
+// It bounds the amount of formatted text held in memory before reassembly.
+static constexpr uint32_t kOffsetOrderWindowSize = 1 << 20;
+
+
+// A code item scheduled for decoding in the offset ordered traversal.
+struct CodeTask
+{
+    uint32_t code_off;  // file offset of the code_item
+    uint32_t segment;  // index of the output segment to fill
+};
+
+// A class or method section in the offset ordered traversal, located by the
+// output segments it starts and ends in.
+struct SegmentSpan
+{
+    uint32_t idx;  // the class_def_idx or the dex_method_idx
+    uint32_t class_def_idx;
+    uint32_t begin_segment;
+    size_t begin_pos;
+    uint32_t end_segment;
+    size_t end_pos;
+};
 
 
-void SkipAllFields();
-void DumpDexFile(std::ostream&, char, const DexFile&);
-void DumpDexClass(std::ostream&, char, const DexFile&, const DexFile::ClassDef&);
-void DumpDexCode(std::ostream&, const DexFile&, const DexFile::CodeItem*);
+const DexFile* OpenDexFile(const char*, bool);
+bool DumpCallGraph(const char*, const std::vector<const DexFile*>&, const DumpFilter&,
+                   ThreadPool*);
+OutputSink* OpenOutputSink(const DumperOption&, ThreadPool*);
+bool DumpDexFileByOffset(OutputSink&, const DexFile&, const DumpFilter&, DumpIndex*);
+uint32_t LayoutDexClass(std::vector<std::string>*, std::vector<CodeTask>*,
+                        std::vector<SegmentSpan>*, std::vector<SegmentSpan>*, const DexFile&,
+                        const DumpFilter&, uint32_t);
 
 
 int main(int argc, char** argv)
 {
-    char opt_granu, *opt_in, *opt_out;
+    DumperOption opt;
+    if (!ParseDumperOption(argc, argv, &opt))
+        return EXIT_FAILURE;
+
+    bool by_offset = (opt.order == kOrderCodeOffset);
+    std::unique_ptr<const DexFile> dex_file(OpenDexFile(opt.in, by_offset));
+    if (dex_file.get() == nullptr)
+        return EXIT_FAILURE;
 
-    if (!ParseDumperOption(argc, argv, &opt_granu, &opt_in, &opt_out))
+    // The call graph, the class hierarchy, the taint analysis and the indicator
+    // scan span all the inputs.
+    std::vector<std::unique_ptr<const DexFile>> other_dex_files;
+    std::vector<const DexFile*> dex_files(1, dex_file.get());
+    for (uint32_t i = 1 ; i < opt.inputs.size() ; ++i) {
+        other_dex_files.emplace_back(OpenDexFile(opt.inputs[i], false));
+        if (other_dex_files.back().get() == nullptr)
+            return EXIT_FAILURE;
+        dex_files.push_back(other_dex_files.back().get());
+    }
+
+    uint32_t num_threads = (opt.jobs > 0)? opt.jobs : ThreadPool::GetDefaultThreadCount();
+    ThreadPool pool(num_threads);
+    if (opt.pwrite && GzipWriter::IsGzipPath(opt.out)) {
+        LOG(ERROR) << "The compressed output cannot be written with --pwrite.";
         return EXIT_FAILURE;
+    }
+    if (opt.index != nullptr && GzipWriter::IsGzipPath(opt.out)) {
+        LOG(ERROR) << "The compressed output cannot be indexed.";
+        return EXIT_FAILURE;
+    }
+    DumpFilter filter(opt);
+    if (opt.call_graph != nullptr)
+        return (DumpCallGraph(opt.call_graph, dex_files, filter, &pool))?
+               EXIT_SUCCESS : EXIT_FAILURE;
+    if (opt.format == kFormatCodeArrow)
+        return (ArrowDumper(*dex_file.get(), opt.granu, filter).Dump(opt.out, opt.direct_io))?
+               EXIT_SUCCESS : EXIT_FAILURE;
 
+    if (opt.shard_depth > 0) {
+        ShardDumper dumper(*dex_file.get(), opt.granu, filter);
+        return (dumper.Dump(opt.out, opt.shard_depth, &pool))? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    std::unique_ptr<DumpIndex> index;
+    if (opt.index != nullptr)
+        index.reset(new DumpIndex(*dex_file.get()));
+    if (opt.pwrite) {
+        PwriteDumper dumper(*dex_file.get(), opt.granu, filter);
+        bool success = dumper.Dump(opt.out, &pool, index.get());
+        success = success && (!index || index->Write(opt.index));
+        return (success)? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    std::unique_ptr<OutputSink> sink(OpenOutputSink(opt, &pool));
+    if (sink.get() == nullptr)
+        return EXIT_FAILURE;
+    bool success;
+    if (opt.strings)
+        success = StringTableDumper(*dex_file.get()).Dump(*sink);
+    else if (opt.hierarchy)
+        success = ClassHierarchyDumper(dex_files).Dump(*sink);
+    else if (!opt.sources.empty())
+        success = TaintDumper(dex_files, filter).Dump(*sink, opt.sources, opt.sinks, &pool);
+    else if (!opt.xrefs.empty())
+        success = XrefDumper(*dex_file.get(), filter).Dump(*sink, opt.xrefs, &pool);
+    else if (opt.patterns != nullptr)
+        success = PatternDumper(*dex_file.get(), filter).Dump(*sink, opt.patterns, &pool);
+    else if (opt.ioc != nullptr)
+        success = IocDumper(dex_files, filter).Dump(*sink, opt.ioc, opt.inputs, &pool);
+    else if (opt.granu == kGranuCodeStats)
+        success = StatsDumper(*dex_file.get(), filter).Dump(*sink, &pool);
+    else if (opt.granu == kGranuCodeConstString)
+        success = ConstStringDumper(*dex_file.get(), filter).Dump(*sink);
+    else if (opt.granu == kGranuCodeCfg || opt.granu == kGranuCodeSsa ||
+             opt.granu == kGranuCodeTypes || opt.granu == kGranuCodeReflection)
+        success = CfgDumper(*dex_file.get(), opt.granu, filter).Dump(*sink, &pool);
+    else if (opt.format == kFormatCodeBinary)
+        success = BinaryDumper(*dex_file.get(), opt.granu, filter).Dump(*sink);
+    else if (opt.format == kFormatCodeJsonl)
+        success = JsonDumper(*dex_file.get(), opt.granu, filter).Dump(*sink);
+    else if (by_offset)
+        success = DumpDexFileByOffset(*sink, *dex_file.get(), filter, index.get());
+    else
+        success = TextDumper(*dex_file.get(), opt.granu, filter).Dump(*sink, index.get());
+    success = sink->Close() && success;
+    success = success && (!index || index->Write(opt.index));
+    return (success)? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+// Map the dex file into memory, advising the kernel of a sequential read if
+// requested. Returns nullptr on failure.
+const DexFile* OpenDexFile(const char* path, bool sequential)
+{
     // Calculate the to be mapped space size.
-    ScopedFd fd(open(opt_in, O_RDONLY, 0));
-    if (fd.get() == -1)
-        LOG(FATAL) << "Fail to open the dex file.";
+    ScopedFd fd(open(path, O_RDONLY, 0));
+    if (fd.get() == -1) {
+        PLOG(ERROR) << "Fail to open the dex file " << path;
+        return nullptr;
+    }
     size_t size = static_cast<size_t>(lseek(fd.get(), 0, SEEK_END));
     div_t result = div(size, kPageSize);
     size_t algn_size = (result.rem != 0)? (kPageSize * (result.quot + 1)) :
@@ -36,98 +176,154 @@ int main(int argc, char** argv)
     // Map the file into memory.
     byte* base = reinterpret_cast<byte*>(mmap(nullptr, size, PROT_READ,
                                               MAP_PRIVATE, fd.get(), 0));
-    if (base == MAP_FAILED)
-        LOG(FATAL) << "Fail to map the dex file into memory.";
+    if (base == MAP_FAILED) {
+        PLOG(ERROR) << "Fail to map the dex file " << path << " into memory";
+        return nullptr;
+    }
+    if (sequential)
+        madvise(base, algn_size, MADV_SEQUENTIAL);
     ScopedMap mem_map(base, size, algn_size);
-    std::unique_ptr<const DexFile> dex_file(DexFile::OpenMemory(mem_map));
-    if (dex_file.get() == nullptr)
-        return EXIT_FAILURE;
+    return DexFile::OpenMemory(mem_map);
+}
 
-    if (!opt_out)
-        DumpDexFile(std::cout, opt_granu, *dex_file.get());
-    else {
-        std::ofstream ofs(opt_out, std::ofstream::out);
-        if (!ofs.good())
-            return EXIT_FAILURE;
-        DumpDexFile(ofs, opt_granu, *dex_file.get());
+// Build the call graph of the given dex file and the other inputs, and
+// write it to the --call-graph path.
+bool DumpCallGraph(const char* path, const std::vector<const DexFile*>& dex_files,
+                   const DumpFilter& filter, ThreadPool* pool)
+{
+    if (dex_files.size() >= CallGraph::kExternal) {
+        LOG(ERROR) << "Too many input dex files for the call graph.";
+        return false;
     }
-    return EXIT_SUCCESS;
+    CallGraph graph;
+    graph.Build(dex_files, filter, pool);
+    return graph.Write(path);
 }
 
-
-void SkipAllFields(ClassDataItemIterator& it)
+OutputSink* OpenOutputSink(const DumperOption& opt, ThreadPool* pool)
 {
-    while (it.HasNextStaticField())
-        it.Next();
-    while (it.HasNextInstanceField())
-        it.Next();
+    OutputSink* file_sink = AsyncWriter::Open(opt.out, opt.direct_io);
+    if (file_sink == nullptr || !GzipWriter::IsGzipPath(opt.out))
+        return file_sink;
+    return new GzipWriter(file_sink, pool);
 }
 
-void DumpDexFile(std::ostream& os, char opt_granu, const DexFile& dex_file)
+// Dump the classes in class_def order while decoding their code items in
+// ascending file offset order. The class and method headers are laid out as
+// output segments first, with one empty segment reserved for each code item.
+// The code items of a window are then sorted by offset and decoded into their
+// reserved segments, and the segments are written in their original order.
+// Only the instruction granularity decodes code items, so it is the one
+// dumped here.
+bool DumpDexFileByOffset(OutputSink& sink, const DexFile& dex_file, const DumpFilter& filter,
+                         DumpIndex* index)
 {
+    std::vector<std::string> segments;
+    std::vector<CodeTask> tasks;
+    std::vector<SegmentSpan> class_spans, method_spans;
+    std::vector<uint64_t> segment_offsets;
+    uint32_t window_size = 0;
+    uint64_t offset = 0;
+
     uint32_t num_class_def = dex_file.NumClassDefs();
     for (uint32_t class_def_idx = 0 ; class_def_idx < num_class_def ; ++class_def_idx) {
-        os << StringPrintf("%d: %s\n", class_def_idx,
-                           PrettyClass(class_def_idx, dex_file).c_str());
-        if (opt_granu == kGranuCodeClass)
+        if (filter.KeepClass(dex_file, class_def_idx))
+            window_size += LayoutDexClass(&segments, &tasks, (index)? &class_spans : nullptr,
+                                          (index)? &method_spans : nullptr, dex_file, filter,
+                                          class_def_idx);
+
+        // Flush the window at class boundary once enough code is collected.
+        if (window_size < kOffsetOrderWindowSize && class_def_idx + 1 < num_class_def)
             continue;
-        const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_idx);
-        DumpDexClass(os, opt_granu, dex_file, class_def);
-        os << '\n';
+        std::sort(tasks.begin(), tasks.end(),
+                  [](const CodeTask& lhs, const CodeTask& rhs)
+                  { return lhs.code_off < rhs.code_off; });
+        for (const CodeTask& task : tasks)
+            TextDumper::DumpCode(&segments[task.segment], dex_file,
+                                 dex_file.GetCodeItem(task.code_off));
+        segment_offsets.clear();
+        for (const std::string& segment : segments) {
+            segment_offsets.push_back(offset);
+            offset += segment.size();
+            if (!sink.Write(segment))
+                return false;
+        }
+        if (index) {
+            for (const SegmentSpan& span : class_spans) {
+                uint64_t begin = segment_offsets[span.begin_segment] + span.begin_pos;
+                uint64_t end = segment_offsets[span.end_segment] + span.end_pos;
+                index->AddClass(span.idx, begin, end - begin);
+            }
+            for (const SegmentSpan& span : method_spans) {
+                uint64_t begin = segment_offsets[span.begin_segment] + span.begin_pos;
+                uint64_t end = segment_offsets[span.end_segment] + span.end_pos;
+                index->AddMethod(span.idx, span.class_def_idx, begin, end - begin);
+            }
+            class_spans.clear();
+            method_spans.clear();
+        }
+        segments.clear();
+        tasks.clear();
+        window_size = 0;
     }
+    return true;
 }
 
-void DumpDexClass(std::ostream& os, char opt_granu, const DexFile& dex_file,
-                  const DexFile::ClassDef& class_def)
+// Lay out the class and method headers of a class as output segments, and
+// reserve a segment for each of its code items. Returns the number of code
+// units scheduled for decoding.
+uint32_t LayoutDexClass(std::vector<std::string>* segments, std::vector<CodeTask>* tasks,
+                        std::vector<SegmentSpan>* class_spans,
+                        std::vector<SegmentSpan>* method_spans, const DexFile& dex_file,
+                        const DumpFilter& filter, uint32_t class_def_idx)
 {
+    uint32_t code_units = 0;
+    if (segments->empty())
+        segments->emplace_back();
+    SegmentSpan class_span = {class_def_idx, class_def_idx,
+                              static_cast<uint32_t>(segments->size() - 1),
+                              segments->back().size(), 0, 0};
+    StringAppendF(&segments->back(), "%d: %s\n", class_def_idx,
+                  PrettyClass(class_def_idx, dex_file).c_str());
+
+    const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_idx);
     const byte* class_data = dex_file.GetClassData(class_def);
-    if (class_data == nullptr)  // empty class such as a marker interface?
-        return;
-
-    ClassDataItemIterator it(dex_file, class_data);
-    SkipAllFields(it);
-
-    uint32_t class_method_idx = 0;
-    while (it.HasNextDirectMethod()) {
-        uint32_t dex_method_idx = it.GetMemberIndex();
-        os << StringPrintf("\t%d: %s (dex_method_idx=%d)\n", class_method_idx,
-                           PrettyMethod(dex_method_idx, dex_file, true).c_str(),
-                           dex_method_idx);
-        if (opt_granu == kGranuCodeInstruction) {
-            const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
-            DumpDexCode(os, dex_file, code_item);
-            os << '\n';
-        }
-        it.Next();
-        ++class_method_idx;
-    }
+    if (class_data != nullptr) {
+        ClassDataItemIterator it(dex_file, class_data);
+        SkipAllFields(it);
 
-    while (it.HasNextVirtualMethod()) {
-        uint32_t dex_method_idx = it.GetMemberIndex();
-        os << StringPrintf("\t%d: %s (dex_method_idx=%d)\n", class_method_idx,
-                           PrettyMethod(dex_method_idx, dex_file, true).c_str(),
-                           dex_method_idx);
-        if (opt_granu == kGranuCodeInstruction) {
+        uint32_t class_method_idx = 0;
+        for ( ; it.HasNext() ; it.Next(), ++class_method_idx) {
+            if (!filter.KeepMethod(dex_file, it.GetMemberIndex()))
+                continue;
+            SegmentSpan method_span = {it.GetMemberIndex(), class_def_idx,
+                                       static_cast<uint32_t>(segments->size() - 1),
+                                       segments->back().size(), 0, 0};
+            TextDumper::DumpMethod(&segments->back(), dex_file, class_method_idx,
+                                   it.GetMemberIndex());
             const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
-            DumpDexCode(os, dex_file, code_item);
-            os << '\n';
+            if (code_item != nullptr) {
+                CodeTask task = {it.GetMethodCodeItemOffset(),
+                                 static_cast<uint32_t>(segments->size())};
+                tasks->push_back(task);
+                segments->emplace_back();
+                segments->emplace_back();
+                code_units += code_item->insns_size_in_code_units_;
+            }
+            segments->back() += '\n';
+            if (method_spans) {
+                method_span.end_segment = segments->size() - 1;
+                method_span.end_pos = segments->back().size();
+                method_spans->push_back(method_span);
+            }
         }
-        it.Next();
-        ++class_method_idx;
+        CHECK(!it.HasNext());
     }
-    CHECK(!it.HasNext());
-}
-
-void DumpDexCode(std::ostream& os, const DexFile& dex_file,
-                 const DexFile::CodeItem* code_item)
-{
-    if (!code_item)
-        return;
-    size_t inst_off = 0;
-    while (inst_off < code_item->insns_size_in_code_units_) {
-        const Instruction* instruction = Instruction::At(&code_item->insns_[inst_off]);
-        os << StringPrintf("\t\t0x%04zx: %s\n", inst_off,
-                           instruction->DumpString(&dex_file).c_str());
-        inst_off += instruction->SizeInCodeUnits();
+    segments->back() += '\n';
+    if (class_spans) {
+        class_span.end_segment = segments->size() - 1;
+        class_span.end_pos = segments->back().size();
+        class_spans->push_back(class_span);
     }
-}
\ No newline at end of file
+    return code_units;
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+
+#include "ioc_dumper.h"
+#include "misc.h"
+#include "stringprintf.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+
+
+IocDumper::IocDumper(const std::vector<const DexFile*>& dex_files, const DumpFilter& filter)
+  : dex_files_(dex_files),
+    filter_(filter)
+{}
+
+bool IocDumper::Dump(OutputSink& sink, const char* path,
+                     const std::vector<const char*>& dex_paths, ThreadPool* pool)
+{
+    IocMatcher matcher;
+    if (!matcher.Compile(path))
+        return false;
+    for (uint32_t file = 0 ; file < dex_files_.size() ; ++file) {
+        if (!DumpFile(sink, file, dex_paths[file], matcher, pool))
+            return false;
+    }
+    return true;
+}
+
+bool IocDumper::DumpFile(OutputSink& sink, uint32_t file, const char* dex_path,
+                         const IocMatcher& matcher, ThreadPool* pool)
+{
+    const DexFile& dex_file = *dex_files_[file];
+    uint32_t num_string_ids = dex_file.NumStringIds();
+    uint32_t num_chunks = (num_string_ids + kIdChunkSize - 1) / kIdChunkSize;
+    std::vector<std::vector<uint32_t>> indicators(
+        pool->NumChunkWorkers(num_string_ids, kIdChunkSize));
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> hits(num_chunks);
+    pool->ParallelForChunks(0, num_string_ids, kIdChunkSize,
+                            [&](uint32_t worker, uint32_t chunk, uint32_t begin, uint32_t end) {
+        for (uint32_t string_idx = begin ; string_idx < end ; ++string_idx) {
+            indicators[worker].clear();
+            matcher.Scan(dex_file.StringDataByIdx(string_idx), &indicators[worker]);
+            for (uint32_t indicator : indicators[worker])
+                hits[chunk].emplace_back(string_idx, indicator);
+        }
+    });
+
+    std::vector<bool> matched(num_string_ids, false);
+    bool any_match = false;
+    for (const auto& chunk_hits : hits) {
+        for (const auto& hit : chunk_hits) {
+            matched[hit.first] = true;
+            any_match = true;
+        }
+    }
+
+    // The loads are gathered in class_def order, then grouped by string.
+    std::vector<StringLoad> loads;
+    if (any_match) {
+        uint32_t num_class_def = dex_file.NumClassDefs();
+        num_chunks = (num_class_def + kClassChunkSize - 1) / kClassChunkSize;
+        std::vector<std::vector<StringLoad>> chunk_loads(num_chunks);
+        pool->ParallelForChunks(0, num_class_def, kClassChunkSize,
+                                [&](uint32_t, uint32_t chunk, uint32_t begin, uint32_t end) {
+            for (uint32_t class_def_idx = begin ; class_def_idx < end ; ++class_def_idx)
+                ScanStringLoads(&chunk_loads[chunk], dex_file, matched, class_def_idx);
+        });
+        for (const auto& chunk_load : chunk_loads)
+            loads.insert(loads.end(), chunk_load.begin(), chunk_load.end());
+        std::stable_sort(loads.begin(), loads.end(),
+                         [](const StringLoad& a, const StringLoad& b) {
+                             return a.string_idx_ < b.string_idx_;
+                         });
+    }
+
+    std::string buf;
+    StringAppendF(&buf, "file@%u: %s\n\n", file, dex_path);
+    auto load = loads.begin();
+    for (const auto& chunk_hits : hits) {
+        for (auto hit = chunk_hits.begin() ; hit != chunk_hits.end() ; ) {
+            uint32_t string_idx = hit->first;
+            StringAppendF(&buf, "string@%u: %s\n", string_idx,
+                          PrintableString(dex_file.StringDataByIdx(string_idx)).c_str());
+            for ( ; hit != chunk_hits.end() && hit->first == string_idx ; ++hit)
+                StringAppendF(&buf, "\tioc\t%s\n",
+                              PrintableString(matcher.Indicator(hit->second).c_str()).c_str());
+            for ( ; load != loads.end() && load->string_idx_ == string_idx ; ++load)
+                StringAppendF(&buf, "\tconst-string\t0x%04x\t%s (dex_method_idx=%u)\n",
+                              load->dex_pc_,
+                              PrettyMethod(load->dex_method_idx_, dex_file, true).c_str(),
+                              load->dex_method_idx_);
+            buf += '\n';
+            if (buf.size() >= kBufferSize) {
+                if (!sink.Write(buf))
+                    return false;
+                buf.clear();
+            }
+        }
+    }
+    return sink.Write(buf);
+}
+
+void IocDumper::ScanStringLoads(std::vector<StringLoad>* loads, const DexFile& dex_file,
+                                const std::vector<bool>& matched, uint32_t class_def_idx) const
+{
+    if (!filter_.KeepClass(dex_file, class_def_idx))
+        return;
+    const byte* class_data = dex_file.GetClassData(dex_file.GetClassDef(class_def_idx));
+    if (class_data == nullptr)
+        return;
+    ClassDataItemIterator it(dex_file, class_data);
+    SkipAllFields(it);
+    for ( ; it.HasNext() ; it.Next()) {
+        uint32_t dex_method_idx = it.GetMemberIndex();
+        const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+        if (code_item == nullptr || !filter_.KeepMethod(dex_file, dex_method_idx))
+            continue;
+        uint32_t dex_pc = 0;
+        while (dex_pc < code_item->insns_size_in_code_units_) {
+            const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+            uint32_t string_idx = matched.size();
+            if (inst->Opcode() == Instruction::CONST_STRING)
+                string_idx = inst->VRegB_21c();
+            else if (inst->Opcode() == Instruction::CONST_STRING_JUMBO)
+                string_idx = inst->VRegB_31c();
+            if (string_idx < matched.size() && matched[string_idx])
+                loads->push_back({string_idx, dex_method_idx, dex_pc});
+            dex_pc += inst->SizeInCodeUnits();
+        }
+    }
+}
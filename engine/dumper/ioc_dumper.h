@@ -0,0 +1,66 @@
+#ifndef _DUMPER_IOC_DUMPER_H_
+#define _DUMPER_IOC_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "dump_filter.h"
+#include "ioc_matcher.h"
+
+
+// List the strings of every dex file containing an indicator of compromise,
+// in string_idx order, each followed by its indicators and by the
+// const-string instructions loading it in the kept methods:
+//
+//   file@0: classes.dex
+//
+//   string@3032: "http://evil.example.com/c2"
+//   	ioc	"evil.example.com"
+//   	const-string	0x000b	java.lang.String com.a.B.bar(java.lang.String) (dex_method_idx=52)
+//
+// The automaton is compiled once for all the files. The string table of a
+// file is streamed through it in parallel chunks of strings, then the code
+// is scanned in parallel chunks of classes for the loads of the matched
+// strings, only if there are any.
+class IocDumper
+{
+  public:
+    // The number of bytes of text held before writing them.
+    static constexpr size_t kBufferSize = 64 * KB;
+
+    // The files and the filter are not owned and must outlive the dumper.
+    IocDumper(const std::vector<const DexFile*>& dex_files, const DumpFilter& filter);
+
+    // Compile the indicators of the file at path and list the strings of the
+    // dex files containing them, the files named by their paths.
+    bool Dump(OutputSink& sink, const char* path, const std::vector<const char*>& dex_paths,
+              ThreadPool* pool) WARN_UNUSED;
+
+  private:
+    // A const-string loading a string that contains an indicator.
+    struct StringLoad
+    {
+        uint32_t string_idx_;
+        uint32_t dex_method_idx_;
+        uint32_t dex_pc_;
+    };
+
+    bool DumpFile(OutputSink& sink, uint32_t file, const char* dex_path,
+                  const IocMatcher& matcher, ThreadPool* pool) WARN_UNUSED;
+
+    // Append the loads of the matched strings by the kept methods of a class.
+    void ScanStringLoads(std::vector<StringLoad>* loads, const DexFile& dex_file,
+                         const std::vector<bool>& matched, uint32_t class_def_idx) const;
+
+    const std::vector<const DexFile*>& dex_files_;
+    const DumpFilter& filter_;
+
+    DISALLOW_COPY_AND_ASSIGN(IocDumper);
+};
+
+#endif
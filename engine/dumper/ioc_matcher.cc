@@ -0,0 +1,209 @@
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#endif
+
+#include "log.h"
+#include "ioc_matcher.h"
+
+
+constexpr uint32_t IocMatcher::kNoIndicator;
+
+
+#if defined(__SSE2__)
+// Returns the first byte from p in the map, which holds the NUL, compiled
+// for SSSE3 and only called once the CPU is known to support it.
+__attribute__((target("ssse3")))
+static const uint8_t* SkipOutsideMap(const uint8_t* p, const uint8_t* low_rows,
+                                     const uint8_t* high_rows, const bool* in_map)
+{
+    const __m128i low_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(low_rows));
+    const __m128i high_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(high_rows));
+    const __m128i bits = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1,
+                                      -128, 64, 32, 16, 8, 4, 2, 1);
+    const __m128i top = _mm_set1_epi8(-128);
+    const __m128i seven = _mm_set1_epi8(7);
+    while (true) {
+        if ((reinterpret_cast<uintptr_t>(p) & (kPageSize - 1)) <= kPageSize - 16) {
+            // A shuffle yields zero for an index with its top bit set, so a
+            // byte finds its row in one of the tables only.
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i rows = _mm_or_si128(_mm_shuffle_epi8(low_table, chunk),
+                                        _mm_shuffle_epi8(high_table,
+                                                         _mm_xor_si128(chunk, top)));
+            __m128i column = _mm_shuffle_epi8(
+                bits, _mm_and_si128(_mm_srli_epi16(chunk, 4), seven));
+            __m128i hits = _mm_cmpeq_epi8(_mm_and_si128(rows, column), column);
+            uint32_t stops = _mm_movemask_epi8(hits);
+            if (stops != 0)
+                return p + __builtin_ctz(stops);
+            p += 16;
+            continue;
+        }
+        if (in_map[*p])
+            return p;
+        ++p;
+    }
+}
+#endif
+
+
+IocMatcher::IocMatcher()
+  : children_(1),
+    num_classes_(0),
+    ends_(1, kNoIndicator),
+    use_shuffles_(false)
+{
+    memset(classes_, 0, sizeof(classes_));
+    memset(first_bytes_, 0, sizeof(first_bytes_));
+    memset(low_rows_, 0, sizeof(low_rows_));
+    memset(high_rows_, 0, sizeof(high_rows_));
+}
+
+bool IocMatcher::Compile(const char* path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        PLOG(ERROR) << "Fail to open the indicators file " << path;
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos)
+            continue;
+        size_t end = line.find_last_not_of(" \t\r");
+        AddIndicator(line.substr(begin, end - begin + 1));
+    }
+    if (indicators_.empty()) {
+        LOG(ERROR) << "No indicator in " << path;
+        return false;
+    }
+    FillClasses();
+    FillTable();
+    std::vector<std::vector<std::pair<uint8_t, uint32_t>>>().swap(children_);
+
+    // The NUL stops the skip too, and is a first byte from now on.
+    first_bytes_[0] = true;
+    for (uint32_t byte = 0 ; byte < 256 ; ++byte) {
+        if (!first_bytes_[byte])
+            continue;
+        if (byte < 0x80)
+            low_rows_[byte & 0xF] |= 1 << (byte >> 4);
+        else
+            high_rows_[byte & 0xF] |= 1 << ((byte >> 4) - 8);
+    }
+#if defined(__SSE2__)
+    use_shuffles_ = __builtin_cpu_supports("ssse3");
+#endif
+    return true;
+}
+
+void IocMatcher::AddIndicator(const std::string& indicator)
+{
+    uint32_t state = 0;
+    for (char ch : indicator) {
+        std::pair<uint8_t, uint32_t> key(static_cast<uint8_t>(ch), 0);
+        std::vector<std::pair<uint8_t, uint32_t>>& children = children_[state];
+        auto it = std::lower_bound(children.begin(), children.end(), key);
+        if (it != children.end() && it->first == key.first) {
+            state = it->second;
+            continue;
+        }
+        key.second = children_.size();
+        children.insert(it, key);
+        children_.emplace_back();
+        ends_.push_back(kNoIndicator);
+        state = key.second;
+    }
+    // A repeated indicator is listed once.
+    if (ends_[state] != kNoIndicator)
+        return;
+    ends_[state] = indicators_.size();
+    indicators_.push_back(indicator);
+    first_bytes_[static_cast<uint8_t>(indicator[0])] = true;
+}
+
+void IocMatcher::FillClasses()
+{
+    bool used[256] = {};
+    for (const auto& children : children_) {
+        for (const auto& child : children)
+            used[child.first] = true;
+    }
+    num_classes_ = 1;
+    for (uint32_t byte = 0 ; byte < 256 ; ++byte) {
+        if (used[byte])
+            classes_[byte] = num_classes_++;
+    }
+}
+
+void IocMatcher::FillTable()
+{
+    // The states are visited breadth first, so the failure state of a state,
+    // being shallower, has its row complete, and the row of the state starts
+    // as a copy of it.
+    uint32_t num_states = children_.size();
+    next_.assign(num_states * num_classes_, 0);
+    links_.assign(num_states, 0);
+    std::vector<uint32_t> fails(num_states, 0);
+    std::vector<uint32_t> order;
+    order.reserve(num_states);
+
+    for (const auto& child : children_[0]) {
+        next_[classes_[child.first]] = child.second;
+        order.push_back(child.second);
+    }
+    for (uint32_t head = 0 ; head < order.size() ; ++head) {
+        uint32_t state = order[head];
+        uint32_t fail = fails[state];
+        links_[state] = (ends_[fail] != kNoIndicator)? fail : links_[fail];
+
+        uint32_t* row = &next_[state * num_classes_];
+        const uint32_t* fail_row = &next_[fail * num_classes_];
+        std::copy(fail_row, fail_row + num_classes_, row);
+        for (const auto& child : children_[state]) {
+            uint8_t klass = classes_[child.first];
+            fails[child.second] = fail_row[klass];
+            row[klass] = child.second;
+            order.push_back(child.second);
+        }
+    }
+}
+
+const uint8_t* IocMatcher::SkipToFirstByte(const uint8_t* p) const
+{
+    // With many first bytes most skips stop at once, before the shuffles
+    // pay off.
+    if (first_bytes_[*p])
+        return p;
+#if defined(__SSE2__)
+    if (use_shuffles_)
+        return SkipOutsideMap(p, low_rows_, high_rows_, first_bytes_);
+#endif
+    while (!first_bytes_[*p])
+        ++p;
+    return p;
+}
+
+void IocMatcher::Scan(const char* str, std::vector<uint32_t>* indicators) const
+{
+    size_t first = indicators->size();
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(str);
+    uint32_t state = 0;
+    while (true) {
+        if (state == 0)
+            p = SkipToFirstByte(p);
+        if (*p == '\0')
+            break;
+        state = next_[state * num_classes_ + classes_[*p++]];
+        uint32_t end = (ends_[state] != kNoIndicator)? state : links_[state];
+        for ( ; end != 0 ; end = links_[end])
+            indicators->push_back(ends_[end]);
+    }
+    if (indicators->size() - first > 1) {
+        std::sort(indicators->begin() + first, indicators->end());
+        indicators->erase(std::unique(indicators->begin() + first, indicators->end()),
+                          indicators->end());
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef _DUMPER_IOC_MATCHER_H_
+#define _DUMPER_IOC_MATCHER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+
+
+// A list of indicators of compromise, such as domain names, keys and package
+// names, compiled once into an Aho-Corasick automaton that finds all of them
+// in a string by a single pass over its bytes, whatever their number.
+//
+// The indicators are read one per line, the blank lines being skipped, and
+// are matched as case sensitive substrings of the raw string data, so the
+// modified UTF-8 of a dex file equals the UTF-8 of an indicator except for
+// the NUL and the supplementary characters.
+//
+// The bytes that no indicator contains share one class, the others getting
+// one class each, and the automaton is a table of the next state by state
+// and class, with the failure links folded in. A state also has the
+// indicator ending at it, and a link to the nearest state of its failure
+// chain with one, so the matches of a state are listed without walking the
+// whole chain.
+//
+// At the root, only the first byte of an indicator moves on, so the scan
+// skips to the next such byte or the NUL. On a CPU with SSSE3, whatever the
+// number of indicators, the set of these bytes is a 256 bit map looked up for
+// 16 bytes at a time: two shuffles give the row of each byte by its low
+// nibble, in the map of the bytes below 0x80 or in the one of the others,
+// and a third shuffle gives the bit of its high nibble in the row. Single
+// bytes are checked near a page end, since the bytes past the NUL may not be
+// mapped.
+class IocMatcher
+{
+  public:
+    IocMatcher();
+
+    // Compile the indicators of the file. Returns false on an unreadable or
+    // empty file, which is logged.
+    bool Compile(const char* path) WARN_UNUSED;
+
+    uint32_t NumIndicators() const
+    {
+        return indicators_.size();
+    }
+
+    const std::string& Indicator(uint32_t indicator) const
+    {
+        return indicators_[indicator];
+    }
+
+    // Append the indicators found in the NUL terminated string, once each
+    // and in increasing order.
+    void Scan(const char* str, std::vector<uint32_t>* indicators) const;
+
+  private:
+    static constexpr uint32_t kNoIndicator = 0xFFFFFFFF;
+
+    void AddIndicator(const std::string& indicator);
+    void FillClasses();
+    void FillTable();
+
+    // Returns the first byte from p that starts an indicator, or the NUL.
+    const uint8_t* SkipToFirstByte(const uint8_t* p) const;
+
+    std::vector<std::string> indicators_;
+
+    // The trie, as the sorted (byte, child) pairs of each state, dropped
+    // once the table is filled.
+    std::vector<std::vector<std::pair<uint8_t, uint32_t>>> children_;
+
+    uint8_t classes_[256];
+    uint32_t num_classes_;
+    std::vector<uint32_t> next_;  // by state and class
+    std::vector<uint32_t> ends_;  // the indicator ending at each state
+    std::vector<uint32_t> links_;  // the nearest state of the failure chain with an indicator
+
+    bool first_bytes_[256];  // the first bytes of the indicators, and the NUL once compiled
+
+    // The map of the first bytes and the NUL, by low nibble, as the bits of
+    // the high nibbles 0 to 7 and 8 to 15.
+    uint8_t low_rows_[16];
+    uint8_t high_rows_[16];
+    bool use_shuffles_;
+
+    DISALLOW_COPY_AND_ASSIGN(IocMatcher);
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "json_dumper.h"
+#include "cmd_opt.h"
+#include "misc.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+
+
+JsonDumper::JsonDumper(const DexFile& dex_file, char opt_granu,
+                       const DumpFilter& filter)
+  : dex_file_(dex_file),
+    opt_granu_(opt_granu),
+    filter_(filter),
+    writer_(nullptr),
+    type_names_(dex_file.NumTypeIds()),
+    field_names_(dex_file.NumFieldIds()),
+    method_names_(dex_file.NumMethodIds())
+{}
+
+bool JsonDumper::Dump(OutputSink& sink)
+{
+    std::unique_ptr<JsonLinesWriter> writer(new JsonLinesWriter(&sink));
+    writer_ = writer.get();
+    uint32_t num_class_def = dex_file_.NumClassDefs();
+    for (uint32_t class_def_idx = 0 ; class_def_idx < num_class_def ; ++class_def_idx) {
+        if (filter_.KeepClass(dex_file_, class_def_idx))
+            DumpClass(class_def_idx);
+    }
+    writer_ = nullptr;
+    return writer->Flush();
+}
+
+void JsonDumper::DumpClass(uint32_t class_def_idx)
+{
+    const DexFile::ClassDef& class_def = dex_file_.GetClassDef(class_def_idx);
+    writer_->BeginRecord();
+    writer_->AddString("kind", "class");
+    writer_->AddUint("class_def_idx", class_def_idx);
+    writer_->AddString("name", TypeName(class_def.class_idx_));
+    if (class_def.superclass_idx_ != DexFile::kDexNoIndex16)
+        writer_->AddString("superclass", TypeName(class_def.superclass_idx_));
+    writer_->AddUint("access_flags", class_def.access_flags_);
+    writer_->EndRecord();
+    if (opt_granu_ == kGranuCodeClass)
+        return;
+
+    const byte* class_data = dex_file_.GetClassData(class_def);
+    if (class_data == nullptr)
+        return;
+    ClassDataItemIterator it(dex_file_, class_data);
+    SkipAllFields(it);
+    for (uint32_t class_method_idx = 0 ; it.HasNext() ; it.Next(), ++class_method_idx) {
+        uint32_t dex_method_idx = it.GetMemberIndex();
+        if (!filter_.KeepMethod(dex_file_, dex_method_idx))
+            continue;
+        DumpMethod(class_def_idx, class_method_idx, dex_method_idx,
+                   it.GetRawMemberAccessFlags(), it.GetMethodCodeItemOffset());
+
+        const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+        if (opt_granu_ == kGranuCodeInstruction && code_item != nullptr) {
+            uint32_t dex_pc = 0;
+            while (dex_pc < code_item->insns_size_in_code_units_) {
+                const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+                DumpInstruction(class_def_idx, dex_method_idx, dex_pc, inst);
+                dex_pc += inst->SizeInCodeUnits();
+            }
+        }
+    }
+}
+
+void JsonDumper::DumpMethod(uint32_t class_def_idx, uint32_t class_method_idx,
+                            uint32_t dex_method_idx, uint32_t access_flags,
+                            uint32_t code_off)
+{
+    writer_->BeginRecord();
+    writer_->AddString("kind", "method");
+    writer_->AddUint("class_def_idx", class_def_idx);
+    writer_->AddUint("class_method_idx", class_method_idx);
+    writer_->AddUint("dex_method_idx", dex_method_idx);
+    writer_->AddString("name", MethodName(dex_method_idx));
+    writer_->AddUint("access_flags", access_flags);
+    writer_->AddUint("code_off", code_off);
+    writer_->EndRecord();
+}
+
+void JsonDumper::DumpInstruction(uint32_t class_def_idx, uint32_t dex_method_idx,
+                                 uint32_t dex_pc, const Instruction* inst)
+{
+    writer_->BeginRecord();
+    writer_->AddString("kind", "insn");
+    writer_->AddUint("class_def_idx", class_def_idx);
+    writer_->AddUint("dex_method_idx", dex_method_idx);
+    writer_->AddUint("dex_pc", dex_pc);
+    writer_->AddString("op", inst->Name());
+    if (inst->HasVRegA())
+        writer_->AddInt("vA", inst->VRegA());
+    if (inst->HasWideVRegB())
+        writer_->AddInt("vB", inst->WideVRegB());
+    else if (inst->HasVRegB())
+        writer_->AddInt("vB", inst->VRegB());
+    if (inst->HasVRegC())
+        writer_->AddInt("vC", inst->VRegC());
+    if (inst->HasVarArgs()) {
+        uint32_t args[Instruction::kMaxVarArgRegs];
+        inst->GetVarArgs(args);
+        writer_->AddUintArray("args", args, inst->VRegA_35c());
+    }
+    DumpReference(inst);
+    writer_->EndRecord();
+}
+
+void JsonDumper::DumpReference(const Instruction* inst)
+{
+    // The quickened instructions carry offsets rather than dex indices.
+    if (inst->GetVerifyIsRuntimeOnly())
+        return;
+    uint32_t idx = inst->GetIndexOperand();
+    switch (Instruction::IndexTypeOf(inst->Opcode())) {
+      case Instruction::kStringRef:
+        if (idx >= dex_file_.NumStringIds())
+            return;
+        writer_->AddUint("string_idx", idx);
+        writer_->AddString("string", dex_file_.StringDataByIdx(idx));
+        return;
+      case Instruction::kTypeRef:
+        if (idx >= dex_file_.NumTypeIds())
+            return;
+        writer_->AddUint("type_idx", idx);
+        writer_->AddString("type", TypeName(idx));
+        return;
+      case Instruction::kFieldRef:
+        if (idx >= dex_file_.NumFieldIds())
+            return;
+        writer_->AddUint("field_idx", idx);
+        writer_->AddString("field", FieldName(idx));
+        return;
+      case Instruction::kMethodRef:
+        if (idx >= dex_file_.NumMethodIds())
+            return;
+        writer_->AddUint("method_idx", idx);
+        writer_->AddString("method", MethodName(idx));
+        return;
+      default:
+        return;
+    }
+}
+
+const std::string& JsonDumper::TypeName(uint32_t type_idx)
+{
+    if (type_idx >= type_names_.size()) {
+        invalid_name_ = PrettyType(type_idx, dex_file_);
+        return invalid_name_;
+    }
+    std::string& name = type_names_[type_idx];
+    if (name.empty())
+        name = PrettyType(type_idx, dex_file_);
+    return name;
+}
+
+const std::string& JsonDumper::FieldName(uint32_t field_idx)
+{
+    if (field_idx >= field_names_.size()) {
+        invalid_name_ = PrettyField(field_idx, dex_file_, true);
+        return invalid_name_;
+    }
+    std::string& name = field_names_[field_idx];
+    if (name.empty())
+        name = PrettyField(field_idx, dex_file_, true);
+    return name;
+}
+
+const std::string& JsonDumper::MethodName(uint32_t method_idx)
+{
+    if (method_idx >= method_names_.size()) {
+        invalid_name_ = PrettyMethod(method_idx, dex_file_, true);
+        return invalid_name_;
+    }
+    std::string& name = method_names_[method_idx];
+    if (name.empty())
+        name = PrettyMethod(method_idx, dex_file_, true);
+    return name;
+}
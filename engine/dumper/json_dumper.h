@@ -0,0 +1,63 @@
+#ifndef _DUMPER_JSON_DUMPER_H_
+#define _DUMPER_JSON_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+#include "json_writer.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "dump_filter.h"
+
+
+// Dump a dex file as JSON Lines, one flat object per class, method or
+// instruction depending on the granularity:
+//
+//   {"kind":"class","class_def_idx":0,"name":"a.b.C","superclass":"java.lang.Object"}
+//   {"kind":"method","class_def_idx":0,"class_method_idx":0,"dex_method_idx":51,
+//    "name":"void a.b.C.<init>()","access_flags":65537,"code_off":8260}
+//   {"kind":"insn","class_def_idx":0,"dex_method_idx":51,"dex_pc":0,
+//    "op":"invoke-direct","vA":1,"vC":0,"args":[0],"method_idx":153,
+//    "method":"void java.lang.Object.<init>()"}
+//
+// The register fields are present only for the operands of the instruction
+// format, and the referred string, type, field or method is given by both
+// its dex index and its name.
+class JsonDumper
+{
+  public:
+    // The filter is not owned and must outlive the dumper.
+    JsonDumper(const DexFile& dex_file, char opt_granu, const DumpFilter& filter);
+
+    bool Dump(OutputSink& sink) WARN_UNUSED;
+
+  private:
+    void DumpClass(uint32_t class_def_idx);
+    void DumpMethod(uint32_t class_def_idx, uint32_t class_method_idx,
+                    uint32_t dex_method_idx, uint32_t access_flags, uint32_t code_off);
+    void DumpInstruction(uint32_t class_def_idx, uint32_t dex_method_idx,
+                         uint32_t dex_pc, const Instruction* inst);
+    void DumpReference(const Instruction* inst);
+
+    // The pretty names, rendered once per dex index and reused by every
+    // record referring to it.
+    const std::string& TypeName(uint32_t type_idx);
+    const std::string& FieldName(uint32_t field_idx);
+    const std::string& MethodName(uint32_t method_idx);
+
+    const DexFile& dex_file_;
+    const char opt_granu_;
+    const DumpFilter& filter_;
+    JsonLinesWriter* writer_;
+
+    std::vector<std::string> type_names_;
+    std::vector<std::string> field_names_;
+    std::vector<std::string> method_names_;
+    std::string invalid_name_;  // the name of the last out of range index
+
+    DISALLOW_COPY_AND_ASSIGN(JsonDumper);
+};
+
+#endif
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "method_cfg.h"
+#include "leb128.h"
+#include "dex_instruction-inl.h"
+
+
+constexpr uint32_t MethodCfg::kNoBlock;
+
+
+// Returns the targets of the switch at dex_pc, relative to dex_pc, or nullptr
+// if its payload is misplaced or malformed.
+static const int32_t* SwitchTargets(const DexFile::CodeItem* code_item, uint32_t dex_pc,
+                                    const Instruction* inst, uint32_t* num_targets)
+{
+    int64_t insns_size = code_item->insns_size_in_code_units_;
+    int64_t payload_pc = static_cast<int64_t>(dex_pc) + inst->VRegB_31t();
+    if (payload_pc < 0 || (payload_pc & 1) != 0 || payload_pc + 2 > insns_size)
+        return nullptr;
+
+    const uint16_t* payload = &code_item->insns_[payload_pc];
+    if (inst->Opcode() == Instruction::PACKED_SWITCH) {
+        const Instruction::PackedSwitchPayload* packed =
+            reinterpret_cast<const Instruction::PackedSwitchPayload*>(payload);
+        if (packed->ident != Instruction::kPackedSwitchSignature ||
+            payload_pc + 4 + packed->case_count * 2 > insns_size)
+            return nullptr;
+        *num_targets = packed->case_count;
+        return packed->targets;
+    }
+    const Instruction::SparseSwitchPayload* sparse =
+        reinterpret_cast<const Instruction::SparseSwitchPayload*>(payload);
+    if (sparse->ident != Instruction::kSparseSwitchSignature ||
+        payload_pc + 2 + sparse->case_count * 4 > insns_size)
+        return nullptr;
+    *num_targets = sparse->case_count;
+    return sparse->GetTargets();
+}
+
+bool MethodCfg::Build(const DexFile::CodeItem* code_item)
+{
+    blocks_.clear();
+    succs_.clear();
+    rpo_.clear();
+
+    uint32_t insns_size = code_item->insns_size_in_code_units_;
+    if (insns_size == 0)
+        return false;
+    block_of_pc_.assign(insns_size, kNoBlock);
+    pc_flags_.assign(insns_size + 1, 0);
+
+    if (!ReadTries(code_item) || !MarkLeaders(code_item))
+        return false;
+    FillBlocks(code_item);
+    if (!FillSuccessors(code_item))
+        return false;
+    FillPredecessors();
+    FillReversePostorder();
+    return true;
+}
+
+bool MethodCfg::ReadTries(const DexFile::CodeItem* code_item)
+{
+    tries_.clear();
+    handlers_.clear();
+    if (code_item->tries_size_ == 0)
+        return true;
+
+    // The try items follow the instructions, padded to four bytes, and the
+    // encoded catch handler list follows the try items.
+    uint32_t insns_size = code_item->insns_size_in_code_units_;
+    const DexFile::TryItem* items = reinterpret_cast<const DexFile::TryItem*>(
+        &code_item->insns_[insns_size + (insns_size & 1)]);
+    const byte* handler_list = reinterpret_cast<const byte*>(&items[code_item->tries_size_]);
+
+    uint32_t prev_end_pc = 0;
+    for (uint32_t i = 0 ; i < code_item->tries_size_ ; ++i) {
+        const DexFile::TryItem& item = items[i];
+        uint32_t start_pc = item.start_addr_;
+        uint32_t end_pc = start_pc + item.insn_count_;
+        if (start_pc < prev_end_pc || end_pc <= start_pc || end_pc > insns_size)
+            return false;
+        prev_end_pc = end_pc;
+
+        Try entry = {start_pc, end_pc, static_cast<uint32_t>(handlers_.size()), 0};
+        const byte* data = handler_list + item.handler_off_;
+        int32_t size = DecodeSignedLeb128(&data);
+        for (int32_t j = 0 ; j < std::abs(size) ; ++j) {
+            Handler handler;
+            handler.type_idx_ = DecodeUnsignedLeb128(&data);
+            handler.dex_pc_ = DecodeUnsignedLeb128(&data);
+            handlers_.push_back(handler);
+        }
+        if (size <= 0) {
+            Handler handler = {DecodeUnsignedLeb128(&data), DexFile::kDexNoIndex};
+            handlers_.push_back(handler);
+        }
+        entry.handlers_end_ = handlers_.size();
+        tries_.push_back(entry);
+    }
+    return true;
+}
+
+bool MethodCfg::MarkLeaders(const DexFile::CodeItem* code_item)
+{
+    uint32_t insns_size = code_item->insns_size_in_code_units_;
+    pc_flags_[0] |= kLeader;
+
+    // The targets are checked against the instruction starts once all of
+    // them are known, as a branch may go forward.
+    uint32_t dex_pc = 0;
+    uint32_t next_try = 0;
+    while (dex_pc < insns_size) {
+        const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+        uint32_t next_pc = dex_pc + inst->SizeInCodeUnits();
+        if (next_pc > insns_size)
+            return false;
+        pc_flags_[dex_pc] |= kInsnStart;
+        if (inst->IsThrow()) {
+            pc_flags_[dex_pc] |= kCanThrow;
+            // A covered instruction that can throw ends its block, so that
+            // the exceptional edges leave from the instruction itself.
+            while (next_try < tries_.size() && tries_[next_try].end_pc_ <= dex_pc)
+                ++next_try;
+            if (next_try < tries_.size() && tries_[next_try].start_pc_ <= dex_pc)
+                pc_flags_[next_pc] |= kLeader;
+        }
+
+        if (inst->IsBranch()) {
+            int64_t target_pc = static_cast<int64_t>(dex_pc) + inst->GetTargetOffset();
+            if (target_pc < 0 || target_pc >= insns_size)
+                return false;
+            pc_flags_[target_pc] |= kLeader;
+            pc_flags_[next_pc] |= kLeader;
+        } else if (inst->IsSwitch()) {
+            uint32_t num_targets;
+            const int32_t* targets = SwitchTargets(code_item, dex_pc, inst, &num_targets);
+            if (targets == nullptr)
+                return false;
+            for (uint32_t i = 0 ; i < num_targets ; ++i) {
+                int64_t target_pc = static_cast<int64_t>(dex_pc) + targets[i];
+                if (target_pc < 0 || target_pc >= insns_size)
+                    return false;
+                pc_flags_[target_pc] |= kLeader;
+            }
+            pc_flags_[next_pc] |= kLeader;
+        } else if (inst->IsPayload()) {
+            // A payload is never executed, keep it in a block of its own.
+            pc_flags_[dex_pc] |= kLeader;
+            pc_flags_[next_pc] |= kLeader;
+        } else if (inst->IsBasicBlockEnd()) {
+            pc_flags_[next_pc] |= kLeader;
+        }
+        dex_pc = next_pc;
+    }
+
+    for (const Try& entry : tries_) {
+        pc_flags_[entry.start_pc_] |= kLeader;
+        pc_flags_[entry.end_pc_] |= kLeader;
+    }
+    for (const Handler& handler : handlers_) {
+        if (handler.dex_pc_ >= insns_size)
+            return false;
+        pc_flags_[handler.dex_pc_] |= kLeader;
+    }
+
+    for (dex_pc = 0 ; dex_pc < insns_size ; ++dex_pc) {
+        if ((pc_flags_[dex_pc] & (kLeader | kInsnStart)) == kLeader)
+            return false;
+    }
+    return true;
+}
+
+void MethodCfg::FillBlocks(const DexFile::CodeItem* code_item)
+{
+    uint32_t insns_size = code_item->insns_size_in_code_units_;
+    for (uint32_t dex_pc = 0 ; dex_pc < insns_size ; ++dex_pc) {
+        uint8_t flags = pc_flags_[dex_pc];
+        if ((flags & kInsnStart) == 0)
+            continue;
+        if ((flags & kLeader) != 0) {
+            if (!blocks_.empty())
+                blocks_.back().end_pc_ = dex_pc;
+            Block block = {dex_pc, insns_size, dex_pc, false};
+            blocks_.push_back(block);
+        }
+        Block& block = blocks_.back();
+        block.last_pc_ = dex_pc;
+        block.can_throw_ = block.can_throw_ || (flags & kCanThrow) != 0;
+        block_of_pc_[dex_pc] = blocks_.size() - 1;
+    }
+}
+
+bool MethodCfg::FillSuccessors(const DexFile::CodeItem* code_item)
+{
+    uint32_t insns_size = code_item->insns_size_in_code_units_;
+    uint32_t num_blocks = blocks_.size();
+    succ_offsets_.resize(num_blocks + 1);
+    last_source_.assign(num_blocks, kNoBlock);
+
+    uint32_t next_try = 0;
+    for (uint32_t block_idx = 0 ; block_idx < num_blocks ; ++block_idx) {
+        succ_offsets_[block_idx] = succs_.size();
+        const Block& block = blocks_[block_idx];
+        const Instruction* last = Instruction::At(&code_item->insns_[block.last_pc_]);
+
+        if (last->CanFlowThrough() && !last->IsPayload()) {
+            if (block.end_pc_ >= insns_size)
+                return false;
+            AddEdge(block_idx, block.end_pc_, kFallthrough);
+        }
+        if (last->IsBranch()) {
+            AddEdge(block_idx, block.last_pc_ + last->GetTargetOffset(), kBranch);
+        } else if (last->IsSwitch()) {
+            uint32_t num_targets;
+            const int32_t* targets = SwitchTargets(code_item, block.last_pc_, last, &num_targets);
+            for (uint32_t i = 0 ; i < num_targets ; ++i)
+                AddEdge(block_idx, block.last_pc_ + targets[i], kSwitch);
+        }
+
+        // The blocks and the try items are both in address order, and a
+        // block never straddles a try boundary.
+        while (next_try < tries_.size() && tries_[next_try].end_pc_ <= block.start_pc_)
+            ++next_try;
+        if (block.can_throw_ && next_try < tries_.size() &&
+            tries_[next_try].start_pc_ <= block.start_pc_) {
+            const Try& entry = tries_[next_try];
+            for (uint32_t i = entry.handlers_begin_ ; i < entry.handlers_end_ ; ++i)
+                AddEdge(block_idx, handlers_[i].dex_pc_, kException);
+        }
+    }
+    succ_offsets_[num_blocks] = succs_.size();
+    return true;
+}
+
+void MethodCfg::AddEdge(uint32_t source, uint32_t target_pc, EdgeKind kind)
+{
+    uint32_t target = block_of_pc_[target_pc];
+    if (last_source_[target] == source)
+        return;
+    last_source_[target] = source;
+    Edge edge = {target, kind};
+    succs_.push_back(edge);
+}
+
+void MethodCfg::FillPredecessors()
+{
+    uint32_t num_blocks = blocks_.size();
+    pred_offsets_.assign(num_blocks + 1, 0);
+    for (const Edge& edge : succs_)
+        ++pred_offsets_[edge.block_ + 1];
+    for (uint32_t i = 0 ; i < num_blocks ; ++i)
+        pred_offsets_[i + 1] += pred_offsets_[i];
+
+    // Scatter the sources in block order, so the predecessors of a block
+    // are sorted.
+    preds_.resize(succs_.size());
+    stack_.assign(pred_offsets_.begin(), pred_offsets_.end() - 1);
+    for (uint32_t block_idx = 0 ; block_idx < num_blocks ; ++block_idx) {
+        for (const Edge& edge : Successors(block_idx))
+            preds_[stack_[edge.block_]++] = block_idx;
+    }
+}
+
+void MethodCfg::FillReversePostorder()
+{
+    // An iterative depth first search from the entry, where the stack holds
+    // the blocks being visited and rpo_number_ temporarily holds the
+    // position of the next successor to visit of each of them.
+    uint32_t num_blocks = blocks_.size();
+    rpo_number_.assign(num_blocks, kNoBlock);
+    stack_.clear();
+    stack_.push_back(0);
+    rpo_number_[0] = 0;
+    while (!stack_.empty()) {
+        uint32_t block_idx = stack_.back();
+        Range<Edge> succs = Successors(block_idx);
+        uint32_t& next = rpo_number_[block_idx];
+        while (next < succs.size() && rpo_number_[succs.begin()[next].block_] != kNoBlock)
+            ++next;
+        if (next < succs.size()) {
+            uint32_t succ = succs.begin()[next++].block_;
+            rpo_number_[succ] = 0;
+            stack_.push_back(succ);
+            continue;
+        }
+        rpo_.push_back(block_idx);
+        stack_.pop_back();
+    }
+
+    std::reverse(rpo_.begin(), rpo_.end());
+    for (uint32_t i = 0 ; i < rpo_.size() ; ++i)
+        rpo_number_[rpo_[i]] = i;
+}
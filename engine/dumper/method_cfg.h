@@ -0,0 +1,169 @@
+#ifndef _DUMPER_METHOD_CFG_H_
+#define _DUMPER_METHOD_CFG_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "range.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+
+
+// The control flow graph of a code item. The basic blocks are split at the
+// targets of the branches and switches, after the instructions ending a
+// block, at the handler addresses, and at the boundaries of the try items,
+// so that a block is either entirely covered by a try item or not at all. A
+// covered instruction that can throw also ends its block, which then gets one
+// exceptional edge per handler of its try item: the registers flowing along
+// such an edge are the ones before that last instruction.
+//
+// The blocks are numbered densely in address order, block 0 starting at
+// dex_pc 0, and the edges are stored as compressed sparse rows: the edges
+// leaving block b are succs_[succ_offsets_[b], succ_offsets_[b+1]). The
+// blocks reachable from the entry are also listed in reverse postorder.
+//
+// A graph is meant to be rebuilt in place for one method after another, so
+// that the arrays keep their capacity across the methods of a worker.
+class MethodCfg
+{
+  public:
+    static constexpr uint32_t kNoBlock = 0xFFFFFFFF;
+
+    enum EdgeKind
+    {
+        kFallthrough = 0,
+        kBranch,
+        kSwitch,
+        kException,
+    };
+
+    // The instructions [start_pc_, end_pc_), the last one starting at last_pc_.
+    struct Block
+    {
+        uint32_t start_pc_;
+        uint32_t end_pc_;
+        uint32_t last_pc_;
+        bool can_throw_;
+    };
+
+    // A catch clause of a try item.
+    struct Handler
+    {
+        uint32_t dex_pc_;
+        uint32_t type_idx_;  // DexFile::kDexNoIndex for a catch-all
+    };
+
+    struct Edge
+    {
+        uint32_t block_;
+        EdgeKind kind_;
+    };
+
+    MethodCfg() {}
+
+    // Build the graph of the code item. Returns false if a branch, a switch
+    // or a handler leads outside of the instructions or into the middle of
+    // one, or if the last block falls off the end of the code.
+    bool Build(const DexFile::CodeItem* code_item) WARN_UNUSED;
+
+    uint32_t NumBlocks() const
+    {
+        return blocks_.size();
+    }
+
+    const Block& GetBlock(uint32_t block) const
+    {
+        return blocks_[block];
+    }
+
+    // Returns the block of the instruction starting at dex_pc, or kNoBlock.
+    uint32_t BlockOf(uint32_t dex_pc) const
+    {
+        return (dex_pc < block_of_pc_.size())? block_of_pc_[dex_pc] : kNoBlock;
+    }
+
+    Range<Edge> Successors(uint32_t block) const
+    {
+        const Edge* base = succs_.data();
+        return Range<Edge>(base + succ_offsets_[block], base + succ_offsets_[block + 1]);
+    }
+
+    Range<uint32_t> Predecessors(uint32_t block) const
+    {
+        const uint32_t* base = preds_.data();
+        return Range<uint32_t>(base + pred_offsets_[block], base + pred_offsets_[block + 1]);
+    }
+
+    // The blocks reachable from the entry, in reverse postorder.
+    const std::vector<uint32_t>& ReversePostorder() const
+    {
+        return rpo_;
+    }
+
+    // Returns the position of the block in ReversePostorder(), or kNoBlock
+    // if the block is unreachable.
+    uint32_t RpoNumber(uint32_t block) const
+    {
+        return rpo_number_[block];
+    }
+
+    bool IsReachable(uint32_t block) const
+    {
+        return rpo_number_[block] != kNoBlock;
+    }
+
+    // The catch clauses of all the try items, in the order of the items.
+    const std::vector<Handler>& Handlers() const
+    {
+        return handlers_;
+    }
+
+  private:
+    enum PcFlag
+    {
+        kInsnStart = 0x1,
+        kLeader = 0x2,
+        kCanThrow = 0x4,
+    };
+
+    // The handlers of a try item, as offsets into handlers_.
+    struct Try
+    {
+        uint32_t start_pc_;
+        uint32_t end_pc_;
+        uint32_t handlers_begin_;
+        uint32_t handlers_end_;
+    };
+
+    bool ReadTries(const DexFile::CodeItem* code_item);
+    bool MarkLeaders(const DexFile::CodeItem* code_item);
+    void FillBlocks(const DexFile::CodeItem* code_item);
+    bool FillSuccessors(const DexFile::CodeItem* code_item);
+    void AddEdge(uint32_t source, uint32_t target_pc, EdgeKind kind);
+    void FillPredecessors();
+    void FillReversePostorder();
+
+    std::vector<Block> blocks_;
+    std::vector<uint32_t> block_of_pc_;
+    std::vector<uint8_t> pc_flags_;
+    std::vector<Try> tries_;
+    std::vector<Handler> handlers_;
+
+    std::vector<uint32_t> succ_offsets_;  // of size NumBlocks() + 1
+    std::vector<Edge> succs_;
+    std::vector<uint32_t> pred_offsets_;  // of size NumBlocks() + 1
+    std::vector<uint32_t> preds_;
+
+    std::vector<uint32_t> rpo_;
+    std::vector<uint32_t> rpo_number_;
+
+    // The source block of the last edge added to each block, to drop the
+    // duplicated edges.
+    std::vector<uint32_t> last_source_;
+    std::vector<uint32_t> stack_;
+
+    DISALLOW_COPY_AND_ASSIGN(MethodCfg);
+};
+
+#endif
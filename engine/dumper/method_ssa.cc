@@ -0,0 +1,366 @@
+#include <algorithm>
+
+#include "method_ssa.h"
+#include "modifiers.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+#include "misc.h"
+
+
+constexpr uint32_t MethodSsa::kNoValue;
+constexpr uint32_t MethodSsa::kNoBlock;
+constexpr uint32_t MethodSsa::kNoPc;
+constexpr uint32_t MethodSsa::kUndefinedValue;
+constexpr uint32_t MethodSsa::kNoReg;
+
+
+bool MethodSsa::Build(const DexFile& dex_file, uint32_t dex_method_idx, uint32_t access_flags,
+                      const DexFile::CodeItem* code_item, const MethodCfg& cfg,
+                      const Dominance& dominance)
+{
+    num_regs_ = code_item->registers_size_;
+    values_.clear();
+    operands_.clear();
+    Value undefined = {kUndefined, false, kNoReg, kNoBlock, kNoPc, 0, 0};
+    values_.push_back(undefined);
+
+    if (!ScanInsns(code_item, cfg))
+        return false;
+    AddParameters(dex_file, dex_method_idx, access_flags, code_item);
+    FillFrontiers(cfg, dominance);
+    PlacePhis(cfg);
+    Rename(cfg, dominance);
+    return true;
+}
+
+MethodSsa::Def MethodSsa::DecodeRegisters(const Instruction* inst)
+{
+    Instruction::Code opcode = inst->Opcode();
+    int flags = Instruction::VerifyFlagsOf(opcode);
+    Def def = {kNoReg, false, kDefinition};
+
+    if ((flags & (Instruction::kVerifyRegA | Instruction::kVerifyRegAWide)) != 0) {
+        uint32_t reg = inst->VRegA();
+        if (!inst->WritesRegisterA()) {
+            use_regs_.push_back(reg);
+        } else {
+            def.reg_ = reg;
+            def.wide_ = (flags & Instruction::kVerifyRegAWide) != 0;
+            if ((opcode >= Instruction::ADD_INT_2ADDR && opcode <= Instruction::REM_DOUBLE_2ADDR) ||
+                opcode == Instruction::CHECK_CAST)
+                use_regs_.push_back(reg);
+            if (opcode >= Instruction::MOVE_RESULT && opcode <= Instruction::MOVE_RESULT_OBJECT)
+                def.kind_ = kResult;
+            else if (opcode == Instruction::MOVE_EXCEPTION)
+                def.kind_ = kCaughtException;
+        }
+    }
+    if ((flags & (Instruction::kVerifyRegB | Instruction::kVerifyRegBWide)) != 0)
+        use_regs_.push_back(inst->VRegB());
+    if ((flags & (Instruction::kVerifyRegC | Instruction::kVerifyRegCWide)) != 0)
+        use_regs_.push_back(inst->VRegC());
+
+    if ((flags & (Instruction::kVerifyVarArg | Instruction::kVerifyVarArgNonZero)) != 0) {
+        uint32_t args[Instruction::kMaxVarArgRegs];
+        inst->GetVarArgs(args);
+        uint32_t count = inst->VRegA_35c();
+        if (count > Instruction::kMaxVarArgRegs)
+            count = Instruction::kMaxVarArgRegs;
+        use_regs_.insert(use_regs_.end(), args, args + count);
+    } else if ((flags & (Instruction::kVerifyVarArgRange |
+                         Instruction::kVerifyVarArgRangeNonZero)) != 0) {
+        uint32_t first = inst->VRegC_3rc();
+        for (uint32_t i = 0 ; i < inst->VRegA_3rc() ; ++i)
+            use_regs_.push_back(first + i);
+    }
+    return def;
+}
+
+bool MethodSsa::ScanInsns(const DexFile::CodeItem* code_item, const MethodCfg& cfg)
+{
+    uint32_t num_blocks = cfg.NumBlocks();
+    insns_.clear();
+    defs_.clear();
+    use_regs_.clear();
+    insn_of_pc_.assign(code_item->insns_size_in_code_units_, kNoValue);
+    block_insns_.assign(num_blocks + 1, 0);
+
+    // A register read in a block before being written there is global, and
+    // the blocks writing a register are its definition sites. The stamp of
+    // a register is the last block writing it.
+    globals_.assign(num_regs_, false);
+    stamps_.assign(num_regs_, kNoBlock);
+    pairs_.clear();
+    throw_pairs_.clear();
+    for (uint32_t block = 0 ; block < num_blocks ; ++block) {
+        block_insns_[block] = insns_.size();
+        if (!cfg.IsReachable(block))
+            continue;
+        const MethodCfg::Block& range = cfg.GetBlock(block);
+        uint32_t dex_pc = range.start_pc_;
+        while (dex_pc < range.end_pc_) {
+            const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+            uint32_t uses_begin = use_regs_.size();
+            Def def = DecodeRegisters(inst);
+            for (uint32_t i = uses_begin ; i < use_regs_.size() ; ++i) {
+                uint32_t reg = use_regs_[i];
+                if (reg >= num_regs_)
+                    return false;
+                if (stamps_[reg] != block)
+                    globals_[reg] = true;
+            }
+            if (def.reg_ != kNoReg) {
+                uint32_t last_reg = def.reg_ + ((def.wide_)? 1 : 0);
+                if (last_reg >= num_regs_)
+                    return false;
+                for (uint32_t reg = def.reg_ ; reg <= last_reg ; ++reg) {
+                    if (stamps_[reg] != block) {
+                        stamps_[reg] = block;
+                        pairs_.push_back(std::make_pair(reg, block));
+                    }
+                }
+            }
+
+            insn_of_pc_[dex_pc] = insns_.size();
+            Insn insn = {dex_pc, kNoValue, uses_begin, static_cast<uint32_t>(use_regs_.size())};
+            insns_.push_back(insn);
+            defs_.push_back(def);
+            dex_pc += inst->SizeInCodeUnits();
+        }
+
+        // The handlers of a block ending with a write see the registers
+        // before it.
+        if (insns_.size() == block_insns_[block] || defs_.back().reg_ == kNoReg)
+            continue;
+        const Def& last = defs_.back();
+        for (const MethodCfg::Edge& edge : cfg.Successors(block)) {
+            if (edge.kind_ != MethodCfg::kException)
+                continue;
+            throw_pairs_.push_back(std::make_pair(last.reg_, edge.block_));
+            if (last.wide_)
+                throw_pairs_.push_back(std::make_pair(last.reg_ + 1, edge.block_));
+        }
+    }
+    block_insns_[num_blocks] = insns_.size();
+    uses_.assign(use_regs_.size(), kUndefinedValue);
+
+    // The entry writes every register, with a parameter or the undefined
+    // value.
+    for (uint32_t reg = 0 ; reg < num_regs_ ; ++reg) {
+        if (globals_[reg])
+            pairs_.push_back(std::make_pair(reg, 0));
+    }
+    Bucket(pairs_, num_regs_, &def_site_offsets_, &def_sites_);
+    Bucket(throw_pairs_, num_regs_, &handler_offsets_, &handlers_);
+    return true;
+}
+
+void MethodSsa::AddParameters(const DexFile& dex_file, uint32_t dex_method_idx,
+                              uint32_t access_flags, const DexFile::CodeItem* code_item)
+{
+    // The ins are the last registers, starting with this for an instance
+    // method, then the parameters by the shorty, where a long or a double
+    // takes a register pair.
+    current_.assign(num_regs_, kUndefinedValue);
+    uint32_t reg = num_regs_ - std::min<uint32_t>(code_item->ins_size_, num_regs_);
+    uint32_t first = values_.size();
+    const char* shorty = dex_file.GetMethodShorty(dex_file.GetMethodId(dex_method_idx));
+    const char* param = shorty + 1;
+    bool is_this = (access_flags & kAccStatic) == 0;
+    while (reg < num_regs_ && (is_this || *param != '\0')) {
+        bool wide = !is_this && (*param == 'J' || *param == 'D') && reg + 1 < num_regs_;
+        Value value = {kParameter, wide, reg, kNoBlock, kNoPc, 0, 0};
+        current_[reg] = values_.size();
+        if (wide)
+            current_[reg + 1] = values_.size();
+        values_.push_back(value);
+        reg += (wide)? 2 : 1;
+        if (is_this)
+            is_this = false;
+        else
+            ++param;
+    }
+    num_parameters_ = values_.size() - first;
+}
+
+void MethodSsa::FillFrontiers(const MethodCfg& cfg, const Dominance& dominance)
+{
+    // The frontier of a block holds the joins it dominates a predecessor of
+    // without strictly dominating the join. Walk up the dominator tree from
+    // each predecessor of each join, a stamp marking the blocks whose
+    // frontier already got the join. The entry block is a join as soon as it
+    // has a predecessor, the method entry being another one.
+    uint32_t num_blocks = cfg.NumBlocks();
+    stamps_.assign(num_blocks, kNoBlock);
+    pairs_.clear();
+    for (uint32_t block : cfg.ReversePostorder()) {
+        Range<uint32_t> preds = cfg.Predecessors(block);
+        if (preds.size() + ((block == 0)? 1 : 0) < 2)
+            continue;
+        uint32_t idom = dominance.ImmediateDominator(block);
+        for (uint32_t pred : preds) {
+            if (!cfg.IsReachable(pred))
+                continue;
+            uint32_t runner = pred;
+            while (runner != idom && stamps_[runner] != block) {
+                stamps_[runner] = block;
+                pairs_.push_back(std::make_pair(runner, block));
+                runner = dominance.ImmediateDominator(runner);
+            }
+        }
+    }
+    Bucket(pairs_, num_blocks, &frontier_offsets_, &frontiers_);
+}
+
+void MethodSsa::PlacePhis(const MethodCfg& cfg)
+{
+    // For each global register, the iterated frontier of its definition
+    // sites, by a worklist where the stamps mark the blocks having a phi
+    // and the blocks already queued.
+    uint32_t num_blocks = cfg.NumBlocks();
+    stamps_.assign(num_blocks, kNoReg);
+    work_stamps_.assign(num_blocks, kNoReg);
+    pairs_.clear();
+    for (uint32_t reg = 0 ; reg < num_regs_ ; ++reg) {
+        if (!globals_[reg])
+            continue;
+        worklist_.assign(def_sites_.begin() + def_site_offsets_[reg],
+                         def_sites_.begin() + def_site_offsets_[reg + 1]);
+        for (uint32_t site : worklist_)
+            work_stamps_[site] = reg;
+        // A handler reached past a write has a phi merging the register from
+        // before the write, which makes it a definition site too.
+        for (uint32_t i = handler_offsets_[reg] ; i < handler_offsets_[reg + 1] ; ++i) {
+            uint32_t handler = handlers_[i];
+            if (stamps_[handler] == reg)
+                continue;
+            stamps_[handler] = reg;
+            pairs_.push_back(std::make_pair(handler, reg));
+            if (work_stamps_[handler] != reg) {
+                work_stamps_[handler] = reg;
+                worklist_.push_back(handler);
+            }
+        }
+        while (!worklist_.empty()) {
+            uint32_t block = worklist_.back();
+            worklist_.pop_back();
+            for (uint32_t i = frontier_offsets_[block] ; i < frontier_offsets_[block + 1] ; ++i) {
+                uint32_t join = frontiers_[i];
+                if (stamps_[join] == reg)
+                    continue;
+                stamps_[join] = reg;
+                pairs_.push_back(std::make_pair(join, reg));
+                if (work_stamps_[join] != reg) {
+                    work_stamps_[join] = reg;
+                    worklist_.push_back(join);
+                }
+            }
+        }
+    }
+    Bucket(pairs_, num_blocks, &phi_offsets_, &phi_regs_);
+
+    // The phis of a block are consecutive values, with one operand per
+    // predecessor, plus one for the method entry on the entry block.
+    uint32_t first = values_.size();
+    for (uint32_t block = 0 ; block < num_blocks ; ++block) {
+        uint32_t num_operands = cfg.Predecessors(block).size() + ((block == 0)? 1 : 0);
+        for (uint32_t i = phi_offsets_[block] ; i < phi_offsets_[block + 1] ; ++i) {
+            uint32_t begin = operands_.size();
+            operands_.resize(begin + num_operands, kUndefinedValue);
+            Value phi = {kPhi, false, phi_regs_[i], block, kNoPc, begin,
+                         static_cast<uint32_t>(operands_.size())};
+            values_.push_back(phi);
+        }
+    }
+    for (uint32_t& offset : phi_offsets_)
+        offset += first;
+}
+
+void MethodSsa::Rename(const MethodCfg& cfg, const Dominance& dominance)
+{
+    // Number each edge among the predecessors of its target, which are
+    // sorted by source block.
+    uint32_t num_blocks = cfg.NumBlocks();
+    stamps_.assign(num_blocks, 0);
+    edge_offsets_.resize(num_blocks + 1);
+    edge_pred_index_.clear();
+    for (uint32_t block = 0 ; block < num_blocks ; ++block) {
+        edge_offsets_[block] = edge_pred_index_.size();
+        for (const MethodCfg::Edge& edge : cfg.Successors(block))
+            edge_pred_index_.push_back(stamps_[edge.block_]++);
+    }
+    edge_offsets_[num_blocks] = edge_pred_index_.size();
+
+    for (uint32_t phi = PhisBegin(0) ; phi < PhisEnd(0) ; ++phi)
+        operands_[values_[phi].operands_begin_] = current_[values_[phi].reg_];
+
+    // Walk the dominator tree, where work_stamps_ holds the position of the
+    // next child to visit of each block on the stack.
+    undo_.clear();
+    work_stamps_.assign(num_blocks, 0);
+    RenameBlock(cfg, 0);
+    stack_.assign(1, std::make_pair(0, 0));
+    while (!stack_.empty()) {
+        uint32_t block = stack_.back().first;
+        Range<uint32_t> children = dominance.DominatorTreeChildren(block);
+        if (work_stamps_[block] < children.size()) {
+            uint32_t child = children.begin()[work_stamps_[block]++];
+            stack_.push_back(std::make_pair(child, static_cast<uint32_t>(undo_.size())));
+            RenameBlock(cfg, child);
+            continue;
+        }
+        uint32_t mark = stack_.back().second;
+        while (undo_.size() > mark) {
+            current_[undo_.back().first] = undo_.back().second;
+            undo_.pop_back();
+        }
+        stack_.pop_back();
+    }
+}
+
+void MethodSsa::RenameBlock(const MethodCfg& cfg, uint32_t block)
+{
+    for (uint32_t phi = PhisBegin(block) ; phi < PhisEnd(block) ; ++phi)
+        Define(values_[phi].reg_, phi, false);
+
+    uint32_t end = block_insns_[block + 1];
+    for (uint32_t i = block_insns_[block] ; i < end ; ++i) {
+        Insn& insn = insns_[i];
+        for (uint32_t j = insn.uses_begin_ ; j < insn.uses_end_ ; ++j)
+            uses_[j] = current_[use_regs_[j]];
+        // An exception leaves the last instruction before it writes.
+        if (i + 1 == end)
+            FillPhiOperands(cfg, block, true);
+        const Def& def = defs_[i];
+        if (def.reg_ != kNoReg) {
+            Value value = {def.kind_, def.wide_, def.reg_, block, insn.dex_pc_, 0, 0};
+            insn.def_ = values_.size();
+            values_.push_back(value);
+            Define(def.reg_, insn.def_, def.wide_);
+        }
+    }
+    FillPhiOperands(cfg, block, false);
+}
+
+void MethodSsa::Define(uint32_t reg, uint32_t value, bool wide)
+{
+    undo_.push_back(std::make_pair(reg, current_[reg]));
+    current_[reg] = value;
+    if (wide) {
+        undo_.push_back(std::make_pair(reg + 1, current_[reg + 1]));
+        current_[reg + 1] = value;
+    }
+}
+
+void MethodSsa::FillPhiOperands(const MethodCfg& cfg, uint32_t block, bool exceptional)
+{
+    Range<MethodCfg::Edge> succs = cfg.Successors(block);
+    for (uint32_t i = 0 ; i < succs.size() ; ++i) {
+        const MethodCfg::Edge& edge = succs.begin()[i];
+        if ((edge.kind_ == MethodCfg::kException) != exceptional)
+            continue;
+        uint32_t pos = edge_pred_index_[edge_offsets_[block] + i] + ((edge.block_ == 0)? 1 : 0);
+        for (uint32_t phi = PhisBegin(edge.block_) ; phi < PhisEnd(edge.block_) ; ++phi)
+            operands_[values_[phi].operands_begin_ + pos] = current_[values_[phi].reg_];
+    }
+}
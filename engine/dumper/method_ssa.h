@@ -0,0 +1,210 @@
+#ifndef _DUMPER_METHOD_SSA_H_
+#define _DUMPER_METHOD_SSA_H_
+
+
+#include "globals.h"
+#include "macros.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "method_cfg.h"
+#include "dominance.h"
+
+
+// The static single assignment form of the virtual registers of a method.
+//
+// Each write of a register creates a value, and each read refers to the one
+// value reaching it. The registers written and read by an instruction are
+// decoded from its verify flags, vA being written when the instruction table
+// says so, and also read by the 2addr operations and check-cast. A wide
+// value occupies its register pair, a read of the pair refers to it by its
+// low register. A move-result or move-exception defines a value of its own
+// kind, whose source is the preceding invoke or the thrown exception.
+//
+// The phis are placed on the iterated dominance frontiers of the blocks
+// writing a register, only for the registers read in a block before being
+// written there (semi-pruned form). An exceptional edge leaves a block before
+// its last instruction writes, so the handlers of a block ending with a write
+// also get a phi for that register, even when the block dominates them. The
+// operands of a phi follow the order of MethodCfg::Predecessors(), preceded
+// by the method entry if the phi is on the entry block. The values are then
+// renamed by a walk of the dominator tree, with an undo log to restore the
+// current value of the registers when leaving a subtree.
+//
+// Value 0 stands for a register read without having been written. The
+// parameters come next, then the phis by block, then the definitions in
+// dominator tree order. The instructions of the reachable blocks are listed
+// in address order with the value they define and the values they read.
+//
+// The values, the operands and the scratch arrays are flat vectors rebuilt in
+// place for one method after another, acting as the arena of a worker: once
+// they have grown to the largest method seen, building allocates nothing.
+class MethodSsa
+{
+  public:
+    static constexpr uint32_t kNoValue = 0xFFFFFFFF;
+    static constexpr uint32_t kNoBlock = MethodCfg::kNoBlock;
+    static constexpr uint32_t kNoPc = 0xFFFFFFFF;
+    static constexpr uint32_t kUndefinedValue = 0;
+
+    enum Kind
+    {
+        kUndefined = 0,
+        kParameter,
+        kPhi,
+        kDefinition,
+        kResult,           // written by move-result from the preceding instruction
+        kCaughtException,  // written by move-exception
+    };
+
+    struct Value
+    {
+        Kind kind_;
+        bool wide_;
+        uint32_t reg_;
+        uint32_t block_;   // kNoBlock for the undefined value and the parameters
+        uint32_t dex_pc_;  // the defining instruction, or kNoPc
+        uint32_t operands_begin_;  // into the operands of the phis
+        uint32_t operands_end_;
+    };
+
+    struct Insn
+    {
+        uint32_t dex_pc_;
+        uint32_t def_;  // the value defined, or kNoValue
+        uint32_t uses_begin_;
+        uint32_t uses_end_;
+    };
+
+    MethodSsa() {}
+
+    // Build the form of the code item, given its graph and dominance.
+    // Returns false if an instruction refers to a register beyond
+    // registers_size_.
+    bool Build(const DexFile& dex_file, uint32_t dex_method_idx, uint32_t access_flags,
+               const DexFile::CodeItem* code_item, const MethodCfg& cfg,
+               const Dominance& dominance) WARN_UNUSED;
+
+    uint32_t NumValues() const
+    {
+        return values_.size();
+    }
+
+    const Value& GetValue(uint32_t value) const
+    {
+        return values_[value];
+    }
+
+    // The operands of a phi.
+    Range<uint32_t> Operands(uint32_t value) const
+    {
+        const uint32_t* base = operands_.data();
+        const Value& phi = values_[value];
+        return Range<uint32_t>(base + phi.operands_begin_, base + phi.operands_end_);
+    }
+
+    // The phis of a block, as a range of consecutive values.
+    uint32_t PhisBegin(uint32_t block) const
+    {
+        return phi_offsets_[block];
+    }
+
+    uint32_t PhisEnd(uint32_t block) const
+    {
+        return phi_offsets_[block + 1];
+    }
+
+    uint32_t NumParameters() const
+    {
+        return num_parameters_;
+    }
+
+    const std::vector<Insn>& Insns() const
+    {
+        return insns_;
+    }
+
+    // Returns the instruction starting at dex_pc in a reachable block, or
+    // nullptr.
+    const Insn* InsnAt(uint32_t dex_pc) const
+    {
+        if (dex_pc >= insn_of_pc_.size() || insn_of_pc_[dex_pc] == kNoValue)
+            return nullptr;
+        return &insns_[insn_of_pc_[dex_pc]];
+    }
+
+    Range<uint32_t> Uses(const Insn& insn) const
+    {
+        const uint32_t* base = uses_.data();
+        return Range<uint32_t>(base + insn.uses_begin_, base + insn.uses_end_);
+    }
+
+  private:
+    static constexpr uint32_t kNoReg = 0xFFFFFFFF;
+
+    // The register written by an instruction, as decoded by the scan.
+    struct Def
+    {
+        uint32_t reg_;  // or kNoReg
+        bool wide_;
+        Kind kind_;
+    };
+
+    // Append the registers read by the instruction to use_regs_, and return
+    // the register it writes.
+    Def DecodeRegisters(const Instruction* inst);
+
+    bool ScanInsns(const DexFile::CodeItem* code_item, const MethodCfg& cfg);
+    void FillFrontiers(const MethodCfg& cfg, const Dominance& dominance);
+    void PlacePhis(const MethodCfg& cfg);
+    void AddParameters(const DexFile& dex_file, uint32_t dex_method_idx, uint32_t access_flags,
+                       const DexFile::CodeItem* code_item);
+    void Rename(const MethodCfg& cfg, const Dominance& dominance);
+    void RenameBlock(const MethodCfg& cfg, uint32_t block);
+    void Define(uint32_t reg, uint32_t value, bool wide);
+    void FillPhiOperands(const MethodCfg& cfg, uint32_t block, bool exceptional);
+
+    uint32_t num_regs_;
+    uint32_t num_parameters_;
+    std::vector<Value> values_;
+    std::vector<uint32_t> operands_;
+    std::vector<uint32_t> phi_offsets_;  // of size NumBlocks() + 1
+    std::vector<Insn> insns_;
+    std::vector<uint32_t> insn_of_pc_;
+    std::vector<uint32_t> uses_;
+
+    // The decoded registers, parallel to insns_ and uses_.
+    std::vector<Def> defs_;
+    std::vector<uint32_t> use_regs_;
+
+    // The blocks with their first instruction in insns_, of size NumBlocks() + 1.
+    std::vector<uint32_t> block_insns_;
+
+    std::vector<uint32_t> frontier_offsets_;
+    std::vector<uint32_t> frontiers_;
+    std::vector<uint32_t> def_site_offsets_;
+    std::vector<uint32_t> def_sites_;
+    std::vector<std::pair<uint32_t, uint32_t>> throw_pairs_;
+    std::vector<uint32_t> handler_offsets_;  // the handlers reached past a write, by register
+    std::vector<uint32_t> handlers_;
+    std::vector<uint32_t> phi_regs_;
+    std::vector<std::pair<uint32_t, uint32_t>> pairs_;
+    std::vector<uint32_t> stamps_;
+    std::vector<uint32_t> work_stamps_;
+    std::vector<uint32_t> worklist_;
+    std::vector<bool> globals_;
+
+    // The position of each edge of the graph among the predecessors of its
+    // target, by source block and successor.
+    std::vector<uint32_t> edge_offsets_;
+    std::vector<uint32_t> edge_pred_index_;
+
+    // The renaming state.
+    std::vector<uint32_t> current_;
+    std::vector<std::pair<uint32_t, uint32_t>> undo_;  // the register and its previous value
+    std::vector<std::pair<uint32_t, uint32_t>> stack_;  // the block and its undo_ mark
+
+    DISALLOW_COPY_AND_ASSIGN(MethodSsa);
+};
+
+#endif
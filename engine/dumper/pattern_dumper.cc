@@ -0,0 +1,73 @@
+#include <algorithm>
+
+#include "pattern_dumper.h"
+#include "misc.h"
+#include "stringprintf.h"
+#include "dex_file-inl.h"
+
+
+PatternDumper::PatternDumper(const DexFile& dex_file, const DumpFilter& filter)
+  : dex_file_(dex_file),
+    filter_(filter)
+{}
+
+bool PatternDumper::Dump(OutputSink& sink, const char* path, ThreadPool* pool)
+{
+    PatternMatcher matcher(dex_file_);
+    if (!matcher.Compile(path))
+        return false;
+
+    uint32_t num_class_def = dex_file_.NumClassDefs();
+    uint32_t num_workers = pool->NumChunkWorkers(num_class_def, kClassChunkSize);
+    uint32_t round_size = num_workers * kChunksPerWorker;
+    std::vector<PatternMatcher::Scratch> scratches(num_workers);
+    std::vector<std::vector<PatternMatcher::Match>> matches(num_workers);
+    std::vector<std::string> outs(round_size);
+    uint32_t round_classes = round_size * kClassChunkSize;
+    for (uint32_t round_begin = 0 ; round_begin < num_class_def ; round_begin += round_classes) {
+        uint32_t round_end = std::min(round_begin + round_classes, num_class_def);
+        pool->ParallelForChunks(round_begin, round_end, kClassChunkSize,
+                                [&](uint32_t worker, uint32_t chunk, uint32_t begin,
+                                    uint32_t end) {
+            std::string* out = &outs[chunk];
+            out->clear();
+            for (uint32_t class_def_idx = begin ; class_def_idx < end ; ++class_def_idx)
+                DumpClass(out, matcher, class_def_idx, &scratches[worker], &matches[worker]);
+        });
+
+        uint32_t num_chunks = (round_end - round_begin + kClassChunkSize - 1) / kClassChunkSize;
+        for (uint32_t chunk = 0 ; chunk < num_chunks ; ++chunk) {
+            if (!sink.Write(outs[chunk]))
+                return false;
+        }
+    }
+    return true;
+}
+
+void PatternDumper::DumpClass(std::string* out, const PatternMatcher& matcher,
+                              uint32_t class_def_idx, PatternMatcher::Scratch* scratch,
+                              std::vector<PatternMatcher::Match>* matches) const
+{
+    if (!filter_.KeepClass(dex_file_, class_def_idx))
+        return;
+    const byte* class_data = dex_file_.GetClassData(dex_file_.GetClassDef(class_def_idx));
+    if (class_data == nullptr)
+        return;
+    ClassDataItemIterator it(dex_file_, class_data);
+    SkipAllFields(it);
+    for ( ; it.HasNext() ; it.Next()) {
+        uint32_t dex_method_idx = it.GetMemberIndex();
+        const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+        if (code_item == nullptr || !filter_.KeepMethod(dex_file_, dex_method_idx))
+            continue;
+        matches->clear();
+        matcher.Scan(code_item, scratch, matches);
+        if (matches->empty())
+            continue;
+        StringAppendF(out, "%s (dex_method_idx=%u)\n",
+                      PrettyMethod(dex_method_idx, dex_file_, true).c_str(), dex_method_idx);
+        for (const PatternMatcher::Match& match : *matches)
+            StringAppendF(out, "\t[0x%04x, 0x%04x) %s\n", match.begin_pc_, match.end_pc_,
+                          matcher.RuleName(match.rule_).c_str());
+    }
+}
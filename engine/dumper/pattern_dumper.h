@@ -0,0 +1,46 @@
+#ifndef _DUMPER_PATTERN_DUMPER_H_
+#define _DUMPER_PATTERN_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dump_filter.h"
+#include "pattern_matcher.h"
+
+
+// List the kept methods matching the rules of a patterns file, in class_def
+// order, each followed by its matches with their address range in code
+// units and their rule name:
+//
+//   java.lang.String com.a.B.bar(java.lang.String) (dex_method_idx=52)
+//   	[0x0002, 0x0004) secret
+//   	[0x0002, 0x0008) forname
+//
+// The classes are scanned in rounds of parallel chunks, each round written
+// in class_def order before the next one starts, so the output is never
+// held whole. Each worker scans with its own scratch space.
+class PatternDumper
+{
+  public:
+    // The filter is not owned and must outlive the dumper.
+    PatternDumper(const DexFile& dex_file, const DumpFilter& filter);
+
+    // Compile the rules of the file at path and list their matches.
+    bool Dump(OutputSink& sink, const char* path, ThreadPool* pool) WARN_UNUSED;
+
+  private:
+    void DumpClass(std::string* out, const PatternMatcher& matcher, uint32_t class_def_idx,
+                   PatternMatcher::Scratch* scratch,
+                   std::vector<PatternMatcher::Match>* matches) const;
+
+    const DexFile& dex_file_;
+    const DumpFilter& filter_;
+
+    DISALLOW_COPY_AND_ASSIGN(PatternDumper);
+};
+
+#endif
@@ -0,0 +1,354 @@
+#include "pattern_matcher.h"
+#include "glob_matcher.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+#include "misc.h"
+
+
+constexpr uint32_t PatternMatcher::kUnbounded;
+constexpr uint32_t PatternMatcher::kNoOperand;
+constexpr uint32_t PatternMatcher::kNumOpcodes;
+constexpr uint32_t PatternMatcher::kNumIndexTypes;
+
+
+
+PatternMatcher::PatternMatcher(const DexFile& dex_file)
+  : dex_file_(dex_file)
+{}
+
+bool PatternMatcher::Compile(const char* path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        PLOG(ERROR) << "Fail to open the rules file " << path;
+        return false;
+    }
+    std::string line;
+    uint32_t line_no = 0;
+    while (std::getline(in, line)) {
+        ++line_no;
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#')
+            continue;
+        if (!ParseRule(line.substr(begin))) {
+            LOG(ERROR) << "Malformed rule at line " << line_no << " of " << path;
+            return false;
+        }
+    }
+    if (rules_.empty()) {
+        LOG(ERROR) << "No rule in " << path;
+        return false;
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> matches[kNumIndexTypes];
+    ResolveOperands(matches);
+    FillFirstSteps(matches);
+    return true;
+}
+
+bool PatternMatcher::ParseRule(const std::string& line)
+{
+    size_t colon = line.find(':');
+    if (colon == 0 || colon == std::string::npos)
+        return false;
+    std::string name = line.substr(0, colon);
+    if (name.find_first_of(" \t") != std::string::npos)
+        return false;
+
+    // Split the steps on the blanks outside of the double quotes, which are
+    // dropped.
+    std::vector<std::string> tokens;
+    std::string token;
+    bool quoted = false;
+    for (size_t i = colon + 1 ; i <= line.size() ; ++i) {
+        char ch = (i < line.size())? line[i] : ' ';
+        if (ch == '"')
+            quoted = !quoted;
+        else if (quoted || (ch != ' ' && ch != '\t' && ch != '\r'))
+            token += ch;
+        else if (!token.empty()) {
+            tokens.push_back(token);
+            token.clear();
+        }
+    }
+    if (quoted)
+        return false;
+
+    uint32_t rule = rules_.size();
+    uint32_t first_step = steps_.size();
+    uint32_t gap = 0;
+    bool pending_gap = false;
+    for (const std::string& cur : tokens) {
+        if (cur.compare(0, 3, "...") == 0) {
+            if (pending_gap || steps_.size() == first_step)
+                return false;
+            gap = kUnbounded;
+            if (cur.size() > 3) {
+                char* end;
+                long count = strtol(cur.c_str() + 3, &end, 10);
+                if (*end != '\0' || count < 0 || count >= kUnbounded)
+                    return false;
+                gap = static_cast<uint32_t>(count);
+            }
+            pending_gap = true;
+            continue;
+        }
+        Step step;
+        if (!ParseStep(cur, &step))
+            return false;
+        step.gap_ = gap;
+        step.rule_ = rule;
+        step.last_ = false;
+        steps_.push_back(step);
+        gap = 0;
+        pending_gap = false;
+    }
+    if (pending_gap || steps_.size() == first_step)
+        return false;
+    steps_.back().last_ = true;
+    Rule entry = {name, first_step, static_cast<uint32_t>(steps_.size()) - first_step};
+    rules_.push_back(entry);
+    return true;
+}
+
+bool PatternMatcher::ParseStep(const std::string& token, Step* step)
+{
+    size_t colon = token.find(':');
+    GlobMatcher opcodes;
+    opcodes.Add(token.substr(0, colon).c_str());
+    step->opcodes_.reset();
+    for (uint32_t opcode = 0 ; opcode < kNumOpcodes ; ++opcode) {
+        if (opcodes.Match(Instruction::Name(static_cast<Instruction::Code>(opcode))))
+            step->opcodes_.set(opcode);
+    }
+    if (step->opcodes_.none())
+        return false;
+
+    // An operand needs all the opcodes to index the same space.
+    step->operand_ = kNoOperand;
+    if (colon == std::string::npos)
+        return true;
+    Instruction::IndexType space = Instruction::kUnknown;
+    for (uint32_t opcode = 0 ; opcode < kNumOpcodes ; ++opcode) {
+        if (!step->opcodes_.test(opcode))
+            continue;
+        Instruction::IndexType type = Instruction::IndexTypeOf(
+            static_cast<Instruction::Code>(opcode));
+        if (type != Instruction::kStringRef && type != Instruction::kTypeRef &&
+            type != Instruction::kFieldRef && type != Instruction::kMethodRef)
+            return false;
+        if (space != Instruction::kUnknown && type != space)
+            return false;
+        space = type;
+    }
+    step->operand_ = AddOperand(space, token.substr(colon + 1));
+    return true;
+}
+
+uint32_t PatternMatcher::AddOperand(Instruction::IndexType space, const std::string& glob)
+{
+    std::string key(1, static_cast<char>(space));
+    key += glob;
+    auto iter = operand_ids_.find(key);
+    if (iter != operand_ids_.end())
+        return iter->second;
+    operand_ids_.emplace(key, operands_.size());
+    Operand operand;
+    operand.space_ = space;
+    operand.glob_ = glob;
+    operands_.push_back(operand);
+    return operands_.size() - 1;
+}
+
+void PatternMatcher::ResolveOperands(std::vector<std::pair<uint32_t, uint32_t>>* matches)
+{
+    // Each index space is named once, and walked down the trie of all the
+    // globs of the space.
+    static const Instruction::IndexType kSpaces[] = {
+        Instruction::kStringRef, Instruction::kTypeRef, Instruction::kFieldRef,
+        Instruction::kMethodRef,
+    };
+    for (Instruction::IndexType space : kSpaces) {
+        std::vector<uint32_t> members;
+        GlobMatcher globs;
+        for (uint32_t operand = 0 ; operand < operands_.size() ; ++operand) {
+            if (operands_[operand].space_ != space)
+                continue;
+            members.push_back(operand);
+            globs.Add(operands_[operand].glob_.c_str());
+        }
+        if (members.empty())
+            continue;
+
+        uint32_t num_indices = NumIndices(space);
+        for (uint32_t operand : members)
+            operands_[operand].indices_.assign(num_indices, false);
+        std::vector<uint32_t> matched;
+        for (uint32_t idx = 0 ; idx < num_indices ; ++idx) {
+            matched.clear();
+            globs.MatchAll(OperandName(space, idx).c_str(), &matched);
+            for (uint32_t member : matched) {
+                operands_[members[member]].indices_[idx] = true;
+                matches[space].push_back(std::make_pair(idx, members[member]));
+            }
+        }
+    }
+}
+
+std::string PatternMatcher::OperandName(Instruction::IndexType space, uint32_t idx) const
+{
+    std::string name;
+    if (space == Instruction::kStringRef) {
+        name = dex_file_.StringDataByIdx(idx);
+    } else if (space == Instruction::kTypeRef) {
+        name = dex_file_.StringByTypeIdx(idx);
+    } else if (space == Instruction::kFieldRef) {
+        const DexFile::FieldId& field_id = dex_file_.GetFieldId(idx);
+        name = dex_file_.GetFieldDeclaringClassDescriptor(field_id);
+        name += "->";
+        name += dex_file_.GetFieldName(field_id);
+    } else {
+        const DexFile::MethodId& method_id = dex_file_.GetMethodId(idx);
+        name = dex_file_.GetMethodDeclaringClassDescriptor(method_id);
+        name += "->";
+        name += dex_file_.GetMethodName(method_id);
+    }
+    return name;
+}
+
+void PatternMatcher::FillFirstSteps(const std::vector<std::pair<uint32_t, uint32_t>>* matches)
+{
+    // The first steps without an operand are keyed by their opcodes, the
+    // others by the indices their operand matched.
+    std::vector<std::pair<uint32_t, uint32_t>> by_opcode;
+    std::vector<std::vector<uint32_t>> first_steps_of(operands_.size());
+    for (const Rule& rule : rules_) {
+        const Step& first = steps_[rule.first_step_];
+        if (first.operand_ != kNoOperand) {
+            first_steps_of[first.operand_].push_back(rule.first_step_);
+            continue;
+        }
+        for (uint32_t opcode = 0 ; opcode < kNumOpcodes ; ++opcode) {
+            if (first.opcodes_.test(opcode))
+                by_opcode.push_back(std::make_pair(opcode, rule.first_step_));
+        }
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> by_index[kNumIndexTypes];
+    for (uint32_t space = 0 ; space < kNumIndexTypes ; ++space) {
+        for (const auto& match : matches[space]) {
+            for (uint32_t step : first_steps_of[match.second])
+                by_index[space].push_back(std::make_pair(match.first, step));
+        }
+    }
+
+    Bucket(by_opcode, kNumOpcodes, &first_by_opcode_.offsets_, &first_by_opcode_.steps_);
+    for (uint32_t space = 0 ; space < kNumIndexTypes ; ++space) {
+        Table* table = &first_by_index_[space];
+        if (by_index[space].empty()) {
+            table->offsets_.clear();
+            table->steps_.clear();
+            continue;
+        }
+        Bucket(by_index[space], NumIndices(static_cast<Instruction::IndexType>(space)),
+               &table->offsets_, &table->steps_);
+    }
+}
+
+uint32_t PatternMatcher::NumIndices(Instruction::IndexType space) const
+{
+    switch (space) {
+      case Instruction::kStringRef:
+        return dex_file_.NumStringIds();
+      case Instruction::kTypeRef:
+        return dex_file_.NumTypeIds();
+      case Instruction::kFieldRef:
+        return dex_file_.NumFieldIds();
+      case Instruction::kMethodRef:
+        return dex_file_.NumMethodIds();
+      default:
+        return 0;
+    }
+}
+
+void PatternMatcher::Scan(const DexFile::CodeItem* code_item, Scratch* scratch,
+                          std::vector<Match>* matches) const
+{
+    scratch->ticks_.resize(steps_.size(), 0);
+    scratch->slots_.resize(steps_.size());
+    scratch->active_.clear();
+
+    uint32_t insns_size = code_item->insns_size_in_code_units_;
+    uint32_t dex_pc = 0;
+    while (dex_pc < insns_size) {
+        const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+        uint32_t end_pc = dex_pc + inst->SizeInCodeUnits();
+        if (inst->IsPayload()) {
+            dex_pc = end_pc;
+            continue;
+        }
+        if (++scratch->tick_ == 0) {
+            std::fill(scratch->ticks_.begin(), scratch->ticks_.end(), 0);
+            scratch->tick_ = 1;
+        }
+        scratch->next_.clear();
+
+        // A waiting state takes the instruction as its step, and also lets
+        // it pass while its budget lasts.
+        auto advance = [&](uint32_t step, uint32_t begin_pc) {
+            if (steps_[step].last_) {
+                Match match = {steps_[step].rule_, begin_pc, end_pc};
+                matches->push_back(match);
+            } else {
+                Offer(scratch, step + 1, steps_[step + 1].gap_, begin_pc);
+            }
+        };
+        for (const Scratch::Entry& entry : scratch->active_) {
+            if (Accepts(steps_[entry.step_], inst))
+                advance(entry.step_, entry.begin_pc_);
+            if (entry.budget_ == kUnbounded)
+                Offer(scratch, entry.step_, kUnbounded, entry.begin_pc_);
+            else if (entry.budget_ > 0)
+                Offer(scratch, entry.step_, entry.budget_ - 1, entry.begin_pc_);
+        }
+        uint32_t opcode = inst->Opcode();
+        const Table& by_opcode = first_by_opcode_;
+        for (uint32_t i = by_opcode.offsets_[opcode] ; i < by_opcode.offsets_[opcode + 1] ; ++i)
+            advance(by_opcode.steps_[i], dex_pc);
+        const Table& by_index = first_by_index_[Instruction::IndexTypeOf(inst->Opcode())];
+        uint32_t idx = inst->GetIndexOperand();
+        if (!by_index.offsets_.empty() && idx < by_index.offsets_.size() - 1) {
+            for (uint32_t i = by_index.offsets_[idx] ; i < by_index.offsets_[idx + 1] ; ++i) {
+                if (steps_[by_index.steps_[i]].opcodes_.test(opcode))
+                    advance(by_index.steps_[i], dex_pc);
+            }
+        }
+        scratch->active_.swap(scratch->next_);
+        dex_pc = end_pc;
+    }
+}
+
+bool PatternMatcher::Accepts(const Step& step, const Instruction* inst) const
+{
+    if (!step.opcodes_.test(inst->Opcode()))
+        return false;
+    if (step.operand_ == kNoOperand)
+        return true;
+    const std::vector<bool>& indices = operands_[step.operand_].indices_;
+    uint32_t idx = inst->GetIndexOperand();
+    return idx < indices.size() && indices[idx];
+}
+
+void PatternMatcher::Offer(Scratch* scratch, uint32_t step, uint32_t budget, uint32_t begin_pc)
+{
+    if (scratch->ticks_[step] != scratch->tick_) {
+        scratch->ticks_[step] = scratch->tick_;
+        scratch->slots_[step] = scratch->next_.size();
+        Scratch::Entry entry = {step, budget, begin_pc};
+        scratch->next_.push_back(entry);
+        return;
+    }
+    Scratch::Entry& entry = scratch->next_[scratch->slots_[step]];
+    if (budget > entry.budget_ || (budget == entry.budget_ && begin_pc > entry.begin_pc_)) {
+        entry.budget_ = budget;
+        entry.begin_pc_ = begin_pc;
+    }
+}
@@ -0,0 +1,169 @@
+#ifndef _DUMPER_PATTERN_MATCHER_H_
+#define _DUMPER_PATTERN_MATCHER_H_
+
+
+#include <bitset>
+#include <unordered_map>
+
+#include "globals.h"
+#include "macros.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+
+
+// A set of rules over the instruction sequences of the code items, compiled
+// into one automaton that finds the matches of all of them in a single pass
+// over each code item.
+//
+// A rules file has one rule per line, blank lines and the lines starting
+// with '#' being skipped:
+//
+//   cipher-const: const-string ...5 invoke-static:Ljavax/crypto/Cipher;->getInstance
+//   url-literal: const-string:"http://*" new-instance:Ljava/net/URL; ... invoke-direct
+//
+// A rule is a name followed by its steps. A step is a glob matched against
+// the opcode names, optionally followed by a colon and a glob matched
+// against the operand it resolves: the string for a string index, the
+// descriptor for a type index, and 'Lcom/a/B;->name' for a field or method
+// index, double quotes allowing spaces. Two steps are adjacent unless they
+// are separated by '...N', letting at most N instructions in between, or by
+// '...' for any number of them. The payloads of the switches and of
+// fill-array-data are not instructions.
+//
+// The opcode globs are expanded into opcode sets, and the operand globs are
+// resolved against every index of their space in the file into index sets,
+// once, so a step is tested by two lookups. The steps of all the rules are
+// the states of a nondeterministic automaton, a state waiting for its step
+// with the number of instructions it can still skip and the address the
+// match started at. The first steps are dispatched by opcode, or by operand
+// index for the ones with an operand, so an instruction only meets the rules
+// that can start on it however many there are. Each instruction then
+// advances the active states, a state reached twice keeping the larger
+// budget, then the later start. The work per instruction is then bounded by
+// the number of states and not by the matches in flight, every end of a
+// match is still found, and its start is the latest one of the larger
+// budget.
+class PatternMatcher
+{
+  public:
+    static constexpr uint32_t kUnbounded = 0xFFFFFFFF;
+
+    struct Match
+    {
+        uint32_t rule_;
+        uint32_t begin_pc_;
+        uint32_t end_pc_;  // past the last instruction
+    };
+
+    // The states of a scan, rebuilt in place for each code item.
+    class Scratch
+    {
+      public:
+        Scratch() : tick_(0) {}
+
+      private:
+        friend class PatternMatcher;
+
+        struct Entry
+        {
+            uint32_t step_;
+            uint32_t budget_;
+            uint32_t begin_pc_;
+        };
+
+        std::vector<Entry> active_;
+        std::vector<Entry> next_;
+        std::vector<uint32_t> ticks_;  // by step, the instruction that queued it
+        std::vector<uint32_t> slots_;  // by step, its position in next_
+        uint32_t tick_;
+
+        DISALLOW_COPY_AND_ASSIGN(Scratch);
+    };
+
+    explicit PatternMatcher(const DexFile& dex_file);
+
+    // Compile the rules of the file and resolve their operands. Returns
+    // false on an unreadable file or a malformed rule, which is logged.
+    bool Compile(const char* path) WARN_UNUSED;
+
+    uint32_t NumRules() const
+    {
+        return rules_.size();
+    }
+
+    const std::string& RuleName(uint32_t rule) const
+    {
+        return rules_[rule].name_;
+    }
+
+    // Append the matches in the code item, ordered by their end.
+    void Scan(const DexFile::CodeItem* code_item, Scratch* scratch,
+              std::vector<Match>* matches) const;
+
+  private:
+    static constexpr uint32_t kNoOperand = 0xFFFFFFFF;
+    static constexpr uint32_t kNumOpcodes = 256;
+    static constexpr uint32_t kNumIndexTypes = Instruction::kMethodRef + 1;
+
+    struct Rule
+    {
+        std::string name_;
+        uint32_t first_step_;
+        uint32_t num_steps_;
+    };
+
+    struct Step
+    {
+        std::bitset<kNumOpcodes> opcodes_;
+        uint32_t operand_;  // the index set, or kNoOperand
+        uint32_t gap_;      // the instructions it lets pass after the previous step
+        uint32_t rule_;
+        bool last_;
+    };
+
+    // The steps keyed by an opcode or an index, as compressed sparse rows.
+    struct Table
+    {
+        std::vector<uint32_t> offsets_;  // of size num_keys + 1, or empty
+        std::vector<uint32_t> steps_;
+    };
+
+    // An operand glob, resolved to the indices of its space.
+    struct Operand
+    {
+        Instruction::IndexType space_;
+        std::string glob_;
+        std::vector<bool> indices_;
+    };
+
+    bool ParseRule(const std::string& line);
+    bool ParseStep(const std::string& token, Step* step);
+    uint32_t AddOperand(Instruction::IndexType space, const std::string& glob);
+    // Resolve the operands, appending the (index, operand) pairs matched
+    // in each space.
+    void ResolveOperands(std::vector<std::pair<uint32_t, uint32_t>>* matches);
+    void FillFirstSteps(const std::vector<std::pair<uint32_t, uint32_t>>* matches);
+    uint32_t NumIndices(Instruction::IndexType space) const;
+
+    std::string OperandName(Instruction::IndexType space, uint32_t idx) const;
+
+    bool Accepts(const Step& step, const Instruction* inst) const;
+
+    static void Offer(Scratch* scratch, uint32_t step, uint32_t budget, uint32_t begin_pc);
+
+    const DexFile& dex_file_;
+    std::vector<Rule> rules_;
+    std::vector<Step> steps_;
+    std::vector<Operand> operands_;
+    std::unordered_map<std::string, uint32_t> operand_ids_;  // by space and glob
+
+    // The first steps of the rules, by opcode for the ones without an
+    // operand, and by the indices of their set for the others.
+    Table first_by_opcode_;
+    Table first_by_index_[kNumIndexTypes];
+
+    DISALLOW_COPY_AND_ASSIGN(PatternMatcher);
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <atomic>
+
+#include "pwrite_dumper.h"
+#include "log.h"
+#include "scoped_fd.h"
+
+
+constexpr uint32_t PwriteDumper::kBatchSize;
+
+PwriteDumper::PwriteDumper(const DexFile& dex_file, char opt_granu, const DumpFilter& filter)
+  : dex_file_(dex_file),
+    text_dumper_(dex_file, opt_granu, filter)
+{}
+
+bool PwriteDumper::Dump(const char* path, ThreadPool* pool, DumpIndex* index)
+{
+    ScopedFd fd(open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (fd.get() == -1) {
+        PLOG(ERROR) << "Fail to open the output file";
+        return false;
+    }
+
+    std::vector<std::string> texts(kBatchSize);
+    std::vector<off_t> offsets(kBatchSize);
+    std::vector<std::vector<TextDumper::MethodSpan>> spans((index)? kBatchSize : 0);
+    std::atomic<bool> failed(false);
+    std::atomic<int> write_errno(0);  // of the first failing worker
+    bool can_fallocate = true;
+    off_t base = 0;
+
+    uint32_t num_class_def = dex_file_.NumClassDefs();
+    for (uint32_t begin = 0 ; begin < num_class_def ; begin += kBatchSize) {
+        uint32_t count = std::min(kBatchSize, num_class_def - begin);
+        pool->ParallelFor(count, [&](uint32_t idx) {
+            texts[idx].clear();
+            if (index)
+                spans[idx].clear();
+            text_dumper_.RenderClass(&texts[idx], begin + idx, (index)? &spans[idx] : nullptr);
+        });
+
+        off_t batch_size = 0;
+        for (uint32_t idx = 0 ; idx < count ; ++idx) {
+            offsets[idx] = base + batch_size;
+            batch_size += texts[idx].size();
+            if (index)
+                TextDumper::IndexClass(index, begin + idx, offsets[idx], texts[idx], spans[idx]);
+        }
+        if (can_fallocate && batch_size > 0 &&
+            fallocate(fd.get(), 0, base, batch_size) == -1) {
+            // Not every file system supports preallocation, the pwrite calls
+            // extend the file anyway.
+            can_fallocate = false;
+            PLOG(WARNING) << "Fail to preallocate the output file";
+        }
+
+        pool->ParallelFor(count, [&](uint32_t idx) {
+            if (!failed && !PwriteFully(fd.get(), texts[idx], offsets[idx])) {
+                int expected = 0;
+                write_errno.compare_exchange_strong(expected, errno);
+                failed = true;
+            }
+        });
+        if (failed) {
+            // The errno of the main thread has nothing to do with the workers.
+            errno = write_errno;
+            PLOG(ERROR) << "Fail to write the output";
+            return false;
+        }
+        base += batch_size;
+    }
+
+    if (close(fd.release()) == -1) {
+        PLOG(ERROR) << "Fail to close the output";
+        return false;
+    }
+    return true;
+}
+
+bool PwriteDumper::PwriteFully(int fd, const std::string& text, off_t offset)
+{
+    const char* data = text.data();
+    size_t size = text.size();
+    while (size > 0) {
+        ssize_t count = pwrite(fd, data, size, offset);
+        if (count == -1) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += count;
+        size -= count;
+        offset += count;
+    }
+    return true;
+}
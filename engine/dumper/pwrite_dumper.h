@@ -0,0 +1,46 @@
+#ifndef _DUMPER_PWRITE_DUMPER_H_
+#define _DUMPER_PWRITE_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dump_filter.h"
+#include "dump_index.h"
+#include "text_dumper.h"
+
+
+// Dump the text of the classes into a plain file in batches. The workers
+// render the classes of a batch in parallel, which also yields the exact
+// byte length of each class. The file range of the batch is then
+// preallocated, and the workers pwrite each class straight to its final
+// offset, so no single thread ever merges the output. The file holds the
+// same bytes as the text dump written in class_def order.
+class PwriteDumper
+{
+  public:
+    // The number of classes rendered per batch. It bounds the formatted text
+    // held in memory before it is written.
+    static constexpr uint32_t kBatchSize = 2048;
+
+    // The filter is not owned and must outlive the dumper.
+    PwriteDumper(const DexFile& dex_file, char opt_granu, const DumpFilter& filter);
+
+    // Write the classes to the file at path, and record them in the index if
+    // one is given.
+    bool Dump(const char* path, ThreadPool* pool, DumpIndex* index) WARN_UNUSED;
+
+    // Write the whole text at the given file offset, resuming the short and
+    // the interrupted writes. Leaves errno set on failure.
+    static bool PwriteFully(int fd, const std::string& text, off_t offset) WARN_UNUSED;
+
+  private:
+    const DexFile& dex_file_;
+    TextDumper text_dumper_;
+
+    DISALLOW_COPY_AND_ASSIGN(PwriteDumper);
+};
+
+#endif
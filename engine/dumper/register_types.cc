@@ -0,0 +1,481 @@
+#include <algorithm>
+#include <cstring>
+
+#include "register_types.h"
+#include "modifiers.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+
+
+constexpr uint32_t RegisterTypes::kNoReg;
+constexpr uint32_t RegisterTypes::kResultSlots;
+
+
+static const char* kObjectDescriptor = "Ljava/lang/Object;";
+static const char* kStringDescriptor = "Ljava/lang/String;";
+static const char* kClassDescriptor = "Ljava/lang/Class;";
+static const char* kThrowableDescriptor = "Ljava/lang/Throwable;";
+
+// The types written by the unary operations, from neg-int to int-to-short.
+static const RegisterTypes::Kind kUnaryOpKinds[] = {
+    RegisterTypes::kInteger, RegisterTypes::kInteger,    // neg-int, not-int
+    RegisterTypes::kLongLo, RegisterTypes::kLongLo,      // neg-long, not-long
+    RegisterTypes::kFloat, RegisterTypes::kDoubleLo,     // neg-float, neg-double
+    RegisterTypes::kLongLo, RegisterTypes::kFloat, RegisterTypes::kDoubleLo,   // int-to-*
+    RegisterTypes::kInteger, RegisterTypes::kFloat, RegisterTypes::kDoubleLo,  // long-to-*
+    RegisterTypes::kInteger, RegisterTypes::kLongLo, RegisterTypes::kDoubleLo,  // float-to-*
+    RegisterTypes::kInteger, RegisterTypes::kLongLo, RegisterTypes::kFloat,    // double-to-*
+    RegisterTypes::kByte, RegisterTypes::kChar, RegisterTypes::kShort,  // int-to-byte, char, short
+};
+
+static bool IsLowHalf(RegisterTypes::Kind kind)
+{
+    return kind == RegisterTypes::kConstantLo || kind == RegisterTypes::kLongLo ||
+           kind == RegisterTypes::kDoubleLo;
+}
+
+static bool IsHighHalf(RegisterTypes::Kind kind)
+{
+    return kind == RegisterTypes::kConstantHi || kind == RegisterTypes::kLongHi ||
+           kind == RegisterTypes::kDoubleHi;
+}
+
+
+bool RegisterTypes::Build(const DexFile& dex_file, uint32_t dex_method_idx,
+                          uint32_t access_flags, const DexFile::CodeItem* code_item,
+                          const MethodCfg& cfg)
+{
+    dex_file_ = &dex_file;
+    num_regs_ = code_item->registers_size_;
+    line_size_ = num_regs_ + kResultSlots;
+    uint32_t num_blocks = cfg.NumBlocks();
+    lines_.resize(num_blocks * line_size_);
+    reached_.assign(num_blocks, false);
+    queued_.assign(num_blocks, false);
+
+    for (uint32_t block : cfg.ReversePostorder()) {
+        const MethodCfg::Block& range = cfg.GetBlock(block);
+        for (uint32_t dex_pc = range.start_pc_ ; dex_pc < range.end_pc_ ; ) {
+            const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+            if (!CheckRegisters(inst))
+                return false;
+            dex_pc += inst->SizeInCodeUnits();
+        }
+    }
+    FillCaughtTypes(cfg);
+
+    Type undefined = {kUndefined, nullptr};
+    line_.assign(line_size_, undefined);
+    SetParameters(code_item, dex_method_idx, access_flags, line_.data());
+    worklist_.clear();
+    Propagate(line_.data(), 0);
+
+    while (!worklist_.empty()) {
+        uint32_t block = worklist_.back();
+        worklist_.pop_back();
+        queued_[block] = false;
+        line_.assign(EntryLine(block), EntryLine(block) + line_size_);
+
+        const MethodCfg::Block& range = cfg.GetBlock(block);
+        for (uint32_t dex_pc = range.start_pc_ ; dex_pc < range.end_pc_ ; ) {
+            const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+            if (dex_pc == range.last_pc_)
+                throw_line_ = line_;
+            Apply(inst, dex_pc, line_.data());
+            dex_pc += inst->SizeInCodeUnits();
+        }
+        for (const MethodCfg::Edge& edge : cfg.Successors(block)) {
+            if (edge.kind_ == MethodCfg::kException)
+                Propagate(throw_line_.data(), edge.block_);
+            else
+                Propagate(line_.data(), edge.block_);
+        }
+    }
+    return true;
+}
+
+bool RegisterTypes::CheckRegisters(const Instruction* inst) const
+{
+    // A wide operand also takes the register after it.
+    int flags = Instruction::VerifyFlagsOf(inst->Opcode());
+    int64_t num_regs = num_regs_;
+    if ((flags & Instruction::kVerifyRegA) != 0 && inst->VRegA() >= num_regs)
+        return false;
+    if ((flags & Instruction::kVerifyRegAWide) != 0 && inst->VRegA() + 1 >= num_regs)
+        return false;
+    if ((flags & Instruction::kVerifyRegB) != 0 && inst->VRegB() >= num_regs)
+        return false;
+    if ((flags & Instruction::kVerifyRegBWide) != 0 && inst->VRegB() + 1 >= num_regs)
+        return false;
+    if ((flags & Instruction::kVerifyRegC) != 0 && inst->VRegC() >= num_regs)
+        return false;
+    if ((flags & Instruction::kVerifyRegCWide) != 0 && inst->VRegC() + 1 >= num_regs)
+        return false;
+
+    if ((flags & (Instruction::kVerifyVarArg | Instruction::kVerifyVarArgNonZero)) != 0) {
+        uint32_t args[Instruction::kMaxVarArgRegs];
+        inst->GetVarArgs(args);
+        uint32_t count = inst->VRegA_35c();
+        if (count > Instruction::kMaxVarArgRegs)
+            return false;
+        for (uint32_t i = 0 ; i < count ; ++i) {
+            if (args[i] >= num_regs_)
+                return false;
+        }
+    } else if ((flags & (Instruction::kVerifyVarArgRange |
+                         Instruction::kVerifyVarArgRangeNonZero)) != 0) {
+        if (inst->VRegC_3rc() + inst->VRegA_3rc() > num_regs_)
+            return false;
+    }
+    return true;
+}
+
+void RegisterTypes::SetParameters(const DexFile::CodeItem* code_item, uint32_t dex_method_idx,
+                                  uint32_t access_flags, Type* line) const
+{
+    // The ins are the last registers, starting with this for an instance
+    // method.
+    uint32_t reg = num_regs_ - std::min<uint32_t>(code_item->ins_size_, num_regs_);
+    const DexFile::MethodId& method_id = dex_file_->GetMethodId(dex_method_idx);
+    if ((access_flags & kAccStatic) == 0 && reg < num_regs_) {
+        Type self = {kReference, dex_file_->StringByTypeIdx(method_id.class_idx_)};
+        line[reg++] = self;
+    }
+
+    const DexFile::TypeList* params =
+        dex_file_->GetProtoParameters(dex_file_->GetMethodPrototype(method_id));
+    uint32_t num_params = (params == nullptr)? 0 : params->Size();
+    for (uint32_t i = 0 ; i < num_params && reg < num_regs_ ; ++i) {
+        Type type = OfDescriptor(dex_file_->StringByTypeIdx(params->GetTypeItem(i).type_idx_));
+        if (IsLowHalf(type.kind_) && reg + 1 < num_regs_) {
+            WriteWide(line, reg, type.kind_);
+            reg += 2;
+        } else
+            line[reg++] = type;
+    }
+}
+
+void RegisterTypes::FillCaughtTypes(const MethodCfg& cfg)
+{
+    // A handler shared by several try items may catch different types.
+    caught_types_.clear();
+    for (const MethodCfg::Handler& handler : cfg.Handlers()) {
+        Type type = {kReference, kThrowableDescriptor};
+        if (handler.type_idx_ < dex_file_->NumTypeIds())
+            type.descriptor_ = dex_file_->StringByTypeIdx(handler.type_idx_);
+        uint32_t i = 0;
+        while (i < caught_types_.size() && caught_types_[i].first != handler.dex_pc_)
+            ++i;
+        if (i == caught_types_.size())
+            caught_types_.push_back(std::make_pair(handler.dex_pc_, type));
+        else
+            caught_types_[i].second = Merge(caught_types_[i].second, type);
+    }
+}
+
+uint32_t RegisterTypes::Apply(const Instruction* inst, uint32_t dex_pc, Type* line) const
+{
+    Instruction::Code opcode = inst->Opcode();
+    int flags = Instruction::VerifyFlagsOf(opcode);
+    Type conflict = {kConflict, nullptr};
+    Type result[kResultSlots] = {{kUndefined, nullptr}, {kUndefined, nullptr}};
+
+    // The invokes and filled-new-array only set the result register.
+    if (inst->IsInvoke()) {
+        uint32_t method_idx = inst->VRegB();
+        if (method_idx < dex_file_->NumMethodIds()) {
+            const DexFile::MethodId& method_id = dex_file_->GetMethodId(method_idx);
+            result[0] = OfDescriptor(
+                dex_file_->GetReturnTypeDescriptor(dex_file_->GetMethodPrototype(method_id)));
+            if (IsLowHalf(result[0].kind_))
+                result[1].kind_ = static_cast<Kind>(result[0].kind_ + 1);
+        }
+    } else if (opcode == Instruction::FILLED_NEW_ARRAY ||
+               opcode == Instruction::FILLED_NEW_ARRAY_RANGE) {
+        result[0] = {kReference, kObjectDescriptor};
+        if (static_cast<uint32_t>(inst->VRegB()) < dex_file_->NumTypeIds())
+            result[0].descriptor_ = dex_file_->StringByTypeIdx(inst->VRegB());
+    }
+
+    uint32_t reg = kNoReg;
+    if (inst->WritesRegisterA()) {
+        reg = inst->VRegA();
+        bool wide = (flags & Instruction::kVerifyRegAWide) != 0;
+        Type type = conflict;
+        switch (opcode) {
+          case Instruction::MOVE:
+          case Instruction::MOVE_FROM16:
+          case Instruction::MOVE_16:
+          case Instruction::MOVE_OBJECT:
+          case Instruction::MOVE_OBJECT_FROM16:
+          case Instruction::MOVE_OBJECT_16:
+          case Instruction::MOVE_WIDE:
+          case Instruction::MOVE_WIDE_FROM16:
+          case Instruction::MOVE_WIDE_16:
+            type = line[inst->VRegB()];
+            break;
+          case Instruction::MOVE_RESULT:
+          case Instruction::MOVE_RESULT_WIDE:
+          case Instruction::MOVE_RESULT_OBJECT:
+            type = line[num_regs_];
+            break;
+          case Instruction::MOVE_EXCEPTION:
+            type.kind_ = kReference;
+            type.descriptor_ = kThrowableDescriptor;
+            for (const auto& caught : caught_types_) {
+                if (caught.first == dex_pc)
+                    type = caught.second;
+            }
+            break;
+          case Instruction::CONST_4:
+          case Instruction::CONST_16:
+          case Instruction::CONST:
+          case Instruction::CONST_HIGH16:
+            type.kind_ = (inst->VRegB() == 0)? kZero : kConstant;
+            break;
+          case Instruction::CONST_WIDE_16:
+          case Instruction::CONST_WIDE_32:
+          case Instruction::CONST_WIDE:
+          case Instruction::CONST_WIDE_HIGH16:
+            type.kind_ = kConstantLo;
+            break;
+          case Instruction::CONST_STRING:
+          case Instruction::CONST_STRING_JUMBO:
+            type = {kReference, kStringDescriptor};
+            break;
+          case Instruction::CONST_CLASS:
+            type = {kReference, kClassDescriptor};
+            break;
+          case Instruction::CHECK_CAST:
+          case Instruction::NEW_INSTANCE:
+          case Instruction::NEW_ARRAY: {
+            uint32_t type_idx = (opcode == Instruction::NEW_ARRAY)? inst->VRegC() : inst->VRegB();
+            type = {kReference, kObjectDescriptor};
+            if (type_idx < dex_file_->NumTypeIds())
+                type.descriptor_ = dex_file_->StringByTypeIdx(type_idx);
+            break;
+          }
+          case Instruction::INSTANCE_OF:
+            type.kind_ = kBoolean;
+            break;
+          case Instruction::ARRAY_LENGTH:
+            type.kind_ = kInteger;
+            break;
+          case Instruction::CMPL_FLOAT:
+          case Instruction::CMPG_FLOAT:
+          case Instruction::CMPL_DOUBLE:
+          case Instruction::CMPG_DOUBLE:
+          case Instruction::CMP_LONG:
+            type.kind_ = kByte;
+            break;
+          case Instruction::AGET:
+          case Instruction::AGET_WIDE:
+          case Instruction::AGET_OBJECT: {
+            // The component type of a known array, a float or a double
+            // array telling its elements apart from the integers.
+            const Type& array = line[inst->VRegB()];
+            const char* component = (array.kind_ == kReference && array.descriptor_[0] == '[')?
+                                     array.descriptor_ + 1 : nullptr;
+            if (opcode == Instruction::AGET_OBJECT) {
+                type = {kReference, kObjectDescriptor};
+                if (component != nullptr && (*component == 'L' || *component == '['))
+                    type.descriptor_ = component;
+            } else if (opcode == Instruction::AGET_WIDE)
+                type.kind_ = (component != nullptr && *component == 'D')? kDoubleLo : kLongLo;
+            else
+                type.kind_ = (component != nullptr && *component == 'F')? kFloat : kInteger;
+            break;
+          }
+          case Instruction::AGET_BOOLEAN:
+            type.kind_ = kBoolean;
+            break;
+          case Instruction::AGET_BYTE:
+            type.kind_ = kByte;
+            break;
+          case Instruction::AGET_CHAR:
+            type.kind_ = kChar;
+            break;
+          case Instruction::AGET_SHORT:
+            type.kind_ = kShort;
+            break;
+          default:
+            if ((flags & (Instruction::kVerifyRegBField | Instruction::kVerifyRegCField)) != 0) {
+                uint32_t field_idx = ((flags & Instruction::kVerifyRegBField) != 0)?
+                                     inst->VRegB() : inst->VRegC();
+                if (field_idx < dex_file_->NumFieldIds())
+                    type = OfDescriptor(dex_file_->GetFieldTypeDescriptor(
+                        dex_file_->GetFieldId(field_idx)));
+            } else if (opcode >= Instruction::NEG_INT && opcode <= Instruction::INT_TO_SHORT)
+                type.kind_ = kUnaryOpKinds[opcode - Instruction::NEG_INT];
+            else if (opcode >= Instruction::ADD_INT && opcode <= Instruction::REM_DOUBLE_2ADDR) {
+                // The int, long, float and double operations, in two runs.
+                uint32_t op = (opcode - Instruction::ADD_INT) % 32;
+                type.kind_ = (op < 11)? kInteger : (op < 22)? kLongLo : (op < 27)? kFloat :
+                                                                               kDoubleLo;
+            } else if (opcode >= Instruction::ADD_INT_LIT16 &&
+                       opcode <= Instruction::USHR_INT_LIT8)
+                type.kind_ = kInteger;
+            break;
+        }
+
+        if (!wide)
+            Write(line, reg, type);
+        else if (IsLowHalf(type.kind_))
+            WriteWide(line, reg, type.kind_);
+        else
+            WriteWide(line, reg, kConflict);
+    }
+
+    line[num_regs_] = result[0];
+    line[num_regs_ + 1] = result[1];
+    return reg;
+}
+
+void RegisterTypes::Write(Type* line, uint32_t reg, const Type& type) const
+{
+    // Writing a half of a pair breaks the other half.
+    if (IsHighHalf(line[reg].kind_) && reg > 0)
+        line[reg - 1].kind_ = kConflict;
+    else if (IsLowHalf(line[reg].kind_) && reg + 1 < num_regs_)
+        line[reg + 1].kind_ = kConflict;
+    line[reg] = type;
+}
+
+void RegisterTypes::WriteWide(Type* line, uint32_t reg, Kind lo) const
+{
+    if (IsHighHalf(line[reg].kind_) && reg > 0)
+        line[reg - 1].kind_ = kConflict;
+    if (IsLowHalf(line[reg + 1].kind_) && reg + 2 < num_regs_)
+        line[reg + 2].kind_ = kConflict;
+    Kind hi = (lo == kConflict)? kConflict : static_cast<Kind>(lo + 1);
+    line[reg].kind_ = lo;
+    line[reg].descriptor_ = nullptr;
+    line[reg + 1].kind_ = hi;
+    line[reg + 1].descriptor_ = nullptr;
+}
+
+void RegisterTypes::Propagate(const Type* line, uint32_t block)
+{
+    Type* entry = &lines_[block * line_size_];
+    bool changed = false;
+    if (!reached_[block]) {
+        std::copy(line, line + line_size_, entry);
+        reached_[block] = true;
+        changed = true;
+    } else {
+        for (uint32_t i = 0 ; i < line_size_ ; ++i) {
+            Type merged = Merge(entry[i], line[i]);
+            if (!Equals(merged, entry[i])) {
+                entry[i] = merged;
+                changed = true;
+            }
+        }
+    }
+    if (changed && !queued_[block]) {
+        queued_[block] = true;
+        worklist_.push_back(block);
+    }
+}
+
+RegisterTypes::Type RegisterTypes::Merge(const Type& lhs, const Type& rhs)
+{
+    if (Equals(lhs, rhs))
+        return lhs;
+    Type conflict = {kConflict, nullptr};
+    const Type* lo = &lhs;
+    const Type* hi = &rhs;
+    if (lo->kind_ > hi->kind_)
+        std::swap(lo, hi);
+
+    switch (lo->kind_) {
+      case kZero:
+        if ((hi->kind_ >= kConstant && hi->kind_ <= kFloat) || hi->kind_ == kReference)
+            return *hi;
+        break;
+      case kConstant:
+        if (hi->kind_ >= kBoolean && hi->kind_ <= kInteger) {
+            Type type = {kInteger, nullptr};
+            return type;
+        }
+        if (hi->kind_ == kFloat)
+            return *hi;
+        break;
+      case kBoolean:
+      case kByte:
+      case kShort:
+      case kChar:
+        if (hi->kind_ <= kInteger) {
+            Type type = {kInteger, nullptr};
+            return type;
+        }
+        break;
+      case kConstantLo:
+        if (hi->kind_ == kLongLo || hi->kind_ == kDoubleLo)
+            return *hi;
+        break;
+      case kConstantHi:
+        if (hi->kind_ == kLongHi || hi->kind_ == kDoubleHi)
+            return *hi;
+        break;
+      case kReference: {
+        Type type = {kReference, kObjectDescriptor};
+        return type;
+      }
+      default:
+        break;
+    }
+    return conflict;
+}
+
+bool RegisterTypes::Equals(const Type& lhs, const Type& rhs)
+{
+    if (lhs.kind_ != rhs.kind_)
+        return false;
+    return lhs.kind_ != kReference || lhs.descriptor_ == rhs.descriptor_ ||
+           strcmp(lhs.descriptor_, rhs.descriptor_) == 0;
+}
+
+RegisterTypes::Type RegisterTypes::OfDescriptor(const char* descriptor)
+{
+    Type type = {kConflict, nullptr};
+    switch (descriptor[0]) {
+      case 'Z': type.kind_ = kBoolean; break;
+      case 'B': type.kind_ = kByte; break;
+      case 'S': type.kind_ = kShort; break;
+      case 'C': type.kind_ = kChar; break;
+      case 'I': type.kind_ = kInteger; break;
+      case 'F': type.kind_ = kFloat; break;
+      case 'J': type.kind_ = kLongLo; break;
+      case 'D': type.kind_ = kDoubleLo; break;
+      case 'V': type.kind_ = kUndefined; break;
+      case 'L':
+      case '[':
+        type.kind_ = kReference;
+        type.descriptor_ = descriptor;
+        break;
+      default:
+        break;
+    }
+    return type;
+}
+
+const char* RegisterTypes::Name(const Type& type)
+{
+    switch (type.kind_) {
+      case kUndefined: return "undefined";
+      case kConflict: return "conflict";
+      case kZero: return "zero";
+      case kConstant: return "const";
+      case kBoolean: return "Z";
+      case kByte: return "B";
+      case kShort: return "S";
+      case kChar: return "C";
+      case kInteger: return "I";
+      case kFloat: return "F";
+      case kConstantLo: return "const-wide";
+      case kLongLo: return "J";
+      case kDoubleLo: return "D";
+      case kReference: return type.descriptor_;
+      default: return nullptr;
+    }
+}
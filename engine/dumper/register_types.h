@@ -0,0 +1,132 @@
+#ifndef _DUMPER_REGISTER_TYPES_H_
+#define _DUMPER_REGISTER_TYPES_H_
+
+
+#include "globals.h"
+#include "macros.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "method_cfg.h"
+
+
+// The types held by the virtual registers of a method, inferred the way the
+// Dalvik verifier does it but without checking them.
+//
+// A register line holds the type of every register, followed by the two
+// slots of the result register that a move-result reads. The line at the
+// entry of each block is kept, in one flat array of fixed size lines, and a
+// worklist of blocks replays the instructions of a block on a copy of its
+// entry line, merging the line at the end into the entry lines of the
+// successors. The line flowing along an exceptional edge is the one before
+// the last instruction of the block, the only one that can throw.
+//
+// The types written by an instruction come from its opcode, with the field
+// type for a field read, the return type of the prototype for an invoke,
+// the type operand for new-instance, new-array and check-cast, and the
+// caught type for move-exception. The parameters get the types of the
+// prototype, this the declaring class.
+//
+// The lattice is flat per category: the narrow integers merge into int, a
+// constant into the int or float it meets, zero into any of those or into a
+// reference, and two distinct references into java.lang.Object, as the
+// class hierarchy of a single dex file is not known. Any other merge is a
+// conflict, and a register not yet written is undefined, which conflicts
+// with everything else.
+class RegisterTypes
+{
+  public:
+    static constexpr uint32_t kNoReg = 0xFFFFFFFF;
+
+    // The number of slots of the result register at the end of a line.
+    static constexpr uint32_t kResultSlots = 2;
+
+    enum Kind
+    {
+        kUndefined = 0,
+        kConflict,
+        kZero,           // a 32 bit zero, int, float or null
+        kConstant,       // a non zero 32 bit constant, int or float
+        kBoolean,
+        kByte,
+        kShort,
+        kChar,
+        kInteger,
+        kFloat,
+        kConstantLo,     // a 64 bit constant, long or double
+        kConstantHi,
+        kLongLo,
+        kLongHi,
+        kDoubleLo,
+        kDoubleHi,
+        kReference,
+    };
+
+    struct Type
+    {
+        Kind kind_;
+        const char* descriptor_;  // the class of a reference, nullptr otherwise
+    };
+
+    RegisterTypes() {}
+
+    // Infer the types of the registers of the code item over its graph.
+    // Returns false if an instruction refers to a register beyond
+    // registers_size_.
+    bool Build(const DexFile& dex_file, uint32_t dex_method_idx, uint32_t access_flags,
+               const DexFile::CodeItem* code_item, const MethodCfg& cfg) WARN_UNUSED;
+
+    // The number of types in a line, the registers then the result slots.
+    uint32_t LineSize() const
+    {
+        return line_size_;
+    }
+
+    // The line at the entry of a reachable block.
+    const Type* EntryLine(uint32_t block) const
+    {
+        return &lines_[block * line_size_];
+    }
+
+    // Apply the instruction at dex_pc to the line, and return the register
+    // it writes, or kNoReg. Replaying the instructions of a block from its
+    // entry line gives the types before each of them.
+    uint32_t Apply(const Instruction* inst, uint32_t dex_pc, Type* line) const;
+
+    // Returns the descriptor of a primitive or of a reference type, a short
+    // name for the other kinds, or nullptr for the high half of a pair.
+    static const char* Name(const Type& type);
+
+  private:
+    static Type Merge(const Type& lhs, const Type& rhs);
+    static bool Equals(const Type& lhs, const Type& rhs);
+    static Type OfDescriptor(const char* descriptor);
+
+    // Returns false if an operand of the instruction is beyond the lines.
+    bool CheckRegisters(const Instruction* inst) const;
+
+    void SetParameters(const DexFile::CodeItem* code_item, uint32_t dex_method_idx,
+                       uint32_t access_flags, Type* line) const;
+    void FillCaughtTypes(const MethodCfg& cfg);
+    void Write(Type* line, uint32_t reg, const Type& type) const;
+    void WriteWide(Type* line, uint32_t reg, Kind lo) const;
+    void Propagate(const Type* line, uint32_t block);
+
+    const DexFile* dex_file_;
+    uint32_t num_regs_;
+    uint32_t line_size_;
+    std::vector<Type> lines_;  // NumBlocks() lines
+    std::vector<bool> reached_;
+
+    // The merged caught types of the handlers, by handler dex_pc.
+    std::vector<std::pair<uint32_t, Type>> caught_types_;
+
+    std::vector<Type> line_;
+    std::vector<Type> throw_line_;
+    std::vector<uint32_t> worklist_;
+    std::vector<bool> queued_;
+
+    DISALLOW_COPY_AND_ASSIGN(RegisterTypes);
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
+#include "shard_dumper.h"
+#include "log.h"
+#include "scoped_fd.h"
+#include "pwrite_dumper.h"
+
+
+const char ShardDumper::kDefaultShard[] = "default-package";
+
+ShardDumper::ShardDumper(const DexFile& dex_file, char opt_granu, const DumpFilter& filter)
+  : dex_file_(dex_file),
+    filter_(filter),
+    text_dumper_(dex_file, opt_granu, filter)
+{}
+
+bool ShardDumper::Dump(const char* dir, uint32_t depth, ThreadPool* pool)
+{
+    if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+        PLOG(ERROR) << "Fail to create the output directory";
+        return false;
+    }
+
+    std::unordered_map<std::string, uint32_t> shard_ids;
+    std::vector<std::string> shard_names;
+    std::vector<std::vector<uint32_t>> shards;
+    uint32_t num_class_def = dex_file_.NumClassDefs();
+    for (uint32_t class_def_idx = 0 ; class_def_idx < num_class_def ; ++class_def_idx) {
+        if (!filter_.KeepClass(dex_file_, class_def_idx))
+            continue;
+        const DexFile::ClassDef& class_def = dex_file_.GetClassDef(class_def_idx);
+        std::string name(ShardOfClass(dex_file_.GetClassDescriptor(class_def), depth));
+        auto iter = shard_ids.find(name);
+        if (iter == shard_ids.end()) {
+            iter = shard_ids.emplace(name, shards.size()).first;
+            shard_names.push_back(name);
+            shards.emplace_back();
+        }
+        shards[iter->second].push_back(class_def_idx);
+    }
+
+    // Hand the largest shards out first, so that none of them is left to run
+    // alone at the end.
+    std::vector<uint32_t> order;
+    for (uint32_t shard = 0 ; shard < shards.size() ; ++shard)
+        order.push_back(shard);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t lhs, uint32_t rhs)
+                     { return shards[lhs].size() > shards[rhs].size(); });
+
+    std::atomic<bool> failed(false);
+    pool->ParallelFor(order.size(), [&](uint32_t idx) {
+        uint32_t shard = order[idx];
+        std::string path(dir);
+        path += '/';
+        path += shard_names[shard];
+        path += ".txt";
+        if (!failed && !WriteShard(path, shards[shard]))
+            failed = true;
+    });
+    return !failed;
+}
+
+std::string ShardDumper::ShardOfClass(const char* descriptor, uint32_t depth)
+{
+    const char* last_slash = strrchr(descriptor, '/');
+    if (descriptor[0] != 'L' || last_slash == nullptr)
+        return kDefaultShard;
+
+    std::string shard;
+    uint32_t num_components = 0;
+    for (const char* cur = descriptor + 1 ; cur < last_slash ; ++cur) {
+        if (*cur != '/')
+            shard += *cur;
+        else if (++num_components == depth)
+            break;
+        else
+            shard += '.';
+    }
+    return shard;
+}
+
+bool ShardDumper::WriteShard(const std::string& path, const std::vector<uint32_t>& classes) const
+{
+    ScopedFd fd(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (fd.get() == -1) {
+        PLOG(ERROR) << "Fail to open the shard " << path;
+        return false;
+    }
+
+    std::string buf;
+    off_t offset = 0;
+    for (uint32_t idx = 0 ; idx < classes.size() ; ++idx) {
+        text_dumper_.RenderClass(&buf, classes[idx], nullptr);
+        if (buf.size() < kBufferSize && idx + 1 < classes.size())
+            continue;
+        if (!PwriteDumper::PwriteFully(fd.get(), buf, offset)) {
+            PLOG(ERROR) << "Fail to write the shard " << path;
+            return false;
+        }
+        offset += buf.size();
+        buf.clear();
+    }
+
+    if (close(fd.release()) == -1) {
+        PLOG(ERROR) << "Fail to close the shard " << path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef _DUMPER_SHARD_DUMPER_H_
+#define _DUMPER_SHARD_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dump_filter.h"
+#include "text_dumper.h"
+
+
+// Dump the text of the classes into one file per package under a directory,
+// named after the first depth components of the package:
+//
+//   out/com.target.txt       the classes of com.target and its subpackages
+//   out/com.other.txt
+//   out/default-package.txt  the classes outside of any package
+//
+// The classes are grouped by shard upfront, and each worker renders and
+// writes a whole shard through its own buffer, so the shards never contend.
+// A shard lists its classes in class_def order, rendered as in the plain
+// text dump.
+class ShardDumper
+{
+  public:
+    // The number of bytes of formatted text a shard holds before writing
+    // them.
+    static constexpr size_t kBufferSize = 1 * MB;
+
+    // The shard of the classes outside of any package.
+    static const char kDefaultShard[];
+
+    // The filter is not owned and must outlive the dumper.
+    ShardDumper(const DexFile& dex_file, char opt_granu, const DumpFilter& filter);
+
+    bool Dump(const char* dir, uint32_t depth, ThreadPool* pool) WARN_UNUSED;
+
+  private:
+    // Returns the first depth components of the package of a class
+    // descriptor, such as "a.b" for "La/b/c/D;" and depth 2.
+    static std::string ShardOfClass(const char* descriptor, uint32_t depth);
+
+    bool WriteShard(const std::string& path, const std::vector<uint32_t>& classes) const;
+
+    const DexFile& dex_file_;
+    const DumpFilter& filter_;
+    TextDumper text_dumper_;
+
+    DISALLOW_COPY_AND_ASSIGN(ShardDumper);
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include <algorithm>
+
+#include "stats_dumper.h"
+#include "stringprintf.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+
+
+constexpr uint32_t StatsDumper::Histogram::kNumBuckets;
+
+
+void StatsDumper::Histogram::Add(uint32_t value)
+{
+    ++count_;
+    sum_ += value;
+    max_ = std::max<uint64_t>(max_, value);
+    ++buckets_[(value == 0)? 0 : (32 - __builtin_clz(value))];
+}
+
+void StatsDumper::Histogram::Merge(const Histogram& other)
+{
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+    for (uint32_t i = 0 ; i < kNumBuckets ; ++i)
+        buckets_[i] += other.buckets_[i];
+}
+
+StatsDumper::Counters::Counters()
+{
+    memset(this, 0, sizeof(*this));
+}
+
+void StatsDumper::Counters::Merge(const Counters& other)
+{
+    num_classes_ += other.num_classes_;
+    num_methods_ += other.num_methods_;
+    num_code_items_ += other.num_code_items_;
+    num_code_units_ += other.num_code_units_;
+    methods_per_class_.Merge(other.methods_per_class_);
+    insns_size_.Merge(other.insns_size_);
+    registers_size_.Merge(other.registers_size_);
+    ins_size_.Merge(other.ins_size_);
+    outs_size_.Merge(other.outs_size_);
+    tries_size_.Merge(other.tries_size_);
+    for (uint32_t i = 0 ; i < kNumPackedOpcodes ; ++i)
+        opcodes_[i] += other.opcodes_[i];
+}
+
+StatsDumper::StatsDumper(const DexFile& dex_file, const DumpFilter& filter)
+  : dex_file_(dex_file),
+    filter_(filter)
+{}
+
+bool StatsDumper::Dump(OutputSink& sink, ThreadPool* pool)
+{
+    uint32_t num_class_def = dex_file_.NumClassDefs();
+    uint32_t num_workers = pool->NumChunkWorkers(num_class_def, kClassChunkSize);
+
+    // Each worker owns one slot, so the counters are never shared while
+    // counting.
+    std::vector<Counters> slots(num_workers);
+    pool->ParallelForChunks(0, num_class_def, kClassChunkSize,
+                            [&](uint32_t worker, uint32_t, uint32_t begin, uint32_t end) {
+        for (uint32_t class_def_idx = begin ; class_def_idx < end ; ++class_def_idx) {
+            if (filter_.KeepClass(dex_file_, class_def_idx))
+                CountClass(&slots[worker], class_def_idx);
+        }
+    });
+
+    for (uint32_t worker = 1 ; worker < num_workers ; ++worker)
+        slots[0].Merge(slots[worker]);
+    return sink.Write(Report(slots[0]));
+}
+
+void StatsDumper::CountClass(Counters* counters, uint32_t class_def_idx) const
+{
+    ++counters->num_classes_;
+    const DexFile::ClassDef& class_def = dex_file_.GetClassDef(class_def_idx);
+    const byte* class_data = dex_file_.GetClassData(class_def);
+    if (class_data == nullptr) {
+        counters->methods_per_class_.Add(0);
+        return;
+    }
+
+    ClassDataItemIterator it(dex_file_, class_data);
+    SkipAllFields(it);
+    uint32_t num_methods = 0;
+    for ( ; it.HasNext() ; it.Next()) {
+        if (!filter_.KeepMethod(dex_file_, it.GetMemberIndex()))
+            continue;
+        ++num_methods;
+        const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+        if (code_item != nullptr)
+            CountCode(counters, code_item);
+    }
+    counters->num_methods_ += num_methods;
+    counters->methods_per_class_.Add(num_methods);
+}
+
+void StatsDumper::CountCode(Counters* counters, const DexFile::CodeItem* code_item) const
+{
+    ++counters->num_code_items_;
+    counters->num_code_units_ += code_item->insns_size_in_code_units_;
+    counters->insns_size_.Add(code_item->insns_size_in_code_units_);
+    counters->registers_size_.Add(code_item->registers_size_);
+    counters->ins_size_.Add(code_item->ins_size_);
+    counters->outs_size_.Add(code_item->outs_size_);
+    counters->tries_size_.Add(code_item->tries_size_);
+
+    uint64_t* opcodes = counters->opcodes_;
+    uint32_t dex_pc = 0;
+    while (dex_pc < code_item->insns_size_in_code_units_) {
+        const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+        ++opcodes[inst->Opcode()];
+        dex_pc += inst->SizeInCodeUnits();
+    }
+}
+
+void StatsDumper::ReportHistogram(std::string* out, const char* name, const Histogram& hist)
+{
+    StringAppendF(out, "%-24s count %" PRIu64 "  sum %" PRIu64 "  max %" PRIu64 "\n",
+                  name, hist.count_, hist.sum_, hist.max_);
+    for (uint32_t i = 0 ; i < Histogram::kNumBuckets ; ++i) {
+        if (hist.buckets_[i] == 0)
+            continue;
+        std::string range = (i == 0)? "  [0, 1)" :
+            StringPrintf("  [%" PRIu64 ", %" PRIu64 ")", UINT64_C(1) << (i - 1), UINT64_C(1) << i);
+        StringAppendF(out, "%-24s %" PRIu64 "\n", range.c_str(), hist.buckets_[i]);
+    }
+}
+
+std::string StatsDumper::Report(const Counters& counters)
+{
+    std::string out;
+    StringAppendF(&out, "%-24s %" PRIu64 "\n", "classes", counters.num_classes_);
+    StringAppendF(&out, "%-24s %" PRIu64 "\n", "methods", counters.num_methods_);
+    StringAppendF(&out, "%-24s %" PRIu64 "\n", "code_items", counters.num_code_items_);
+    StringAppendF(&out, "%-24s %" PRIu64 "\n", "code_units", counters.num_code_units_);
+
+    ReportHistogram(&out, "methods_per_class", counters.methods_per_class_);
+    ReportHistogram(&out, "insns_size", counters.insns_size_);
+    ReportHistogram(&out, "registers_size", counters.registers_size_);
+    ReportHistogram(&out, "ins_size", counters.ins_size_);
+    ReportHistogram(&out, "outs_size", counters.outs_size_);
+    ReportHistogram(&out, "tries_size", counters.tries_size_);
+
+    std::vector<uint32_t> opcodes;
+    uint64_t num_insns = 0;
+    for (uint32_t opcode = 0 ; opcode < kNumPackedOpcodes ; ++opcode) {
+        if (counters.opcodes_[opcode] == 0)
+            continue;
+        opcodes.push_back(opcode);
+        num_insns += counters.opcodes_[opcode];
+    }
+    std::stable_sort(opcodes.begin(), opcodes.end(),
+                     [&](uint32_t lhs, uint32_t rhs)
+                     { return counters.opcodes_[lhs] > counters.opcodes_[rhs]; });
+
+    StringAppendF(&out, "%-24s count %" PRIu64 "\n", "opcodes", num_insns);
+    for (uint32_t opcode : opcodes) {
+        uint64_t count = counters.opcodes_[opcode];
+        std::string name = StringPrintf("  %s",
+            Instruction::Name(static_cast<Instruction::Code>(opcode)));
+        StringAppendF(&out, "%-24s %" PRIu64 "  %.2f%%\n", name.c_str(), count,
+                      100.0 * count / num_insns);
+    }
+    return out;
+}
@@ -0,0 +1,90 @@
+#ifndef _DUMPER_STATS_DUMPER_H_
+#define _DUMPER_STATS_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "dump_filter.h"
+
+
+// Report the counters of a dex file, gathered by walking the kept code items
+// with Instruction::At() and SizeInCodeUnits() without formatting anything.
+// The classes are handed out to the workers in chunks, each worker counts
+// into its own flat arrays, and the arrays are merged once all are done.
+//
+// The report gives the totals, a histogram with power of two buckets per
+// distribution, and the opcodes by descending count:
+//
+//   classes                 40
+//   methods                 312
+//   ...
+//   registers_size          count 297  sum 1021  max 17
+//     [2, 4)                121
+//     [4, 8)                96
+//   ...
+//   opcodes                 count 5180
+//     invoke-virtual        1201  23.19%
+class StatsDumper
+{
+  public:
+    // The filter is not owned and must outlive the dumper.
+    StatsDumper(const DexFile& dex_file, const DumpFilter& filter);
+
+    bool Dump(OutputSink& sink, ThreadPool* pool) WARN_UNUSED;
+
+  private:
+    // The distribution of a value, bucketed by the bit length of the value:
+    // bucket 0 holds 0 and bucket k holds [2^(k-1), 2^k).
+    struct Histogram
+    {
+        static constexpr uint32_t kNumBuckets = 33;
+
+        uint64_t count_;
+        uint64_t sum_;
+        uint64_t max_;
+        uint64_t buckets_[kNumBuckets];
+
+        void Add(uint32_t value);
+        void Merge(const Histogram& other);
+    };
+
+    // The counters of a worker. Plain data, so that it can be zeroed and
+    // merged as flat arrays.
+    struct Counters
+    {
+        uint64_t num_classes_;
+        uint64_t num_methods_;
+        uint64_t num_code_items_;
+        uint64_t num_code_units_;
+
+        Histogram methods_per_class_;
+        Histogram insns_size_;
+        Histogram registers_size_;
+        Histogram ins_size_;
+        Histogram outs_size_;
+        Histogram tries_size_;
+
+        uint64_t opcodes_[kNumPackedOpcodes];
+
+        Counters();
+        void Merge(const Counters& other);
+    };
+
+    void CountClass(Counters* counters, uint32_t class_def_idx) const;
+    void CountCode(Counters* counters, const DexFile::CodeItem* code_item) const;
+
+    static void ReportHistogram(std::string* out, const char* name, const Histogram& hist);
+    static std::string Report(const Counters& counters);
+
+    const DexFile& dex_file_;
+    const DumpFilter& filter_;
+
+    DISALLOW_COPY_AND_ASSIGN(StatsDumper);
+};
+
+#endif
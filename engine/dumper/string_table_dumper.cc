@@ -0,0 +1,25 @@
+#include "string_table_dumper.h"
+#include "misc.h"
+
+
+StringTableDumper::StringTableDumper(const DexFile& dex_file)
+  : dex_file_(dex_file)
+{}
+
+bool StringTableDumper::Dump(OutputSink& sink)
+{
+    std::string buf;
+    uint32_t num_string_ids = dex_file_.NumStringIds();
+    for (uint32_t string_idx = 0 ; string_idx < num_string_ids ; ++string_idx) {
+        buf += std::to_string(string_idx);
+        buf += '\t';
+        AppendPrintableString(&buf, dex_file_.StringDataByIdx(string_idx));
+        buf += '\n';
+        if (buf.size() >= kBufferSize) {
+            if (!sink.Write(buf))
+                return false;
+            buf.clear();
+        }
+    }
+    return sink.Write(buf);
+}
@@ -0,0 +1,37 @@
+#ifndef _DUMPER_STRING_TABLE_DUMPER_H_
+#define _DUMPER_STRING_TABLE_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+
+#include "dex_file.h"
+
+
+// Export the whole string table, one string_idx and printable string per
+// line, tab separated, in string_idx order:
+//
+//   0	"<init>"
+//   1	"Hello\nworld"
+//   2	"Lcom/a/B;"
+//
+// The strings are escaped as by PrintableString(), straight into the output
+// buffer. The table is not filtered, since the strings belong to no class.
+class StringTableDumper
+{
+  public:
+    // The number of bytes of text held before writing them.
+    static constexpr size_t kBufferSize = 64 * KB;
+
+    explicit StringTableDumper(const DexFile& dex_file);
+
+    bool Dump(OutputSink& sink) WARN_UNUSED;
+
+  private:
+    const DexFile& dex_file_;
+
+    DISALLOW_COPY_AND_ASSIGN(StringTableDumper);
+};
+
+#endif
@@ -0,0 +1,351 @@
+#include <algorithm>
+
+#include "taint_analysis.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+
+
+constexpr uint32_t TaintAnalysis::kSourceBit;
+constexpr uint32_t TaintAnalysis::kMaxParamBit;
+constexpr uint32_t TaintAnalysis::kNoComponent;
+
+
+TaintAnalysis::TaintAnalysis(const std::vector<const DexFile*>& dex_files,
+                             const DumpFilter& filter)
+  : dex_files_(dex_files),
+    filter_(filter)
+{}
+
+void TaintAnalysis::Run(const GlobMatcher& sources, const GlobMatcher& sinks, ThreadPool* pool)
+{
+    graph_.Build(dex_files_, filter_, pool);
+    FillMethods();
+    FillRoles(sources, sinks);
+    FillComponents();
+    FillLevels();
+
+    uint32_t num_methods = graph_.NumMethods();
+    Summary empty = {0, 0};
+    summaries_.assign(num_methods, empty);
+    flows_.assign(num_methods, std::vector<Flow>());
+
+    // The components of a level only call the completed ones of the lower
+    // levels, so they are handed out to the workers in any order.
+    std::vector<Worker> workers(pool->GetThreadCount());
+    for (uint32_t level = 0 ; level < NumLevels() ; ++level) {
+        pool->ParallelForChunks(level_offsets_[level], level_offsets_[level + 1], 1,
+                                [&](uint32_t worker, uint32_t, uint32_t idx, uint32_t) {
+            AnalyzeComponent(&workers[worker], levels_[idx]);
+        });
+    }
+}
+
+void TaintAnalysis::FillMethods()
+{
+    // The first file defining a method gives its code, as in the graph.
+    Method external = {CallGraph::kExternal, 0, 0, nullptr};
+    methods_.assign(graph_.NumMethods(), external);
+    for (uint32_t file = 0 ; file < dex_files_.size() ; ++file) {
+        const DexFile& dex_file = *dex_files_[file];
+        uint32_t num_method_ids = dex_file.NumMethodIds();
+        for (uint32_t class_def_idx = 0 ; class_def_idx < dex_file.NumClassDefs() ;
+             ++class_def_idx) {
+            if (!filter_.KeepClass(dex_file, class_def_idx))
+                continue;
+            const byte* class_data = dex_file.GetClassData(dex_file.GetClassDef(class_def_idx));
+            if (class_data == nullptr)
+                continue;
+            ClassDataItemIterator it(dex_file, class_data);
+            SkipAllFields(it);
+            for ( ; it.HasNext() ; it.Next()) {
+                uint32_t dex_method_idx = it.GetMemberIndex();
+                const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+                if (dex_method_idx >= num_method_ids || code_item == nullptr ||
+                    !filter_.KeepMethod(dex_file, dex_method_idx))
+                    continue;
+                uint32_t id = graph_.GlobalId(file, dex_method_idx);
+                if (graph_.DefiningFile(id) != file || methods_[id].code_item_ != nullptr)
+                    continue;
+                Method method = {static_cast<uint16_t>(file), dex_method_idx,
+                                 it.GetRawMemberAccessFlags(), code_item};
+                methods_[id] = method;
+            }
+        }
+    }
+}
+
+void TaintAnalysis::FillRoles(const GlobMatcher& sources, const GlobMatcher& sinks)
+{
+    uint32_t num_methods = graph_.NumMethods();
+    roles_.assign(num_methods, 0);
+    for (uint32_t id = 0 ; id < num_methods ; ++id) {
+        const char* key = graph_.MethodKey(id).c_str();
+        if (sources.Match(key))
+            roles_[id] |= kSource;
+        if (sinks.Match(key))
+            roles_[id] |= kSink;
+    }
+}
+
+void TaintAnalysis::FillComponents()
+{
+    // The explicit stack of calls holds each open method with the position
+    // of its next callee.
+    uint32_t num_methods = graph_.NumMethods();
+    std::vector<uint32_t> index(num_methods, kNoComponent);
+    std::vector<uint32_t> low(num_methods);
+    std::vector<bool> on_stack(num_methods, false);
+    std::vector<uint32_t> stack;
+    std::vector<std::pair<uint32_t, uint32_t>> calls;
+    component_of_.assign(num_methods, kNoComponent);
+    component_offsets_.assign(1, 0);
+    members_.clear();
+
+    uint32_t next_index = 0;
+    for (uint32_t root = 0 ; root < num_methods ; ++root) {
+        if (index[root] != kNoComponent)
+            continue;
+        index[root] = low[root] = next_index++;
+        stack.push_back(root);
+        on_stack[root] = true;
+        calls.push_back(std::make_pair(root, 0));
+
+        while (!calls.empty()) {
+            uint32_t node = calls.back().first;
+            Range<uint32_t> callees = graph_.Callees(node);
+            if (calls.back().second < callees.size()) {
+                uint32_t callee = callees.begin()[calls.back().second++];
+                if (index[callee] == kNoComponent) {
+                    index[callee] = low[callee] = next_index++;
+                    stack.push_back(callee);
+                    on_stack[callee] = true;
+                    calls.push_back(std::make_pair(callee, 0));
+                } else if (on_stack[callee]) {
+                    low[node] = std::min(low[node], index[callee]);
+                }
+                continue;
+            }
+
+            calls.pop_back();
+            if (!calls.empty()) {
+                uint32_t caller = calls.back().first;
+                low[caller] = std::min(low[caller], low[node]);
+            }
+            if (low[node] != index[node])
+                continue;
+            uint32_t component = component_offsets_.size() - 1;
+            uint32_t member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                on_stack[member] = false;
+                component_of_[member] = component;
+                members_.push_back(member);
+            } while (member != node);
+            component_offsets_.push_back(members_.size());
+        }
+    }
+}
+
+void TaintAnalysis::FillLevels()
+{
+    // A component is one level above the highest component it calls, which
+    // was completed before it.
+    uint32_t num_components = NumComponents();
+    std::vector<uint32_t> level_of(num_components, 0);
+    std::vector<bool> analyzed(num_components, false);
+    uint32_t num_levels = 0;
+    for (uint32_t component = 0 ; component < num_components ; ++component) {
+        uint32_t level = 0;
+        for (uint32_t i = component_offsets_[component] ;
+             i < component_offsets_[component + 1] ; ++i) {
+            uint32_t id = members_[i];
+            if (methods_[id].code_item_ != nullptr)
+                analyzed[component] = true;
+            for (uint32_t callee : graph_.Callees(id)) {
+                uint32_t callee_component = component_of_[callee];
+                if (callee_component != component)
+                    level = std::max(level, level_of[callee_component] + 1);
+            }
+        }
+        level_of[component] = level;
+        if (analyzed[component])
+            num_levels = std::max(num_levels, level + 1);
+    }
+
+    level_offsets_.assign(num_levels + 1, 0);
+    for (uint32_t component = 0 ; component < num_components ; ++component) {
+        if (analyzed[component])
+            ++level_offsets_[level_of[component] + 1];
+    }
+    for (uint32_t level = 0 ; level < num_levels ; ++level)
+        level_offsets_[level + 1] += level_offsets_[level];
+    levels_.resize(level_offsets_[num_levels]);
+    std::vector<uint32_t> cursors(level_offsets_.begin(), level_offsets_.end() - 1);
+    for (uint32_t component = 0 ; component < num_components ; ++component) {
+        if (analyzed[component])
+            levels_[cursors[level_of[component]]++] = component;
+    }
+}
+
+void TaintAnalysis::AnalyzeComponent(Worker* worker, uint32_t component)
+{
+    // The summaries only grow with the ones of the callees, so iterating
+    // over a recursive component reaches a fixed point.
+    uint32_t begin = component_offsets_[component];
+    uint32_t end = component_offsets_[component + 1];
+    bool recursive = end - begin > 1;
+    for (uint32_t callee : graph_.Callees(members_[begin]))
+        recursive = recursive || callee == members_[begin];
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = begin ; i < end ; ++i) {
+            uint32_t id = members_[i];
+            if (methods_[id].code_item_ == nullptr)
+                continue;
+            Summary summary = Analyze(worker, id, &flows_[id]);
+            Summary& cached = summaries_[id];
+            if (summary.returns_ != cached.returns_ || summary.sinks_ != cached.sinks_) {
+                cached = summary;
+                changed = recursive;
+            }
+        }
+    }
+}
+
+TaintAnalysis::Summary TaintAnalysis::Analyze(Worker* worker, uint32_t id,
+                                              std::vector<Flow>* flows) const
+{
+    const Method& method = methods_[id];
+    const DexFile::CodeItem* code_item = method.code_item_;
+    Summary summary = {0, 0};
+    flows->clear();
+    if (!worker->cfg_.Build(code_item))
+        return summary;
+    worker->dominance_.Compute(worker->cfg_);
+    if (!worker->ssa_.Build(*dex_files_[method.file_], method.dex_method_idx_,
+                            method.access_flags_, code_item, worker->cfg_,
+                            worker->dominance_))
+        return summary;
+
+    // Each parameter starts with the bit of its ins register.
+    const MethodSsa& ssa = worker->ssa_;
+    std::vector<uint32_t>& taints = worker->taints_;
+    taints.assign(ssa.NumValues(), 0);
+    uint32_t first_in = code_item->registers_size_ -
+                        std::min(code_item->ins_size_, code_item->registers_size_);
+    for (uint32_t value = 1 ; value <= ssa.NumParameters() ; ++value)
+        taints[value] = ParamBit(ssa.GetValue(value).reg_ - first_in);
+
+    // The summary and the flows of the last sweep, which grew no mask, hold.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        summary.returns_ = summary.sinks_ = 0;
+        flows->clear();
+        for (uint32_t block = 0 ; block < worker->cfg_.NumBlocks() ; ++block) {
+            for (uint32_t phi = ssa.PhisBegin(block) ; phi < ssa.PhisEnd(block) ; ++phi) {
+                uint32_t taint = 0;
+                for (uint32_t operand : ssa.Operands(phi))
+                    taint |= taints[operand];
+                Raise(worker, phi, taint, &changed);
+            }
+        }
+
+        // The result of an invoke or a filled-new-array is read by the
+        // move-result following it.
+        uint32_t result = 0;
+        for (const MethodSsa::Insn& insn : ssa.Insns()) {
+            const Instruction* inst = Instruction::At(&code_item->insns_[insn.dex_pc_]);
+            Range<uint32_t> uses = ssa.Uses(insn);
+            if (inst->IsInvoke()) {
+                result = Invoke(worker, method, inst, insn.dex_pc_, uses, &summary, flows,
+                                &changed);
+                continue;
+            }
+            uint32_t taint = 0;
+            for (uint32_t use : uses)
+                taint |= taints[use];
+            Instruction::Code opcode = inst->Opcode();
+            if (opcode == Instruction::FILLED_NEW_ARRAY ||
+                opcode == Instruction::FILLED_NEW_ARRAY_RANGE) {
+                result = taint;
+            } else if (opcode >= Instruction::MOVE_RESULT &&
+                       opcode <= Instruction::MOVE_RESULT_OBJECT) {
+                Raise(worker, insn.def_, result, &changed);
+            } else if (opcode >= Instruction::RETURN && opcode <= Instruction::RETURN_OBJECT) {
+                summary.returns_ |= taint;
+            } else if ((opcode >= Instruction::APUT && opcode <= Instruction::APUT_SHORT) ||
+                       (opcode >= Instruction::IPUT && opcode <= Instruction::IPUT_SHORT)) {
+                // The stored value taints the array or the object.
+                if (uses.size() >= 2)
+                    Raise(worker, uses.begin()[1], taints[uses.begin()[0]], &changed);
+            } else if (opcode != Instruction::MOVE_EXCEPTION) {
+                Raise(worker, insn.def_, taint, &changed);
+            }
+        }
+    }
+    return summary;
+}
+
+uint32_t TaintAnalysis::Invoke(Worker* worker, const Method& method, const Instruction* inst,
+                               uint32_t dex_pc, Range<uint32_t> uses,
+                               Summary* summary, std::vector<Flow>* flows, bool* changed) const
+{
+    const std::vector<uint32_t>& taints = worker->taints_;
+    uint32_t all = 0;
+    for (uint32_t use : uses)
+        all |= taints[use];
+    uint32_t method_idx = inst->GetIndexOperand();
+    if (inst->GetVerifyIsRuntimeOnly() ||
+        Instruction::IndexTypeOf(inst->Opcode()) != Instruction::kMethodRef ||
+        method_idx >= dex_files_[method.file_]->NumMethodIds())
+        return all;
+    uint32_t callee = graph_.GlobalId(method.file_, method_idx);
+    bool summarized = methods_[callee].code_item_ != nullptr;
+
+    // The arguments of a sink, and the ones the callee passes on to a sink.
+    uint32_t sink_params = (summarized)? summaries_[callee].sinks_ : 0;
+    if ((roles_[callee] & kSink) != 0)
+        sink_params = ~kSourceBit;
+    uint32_t reached = 0;
+    for (uint32_t slot = 0 ; slot < uses.size() ; ++slot) {
+        if ((sink_params & ParamBit(slot)) != 0)
+            reached |= taints[uses.begin()[slot]];
+    }
+    if ((reached & kSourceBit) != 0) {
+        Flow flow = {dex_pc, callee};
+        flows->push_back(flow);
+    }
+    summary->sinks_ |= reached & ~kSourceBit;
+
+    uint32_t result = ((roles_[callee] & kSource) != 0)? kSourceBit : 0;
+    if (summarized) {
+        uint32_t returns = summaries_[callee].returns_;
+        result |= returns & kSourceBit;
+        for (uint32_t slot = 0 ; slot < uses.size() ; ++slot) {
+            if ((returns & ParamBit(slot)) != 0)
+                result |= taints[uses.begin()[slot]];
+        }
+        return result;
+    }
+    Instruction::Code opcode = inst->Opcode();
+    bool is_static = opcode == Instruction::INVOKE_STATIC ||
+                     opcode == Instruction::INVOKE_STATIC_RANGE;
+    if (!is_static && uses.size() > 0)
+        Raise(worker, uses.begin()[0], all, changed);
+    return result | all;
+}
+
+void TaintAnalysis::Raise(Worker* worker, uint32_t value, uint32_t taint, bool* changed)
+{
+    if (value == MethodSsa::kNoValue)
+        return;
+    uint32_t& current = worker->taints_[value];
+    if ((current | taint) != current) {
+        current |= taint;
+        *changed = true;
+    }
+}
@@ -0,0 +1,178 @@
+#ifndef _DUMPER_TAINT_ANALYSIS_H_
+#define _DUMPER_TAINT_ANALYSIS_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "glob_matcher.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "dump_filter.h"
+#include "call_graph.h"
+#include "method_cfg.h"
+#include "dominance.h"
+#include "method_ssa.h"
+
+
+// An interprocedural taint analysis over the call graph of all the dex
+// files of an app, finding the values returned by a source method that reach
+// an argument of a sink method, such as a device id reaching a network API.
+//
+// The sources and the sinks are globs matched once against the key of every
+// method of the graph, as in "Lcom/a/B;->run(I)V", and an invoke resolves its
+// method_idx to the graph id with a single lookup in the table of its file.
+//
+// The taint of an SSA value is a mask, one bit per ins register of the
+// method and a bit for the sources. The parameters start with their own bit,
+// and the mask flows through the moves, the phis, the arithmetic and the
+// casts, from an array or an object to the values read out of it, and from a
+// value to the array or object it is stored in, so the object taints are
+// field insensitive and the static fields are not tracked. The instructions
+// are swept in address order until no mask grows.
+//
+// The summary of a method gives the ins registers and the source bit that
+// reach its return value, and the ins registers that reach a sink. An invoke
+// of a method with a summary maps it onto the arguments. An invoke of any
+// other method, not defined by the files or filtered out, passes the taint
+// of the arguments to the result and to the receiver, the way a string
+// builder does, a source adding the source bit to the result.
+//
+// The summaries are computed bottom-up over the strongly connected
+// components of the graph, which are leveled so that a component only calls
+// the components of the lower levels. The components of a level are
+// analyzed in parallel, each by one worker that iterates over the methods of
+// a recursive component until their summaries are stable. Each summary is
+// then kept for the callers, so a method is analyzed once outside of the
+// recursive components. The invoke targets are taken as they are named by
+// the instruction, like the call graph does.
+class TaintAnalysis
+{
+  public:
+    static constexpr uint32_t kSourceBit = 0x80000000;
+
+    // The ins registers from this bit on share it.
+    static constexpr uint32_t kMaxParamBit = 30;
+
+    struct Summary
+    {
+        uint32_t returns_;  // the ins bits and the source bit reaching the return value
+        uint32_t sinks_;    // the ins bits reaching a sink
+    };
+
+    // A source reaching an argument of a sink, or of a method passing that
+    // argument on to a sink.
+    struct Flow
+    {
+        uint32_t dex_pc_;
+        uint32_t callee_;
+    };
+
+    // The files and the filter are not owned and must outlive the analysis.
+    // The filter selects the analyzed code.
+    TaintAnalysis(const std::vector<const DexFile*>& dex_files, const DumpFilter& filter);
+
+    void Run(const GlobMatcher& sources, const GlobMatcher& sinks, ThreadPool* pool);
+
+    const CallGraph& Graph() const
+    {
+        return graph_;
+    }
+
+    uint32_t NumComponents() const
+    {
+        return component_offsets_.size() - 1;
+    }
+
+    uint32_t NumLevels() const
+    {
+        return level_offsets_.size() - 1;
+    }
+
+    const Summary& SummaryOf(uint32_t id) const
+    {
+        return summaries_[id];
+    }
+
+    const std::vector<Flow>& FlowsOf(uint32_t id) const
+    {
+        return flows_[id];
+    }
+
+  private:
+    static constexpr uint32_t kNoComponent = 0xFFFFFFFF;
+
+    enum Role
+    {
+        kSource = 1,
+        kSink = 2,
+    };
+
+    // The code defining a method in the files.
+    struct Method
+    {
+        uint16_t file_;
+        uint32_t dex_method_idx_;
+        uint32_t access_flags_;
+        const DexFile::CodeItem* code_item_;  // nullptr if the method is not analyzed
+    };
+
+    // The analyses of a worker, rebuilt for each method.
+    struct Worker
+    {
+        MethodCfg cfg_;
+        Dominance dominance_;
+        MethodSsa ssa_;
+        std::vector<uint32_t> taints_;
+    };
+
+    static uint32_t ParamBit(uint32_t slot)
+    {
+        return 1u << ((slot < kMaxParamBit)? slot : kMaxParamBit);
+    }
+
+    void FillMethods();
+    void FillRoles(const GlobMatcher& sources, const GlobMatcher& sinks);
+
+    // Find the components with the iterative form of Tarjan's algorithm,
+    // which completes the callees before their callers.
+    void FillComponents();
+
+    // Bucket the components with an analyzed method by level.
+    void FillLevels();
+
+    void AnalyzeComponent(Worker* worker, uint32_t component);
+    Summary Analyze(Worker* worker, uint32_t id, std::vector<Flow>* flows) const;
+
+    // The summary of the invoke at dex_pc, merging into the summary of the
+    // caller and appending a flow if a source reaches a sink. Returns the
+    // taint of the result and raises the receiver of an unknown callee.
+    uint32_t Invoke(Worker* worker, const Method& method, const Instruction* inst,
+                    uint32_t dex_pc, Range<uint32_t> uses, Summary* summary,
+                    std::vector<Flow>* flows, bool* changed) const;
+
+    static void Raise(Worker* worker, uint32_t value, uint32_t taint, bool* changed);
+
+    const std::vector<const DexFile*>& dex_files_;
+    const DumpFilter& filter_;
+    CallGraph graph_;
+
+    std::vector<Method> methods_;  // by graph id
+    std::vector<uint8_t> roles_;
+    std::vector<Summary> summaries_;
+    std::vector<std::vector<Flow>> flows_;
+
+    // The members of each component, in completion order.
+    std::vector<uint32_t> component_of_;
+    std::vector<uint32_t> component_offsets_;
+    std::vector<uint32_t> members_;
+
+    // The components with an analyzed method, by level.
+    std::vector<uint32_t> level_offsets_;
+    std::vector<uint32_t> levels_;
+
+    DISALLOW_COPY_AND_ASSIGN(TaintAnalysis);
+};
+
+#endif
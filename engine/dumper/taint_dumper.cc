@@ -0,0 +1,47 @@
+#include "taint_dumper.h"
+#include "log.h"
+#include "stringprintf.h"
+#include "glob_matcher.h"
+#include "call_graph.h"
+#include "taint_analysis.h"
+
+
+TaintDumper::TaintDumper(const std::vector<const DexFile*>& dex_files,
+                         const DumpFilter& filter)
+  : dex_files_(dex_files),
+    filter_(filter)
+{}
+
+bool TaintDumper::Dump(OutputSink& sink, const std::vector<const char*>& source_globs,
+                       const std::vector<const char*>& sink_globs, ThreadPool* pool)
+{
+    if (dex_files_.size() >= CallGraph::kExternal) {
+        LOG(ERROR) << "Too many input dex files for the taint analysis.";
+        return false;
+    }
+    GlobMatcher sources, sinks;
+    for (const char* glob : source_globs)
+        sources.Add(glob);
+    for (const char* glob : sink_globs)
+        sinks.Add(glob);
+    TaintAnalysis taint(dex_files_, filter_);
+    taint.Run(sources, sinks, pool);
+
+    const CallGraph& graph = taint.Graph();
+    std::string buf;
+    for (uint32_t id = 0 ; id < graph.NumMethods() ; ++id) {
+        const std::vector<TaintAnalysis::Flow>& flows = taint.FlowsOf(id);
+        if (flows.empty())
+            continue;
+        StringAppendF(&buf, "%s\n", graph.MethodKey(id).c_str());
+        for (const TaintAnalysis::Flow& flow : flows)
+            StringAppendF(&buf, "\t0x%04x: %s\n", flow.dex_pc_,
+                          graph.MethodKey(flow.callee_).c_str());
+        if (buf.size() >= kBufferSize) {
+            if (!sink.Write(buf))
+                return false;
+            buf.clear();
+        }
+    }
+    return sink.Write(buf);
+}
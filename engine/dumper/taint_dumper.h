@@ -0,0 +1,43 @@
+#ifndef _DUMPER_TAINT_DUMPER_H_
+#define _DUMPER_TAINT_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dump_filter.h"
+
+
+// List the methods where a value returned by a source method reaches a sink
+// method, in the order of their ids in the call graph, each followed by the
+// invokes the flows go through, with the sinks or the methods passing the
+// argument on to a sink:
+//
+//   Lcom/a/B;->run()V
+//   	0x0013: Lcom/a/B;->send(Ljava/lang/String;)V
+//
+// The sources and the sinks are globs matched against the method keys, see
+// taint_analysis.h.
+class TaintDumper
+{
+  public:
+    // The number of bytes of text held before writing them.
+    static constexpr size_t kBufferSize = 64 * KB;
+
+    // The files and the filter are not owned and must outlive the dumper.
+    TaintDumper(const std::vector<const DexFile*>& dex_files, const DumpFilter& filter);
+
+    bool Dump(OutputSink& sink, const std::vector<const char*>& source_globs,
+              const std::vector<const char*>& sink_globs, ThreadPool* pool) WARN_UNUSED;
+
+  private:
+    const std::vector<const DexFile*>& dex_files_;
+    const DumpFilter& filter_;
+
+    DISALLOW_COPY_AND_ASSIGN(TaintDumper);
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "globals.h"
+#include "log.h"
+#include "scoped_map.h"
+#include "cmd_opt.h"
+
+#include "dex_file.h"
+#include "dump_filter.h"
+#include "arrow_dumper.h"
+
+
+// The names exported as Arrow streams by a minimal dex file holding the class
+// LT; with the one static method "V LT;->m()", which loads two strings that
+// are not valid UTF-8 in their modified UTF-8 form:
+//
+//   0000: const-string v0, "a\0b"
+//   0002: const-string v0, "\U0001D11E"
+//   0004: return-void
+
+static uint32_t failures = 0;
+
+static const char* kPrefix = "arrow_dumper_test";
+
+static void Expect(bool cond, const char* what)
+{
+    if (!cond) {
+        LOG(ERROR) << "Failed: " << what;
+        ++failures;
+    }
+}
+
+static void Put16(byte* base, uint32_t off, uint16_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static void Put32(byte* base, uint32_t off, uint32_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static const DexFile* OpenTestDexFile()
+{
+    byte* base = reinterpret_cast<byte*>(mmap(nullptr, kPageSize, PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+        return nullptr;
+    memcpy(base, "dex\n035", 8);
+    Put32(base, 0x20, kPageSize);  // file_size_
+    Put32(base, 0x24, 0x70);       // header_size_
+    Put32(base, 0x28, 0x12345678);  // endian_tag_
+
+    // The strings "LT;", "V", "m", "a\0b" and U+1D11E, then the types LT;
+    // and V, the proto ()V, the method LT;->m and the class LT;.
+    Put32(base, 0x38, 5);
+    Put32(base, 0x3C, 0x70);
+    Put32(base, 0x40, 2);
+    Put32(base, 0x44, 0x84);
+    Put32(base, 0x48, 1);
+    Put32(base, 0x4C, 0x8C);
+    Put32(base, 0x58, 1);
+    Put32(base, 0x5C, 0x98);
+    Put32(base, 0x60, 1);
+    Put32(base, 0x64, 0xA0);
+    Put32(base, 0x70, 0x100);
+    Put32(base, 0x74, 0x105);
+    Put32(base, 0x78, 0x108);
+    Put32(base, 0x7C, 0x10B);
+    Put32(base, 0x80, 0x111);
+    memcpy(base + 0x100, "\x03LT;\0\x01V\0\x01m\0\x03" "a\xC0\x80" "b\0\x02\xED\xA0\xB4\xED\xB4\x9E",
+           25);
+    Put32(base, 0x84, 0);
+    Put32(base, 0x88, 1);
+    Put32(base, 0x8C, 1);
+    Put16(base, 0x90, 1);
+    Put16(base, 0x98, 0);
+    Put16(base, 0x9A, 0);
+    Put32(base, 0x9C, 2);
+
+    Put16(base, 0xA0, 0);       // class_idx_
+    Put32(base, 0xA4, 0x1);     // access_flags_
+    Put16(base, 0xA8, 0xFFFF);  // superclass_idx_
+    Put32(base, 0xB0, 0xFFFFFFFF);  // source_file_idx_
+    Put32(base, 0xB8, 0x180);   // class_data_off_
+
+    // One direct method, public static, whose code item is at 0x200.
+    memcpy(base + 0x180, "\x00\x00\x01\x00\x00\x09\x80\x04", 8);
+    Put16(base, 0x200, 1);  // registers_size_
+    Put32(base, 0x20C, 5);  // insns_size_in_code_units_
+    Put16(base, 0x210, 0x001A);
+    Put16(base, 0x212, 3);
+    Put16(base, 0x214, 0x001A);
+    Put16(base, 0x216, 4);
+    Put16(base, 0x218, 0x000E);
+
+    ScopedMap mem_map(base, kPageSize, kPageSize);
+    return DexFile::OpenMemory(mem_map);
+}
+
+static std::string ReadTable(const char* suffix)
+{
+    std::string path(kPrefix);
+    path += suffix;
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    unlink(path.c_str());
+    return bytes;
+}
+
+// The loaded strings are sent as UTF-8, in the dictionary of the instruction
+// stream only.
+static void TestNamesAreUtf8(const DexFile& dex_file)
+{
+    DumperOption opt = DumperOption();
+    DumpFilter filter(opt);
+    ArrowDumper dumper(dex_file, kGranuCodeInstruction, filter);
+    Expect(dumper.Dump(kPrefix, false), "the streams are written");
+
+    std::string classes = ReadTable(".classes.arrows");
+    std::string methods = ReadTable(".methods.arrows");
+    std::string instructions = ReadTable(".instructions.arrows");
+    const std::string names("a\0b\xF0\x9D\x84\x9E", 7);
+    Expect(instructions.find(names) != std::string::npos,
+           "the instruction dictionary holds the UTF-8 strings");
+    Expect(instructions.find("\xC0\x80") == std::string::npos &&
+           instructions.find("\xED\xA0") == std::string::npos,
+           "the instruction stream holds no modified UTF-8");
+    Expect(classes.find(names.substr(3)) == std::string::npos &&
+           methods.find(names.substr(3)) == std::string::npos,
+           "the other dictionaries hold only their own names");
+}
+
+int main()
+{
+    std::unique_ptr<const DexFile> dex_file(OpenTestDexFile());
+    if (dex_file.get() == nullptr)
+        return EXIT_FAILURE;
+    TestNamesAreUtf8(*dex_file.get());
+    return (failures == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
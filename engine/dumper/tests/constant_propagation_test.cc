@@ -0,0 +1,150 @@
+#include "globals.h"
+#include "log.h"
+#include "scoped_map.h"
+
+#include "dex_file.h"
+#include "method_cfg.h"
+#include "dominance.h"
+#include "method_ssa.h"
+#include "constant_propagation.h"
+
+
+// The constants propagated over the SSA form of code items assembled in
+// memory, declared by a minimal dex file holding the one method "I LT;->m()",
+// an instance method.
+
+static uint32_t failures = 0;
+
+static void Expect(bool cond, const char* what)
+{
+    if (!cond) {
+        LOG(ERROR) << "Failed: " << what;
+        ++failures;
+    }
+}
+
+static void Put16(byte* base, uint32_t off, uint16_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static void Put32(byte* base, uint32_t off, uint32_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static const DexFile* OpenTestDexFile()
+{
+    byte* base = reinterpret_cast<byte*>(mmap(nullptr, kPageSize, PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+        return nullptr;
+    memcpy(base, "dex\n035", 8);
+    Put32(base, 0x20, kPageSize);  // file_size_
+    Put32(base, 0x24, 0x70);       // header_size_
+    Put32(base, 0x28, 0x12345678);  // endian_tag_
+
+    // The strings "I", "LT;" and "m", then the types I and LT;, the proto
+    // ()I and the method LT;->m.
+    Put32(base, 0x38, 3);
+    Put32(base, 0x3C, 0x70);
+    Put32(base, 0x40, 2);
+    Put32(base, 0x44, 0x7C);
+    Put32(base, 0x48, 1);
+    Put32(base, 0x4C, 0x84);
+    Put32(base, 0x58, 1);
+    Put32(base, 0x5C, 0x90);
+    Put32(base, 0x70, 0xA0);
+    Put32(base, 0x74, 0xA3);
+    Put32(base, 0x78, 0xA8);
+    memcpy(base + 0xA0, "\x01I\0\x03LT;\0\x01m", 11);
+    Put32(base, 0x7C, 0);
+    Put32(base, 0x80, 1);
+    Put32(base, 0x84, 0);
+    Put32(base, 0x88, 0);
+    Put16(base, 0x90, 1);
+    Put16(base, 0x92, 0);
+    Put32(base, 0x94, 2);
+
+    ScopedMap mem_map(base, kPageSize, kPageSize);
+    return DexFile::OpenMemory(mem_map);
+}
+
+static bool IsConstant(const ConstantPropagation::Constant& constant,
+                       ConstantPropagation::Kind kind, int64_t bits)
+{
+    return constant.kind_ == kind && constant.bits_ == bits;
+}
+
+// Arithmetic folded into a constant, then a branch on a constant whose dead
+// side writes another value to the register read after the join:
+//
+//   0000: const/4 v0, #2
+//   0001: const/16 v1, #40
+//   0003: mul-int/2addr v1, v0
+//   0004: add-int/lit8 v1, v1, #2
+//   0006: div-int/lit8 v2, v0, #0
+//   0008: const-string v3, string@2
+//   000a: if-nez v0, +4 (000e)
+//   000c: const/4 v1, #7
+//   000d: goto +1 (000e)
+//   000e: return v1
+static void TestFoldAndPruneBranch(const DexFile& dex_file)
+{
+    static const uint16_t kInsns[] = {
+        0x2012, 0x0113, 0x0028, 0x01B2, 0x01D8, 0x0201, 0x02DB, 0x0000, 0x031A, 0x0002,
+        0x0039, 0x0004, 0x7112, 0x0128, 0x010F,
+    };
+    alignas(4) byte buf[64] = {};
+    Put16(buf, 0, 5);   // registers_size_
+    Put16(buf, 2, 1);   // ins_size_
+    Put32(buf, 12, sizeof(kInsns) / sizeof(kInsns[0]));  // insns_size_in_code_units_
+    memcpy(buf + 16, kInsns, sizeof(kInsns));
+    const DexFile::CodeItem* code_item = reinterpret_cast<const DexFile::CodeItem*>(buf);
+
+    MethodCfg cfg;
+    Dominance dominance;
+    MethodSsa ssa;
+    ConstantPropagation propagation;
+    if (!cfg.Build(code_item)) {
+        Expect(false, "the graph is built");
+        return;
+    }
+    dominance.Compute(cfg);
+    if (!ssa.Build(dex_file, 0, 0, code_item, cfg, dominance)) {
+        Expect(false, "the SSA form is built");
+        return;
+    }
+    propagation.Run(code_item, cfg, ssa);
+
+    const MethodSsa::Insn* add = ssa.InsnAt(0x4);
+    const MethodSsa::Insn* div = ssa.InsnAt(0x6);
+    const MethodSsa::Insn* konst = ssa.InsnAt(0x8);
+    const MethodSsa::Insn* ret = ssa.InsnAt(0xE);
+    if (add == nullptr || div == nullptr || konst == nullptr || ret == nullptr) {
+        Expect(false, "the instructions are reachable");
+        return;
+    }
+    Expect(IsConstant(propagation.ValueOf(add->def_), ConstantPropagation::kInteger, 82),
+           "the arithmetic is folded");
+    Expect(propagation.ValueOf(div->def_).kind_ == ConstantPropagation::kBottom,
+           "a division by zero is varying");
+    Expect(IsConstant(propagation.ValueOf(konst->def_), ConstantPropagation::kString, 2),
+           "the string is a constant");
+
+    Expect(!propagation.IsExecutable(cfg.BlockOf(0xC)), "the fall through is not executable");
+    Expect(propagation.IsExecutable(cfg.BlockOf(0xE)), "the branch target is executable");
+    uint32_t read = ssa.Uses(*ret).begin()[0];
+    Expect(ssa.GetValue(read).kind_ == MethodSsa::kPhi, "the join reads a phi");
+    Expect(IsConstant(propagation.ValueOf(read), ConstantPropagation::kInteger, 82),
+           "the dead branch does not spoil the join");
+}
+
+int main()
+{
+    std::unique_ptr<const DexFile> dex_file(OpenTestDexFile());
+    if (dex_file.get() == nullptr)
+        return EXIT_FAILURE;
+    TestFoldAndPruneBranch(*dex_file.get());
+    return (failures == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,150 @@
+#include "globals.h"
+#include "log.h"
+
+#include "dex_file.h"
+#include "method_cfg.h"
+#include "dominance.h"
+
+
+// The dominators, the post-dominators and the loops of control flow graphs
+// built from code items assembled in memory.
+
+static uint32_t failures = 0;
+
+static void Expect(bool cond, const char* what)
+{
+    if (!cond) {
+        LOG(ERROR) << "Failed: " << what;
+        ++failures;
+    }
+}
+
+static void Put16(byte* base, uint32_t off, uint16_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static void Put32(byte* base, uint32_t off, uint32_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+// Lay out a code item without try items over the given code units.
+template <uint32_t N>
+static const DexFile::CodeItem* MakeCodeItem(byte* buf, const uint16_t (&insns)[N])
+{
+    Put16(buf, 0, 1);   // registers_size_
+    Put32(buf, 12, N);  // insns_size_in_code_units_
+    for (uint32_t i = 0 ; i < N ; ++i)
+        Put16(buf, 16 + 2 * i, insns[i]);
+    return reinterpret_cast<const DexFile::CodeItem*>(buf);
+}
+
+// Two nested loops, the inner one left by a branch to the latch of the outer:
+//
+//   0000: const/4 v0, #0          B0
+//   0001: if-eqz v0, +6 (0007)    B1, the outer header
+//   0003: if-eqz v0, +3 (0006)    B2, the inner header
+//   0005: goto -2 (0003)          B3
+//   0006: goto -5 (0001)          B4
+//   0007: return-void             B5
+static void TestNestedLoops()
+{
+    static const uint16_t kInsns[] = {0x0012, 0x0038, 0x0006, 0x0038, 0x0003, 0xFE28, 0xFB28,
+                                      0x000E};
+    alignas(4) byte buf[64] = {};
+    const DexFile::CodeItem* code_item = MakeCodeItem(buf, kInsns);
+
+    MethodCfg cfg;
+    Dominance dominance;
+    if (!cfg.Build(code_item) || cfg.NumBlocks() != 6) {
+        Expect(false, "the graph is built");
+        return;
+    }
+    dominance.Compute(cfg);
+
+    Expect(dominance.ImmediateDominator(0) == Dominance::kNone &&
+           dominance.ImmediateDominator(1) == 0 && dominance.ImmediateDominator(2) == 1 &&
+           dominance.ImmediateDominator(3) == 2 && dominance.ImmediateDominator(4) == 2 &&
+           dominance.ImmediateDominator(5) == 1,
+           "the immediate dominators");
+    Expect(dominance.ImmediatePostDominator(0) == 1 &&
+           dominance.ImmediatePostDominator(1) == 5 &&
+           dominance.ImmediatePostDominator(2) == 4 &&
+           dominance.ImmediatePostDominator(3) == 2 &&
+           dominance.ImmediatePostDominator(4) == 1 &&
+           dominance.ImmediatePostDominator(5) == Dominance::kNone,
+           "the immediate post-dominators");
+    Expect(dominance.Dominates(1, 4) && dominance.Dominates(2, 2) &&
+           !dominance.Dominates(3, 4) && !dominance.Dominates(5, 1),
+           "the dominance queries");
+
+    Range<uint32_t> children = dominance.DominatorTreeChildren(2);
+    Expect(children.size() == 2 && children.begin()[0] + children.begin()[1] == 7 &&
+           cfg.RpoNumber(children.begin()[0]) < cfg.RpoNumber(children.begin()[1]),
+           "the children of the inner header, in reverse postorder");
+
+    const std::vector<Dominance::Loop>& loops = dominance.Loops();
+    if (loops.size() != 2) {
+        Expect(false, "the two loops are found");
+        return;
+    }
+    Expect(loops[0].header_ == 1 && loops[0].parent_ == Dominance::kNone &&
+           loops[0].depth_ == 1 && loops[0].num_blocks_ == 4,
+           "the outer loop");
+    Expect(loops[1].header_ == 2 && loops[1].parent_ == 0 && loops[1].depth_ == 2 &&
+           loops[1].num_blocks_ == 2,
+           "the inner loop");
+    const std::vector<uint32_t>& back_edges = dominance.BackEdges();
+    Expect(loops[0].back_edges_end_ - loops[0].back_edges_begin_ == 1 &&
+           back_edges[loops[0].back_edges_begin_] == 4 &&
+           loops[1].back_edges_end_ - loops[1].back_edges_begin_ == 1 &&
+           back_edges[loops[1].back_edges_begin_] == 3,
+           "the back edges");
+    Expect(dominance.LoopOf(0) == Dominance::kNone && dominance.LoopOf(3) == 1 &&
+           dominance.LoopOf(4) == 0 && dominance.LoopDepth(3) == 2 &&
+           dominance.LoopDepth(5) == 0,
+           "the innermost loops of the blocks");
+    Expect(dominance.NumIrreducibleEdges() == 0, "the loops are reducible");
+}
+
+// An endless cycle entered at both of its blocks:
+//
+//   0000: if-eqz v0, +3 (0003)    B0
+//   0002: goto +1 (0003)          B1
+//   0003: goto -1 (0002)          B2
+//
+// Neither block dominates the other, so the cycle is irreducible and forms no
+// loop, and no block reaches the exit.
+static void TestIrreducibleEndlessCycle()
+{
+    static const uint16_t kInsns[] = {0x0038, 0x0003, 0x0128, 0xFF28};
+    alignas(4) byte buf[64] = {};
+    const DexFile::CodeItem* code_item = MakeCodeItem(buf, kInsns);
+
+    MethodCfg cfg;
+    Dominance dominance;
+    if (!cfg.Build(code_item) || cfg.NumBlocks() != 3) {
+        Expect(false, "the graph is built");
+        return;
+    }
+    dominance.Compute(cfg);
+
+    Expect(dominance.ImmediateDominator(1) == 0 && dominance.ImmediateDominator(2) == 0,
+           "the entry dominates the cycle");
+    Expect(dominance.NumIrreducibleEdges() == 1 && dominance.Loops().empty(),
+           "the cycle is irreducible");
+    Expect(dominance.LoopOf(1) == Dominance::kNone && dominance.LoopOf(2) == Dominance::kNone,
+           "the cycle blocks are in no loop");
+    Expect(dominance.ImmediatePostDominator(0) == Dominance::kNone &&
+           dominance.ImmediatePostDominator(1) == Dominance::kNone &&
+           dominance.ImmediatePostDominator(2) == Dominance::kNone,
+           "the blocks have no post-dominator");
+}
+
+int main()
+{
+    TestNestedLoops();
+    TestIrreducibleEndlessCycle();
+    return (failures == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,115 @@
+#include "globals.h"
+#include "log.h"
+
+#include "ioc_matcher.h"
+
+
+// The indicators found by the automaton, checked against a plain substring
+// search. The test is built twice, the second time with __SSE2__ undefined,
+// so that the shuffle skip and the single byte skip give the same matches.
+
+static uint32_t failures = 0;
+
+static const char* kIndicatorsPath = "ioc_matcher_test.txt";
+
+// Overlapping indicators, a first byte at or above 0x80, and blank lines.
+static const char* kIndicators[] = {
+    "evil.com", "c2.example.org", "AKIA", "abcd", "bc", "c", "\xE2\x82\xAC" "1",
+    "\xC3\xA9t\xC3\xA9",
+};
+
+static void Expect(bool cond, const char* what)
+{
+    if (!cond) {
+        LOG(ERROR) << "Failed: " << what;
+        ++failures;
+    }
+}
+
+// Returns the indicators found by a substring search, in increasing order.
+static std::vector<uint32_t> FindAll(const char* str)
+{
+    std::vector<uint32_t> found;
+    for (uint32_t i = 0 ; i < sizeof(kIndicators) / sizeof(kIndicators[0]) ; ++i) {
+        if (strstr(str, kIndicators[i]) != nullptr)
+            found.push_back(i);
+    }
+    return found;
+}
+
+static bool ScanMatches(const IocMatcher& matcher, const char* str)
+{
+    std::vector<uint32_t> found;
+    matcher.Scan(str, &found);
+    return found == FindAll(str);
+}
+
+static void TestScan(const IocMatcher& matcher)
+{
+    std::vector<uint32_t> found;
+    matcher.Scan("see abcd, then abcd", &found);
+    Expect(found.size() == 3 && found[0] == 3 && found[1] == 4 && found[2] == 5,
+           "the overlapping indicators are found once each");
+    Expect(ScanMatches(matcher, ""), "the empty string");
+    Expect(ScanMatches(matcher, "https://c2.example.org/\xE2\x82\xAC" "1?k=AKIA"),
+           "the indicators in a URL");
+    Expect(ScanMatches(matcher, "r\xC3\xA9sum\xC3\xA9 \xC3\xA9t\xC3\xA9 \xE2\x82\xAC" "2"),
+           "the multibyte indicators");
+
+    // Strings of the bytes the indicators start with and of filler bytes,
+    // long enough to go through the 16 byte chunks.
+    static const char kBytes[] = "eAabcdikmo.\xE2\x82\xAC\xC3\xA9 xyz-/\x7F\x80\xFF";
+    uint32_t seed = 12345;
+    char str[200];
+    bool all_match = true;
+    for (uint32_t round = 0 ; round < 20000 ; ++round) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t length = (seed >> 16) % (sizeof(str) - 1);
+        for (uint32_t i = 0 ; i < length ; ++i) {
+            seed = seed * 1103515245 + 12345;
+            str[i] = kBytes[(seed >> 16) % (sizeof(kBytes) - 1)];
+        }
+        str[length] = '\0';
+        all_match = all_match && ScanMatches(matcher, str);
+    }
+    Expect(all_match, "the random strings");
+}
+
+// The strings ending at the last byte of a page followed by an unmapped one
+// must be scanned without reading past their NUL.
+static void TestPageEnd(const IocMatcher& matcher)
+{
+    byte* base = reinterpret_cast<byte*>(mmap(nullptr, 2 * kPageSize, PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED || mprotect(base + kPageSize, kPageSize, PROT_NONE) != 0) {
+        Expect(false, "the pages are mapped");
+        return;
+    }
+    static const char kText[] = "xx evil.com yy c2.example.org zz abcd \xC3\xA9t\xC3\xA9 AKIA qq";
+    for (uint32_t length = 0 ; length < sizeof(kText) ; ++length) {
+        char* str = reinterpret_cast<char*>(base + kPageSize - length - 1);
+        memcpy(str, kText + sizeof(kText) - 1 - length, length + 1);
+        Expect(ScanMatches(matcher, str), "a string ending at a page end");
+    }
+    munmap(base, 2 * kPageSize);
+}
+
+int main()
+{
+    {
+        std::ofstream out(kIndicatorsPath);
+        for (const char* indicator : kIndicators)
+            out << "  " << indicator << "\n\n";
+    }
+    IocMatcher matcher;
+    bool compiled = matcher.Compile(kIndicatorsPath);
+    unlink(kIndicatorsPath);
+    if (!compiled)
+        return EXIT_FAILURE;
+    Expect(matcher.NumIndicators() == sizeof(kIndicators) / sizeof(kIndicators[0]) &&
+           matcher.Indicator(0) == "evil.com",
+           "the blank lines and the blanks around the indicators are skipped");
+    TestScan(matcher);
+    TestPageEnd(matcher);
+    return (failures == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,79 @@
+#include "globals.h"
+#include "log.h"
+#include "json_writer.h"
+
+
+// The escaping of the strings written by the JSON Lines writer, which are
+// modified UTF-8 and must come out as valid UTF-8 JSON.
+
+static uint32_t failures = 0;
+
+static void Expect(bool cond, const char* what)
+{
+    if (!cond) {
+        LOG(ERROR) << "Failed: " << what;
+        ++failures;
+    }
+}
+
+// A sink collecting what it is given in memory.
+class StringSink : public OutputSink
+{
+  public:
+    StringSink()
+    {}
+
+    bool Write(const char* data, size_t size) override
+    {
+        str_.append(data, size);
+        return true;
+    }
+
+    bool Close() override
+    {
+        return true;
+    }
+
+    const std::string& str() const
+    {
+        return str_;
+    }
+
+  private:
+    std::string str_;
+
+    DISALLOW_COPY_AND_ASSIGN(StringSink);
+};
+
+// Returns the record holding the given string as its only member.
+static std::string WriteString(const char* str)
+{
+    StringSink sink;
+    JsonLinesWriter writer(&sink);
+    writer.BeginRecord();
+    writer.AddString("s", str);
+    writer.EndRecord();
+    Expect(writer.Flush(), "the record is written");
+    return sink.str();
+}
+
+// The two byte NUL and the surrogate pair of U+1D11E are escaped, while the
+// other multibyte sequences, U+00E9 and U+D7FF among them, are copied.
+static void TestModifiedUtf8IsEscaped()
+{
+    Expect(WriteString("nul\xC0\x80x") == "{\"s\":\"nul\\u0000x\"}\n",
+           "the NUL is escaped");
+    Expect(WriteString("clef \xED\xA0\xB4\xED\xB4\x9E.") ==
+           "{\"s\":\"clef \\ud834\\udd1e.\"}\n",
+           "the supplementary character is escaped as a surrogate pair");
+    Expect(WriteString("\xC3\xA9\xED\x9F\xBF") == "{\"s\":\"\xC3\xA9\xED\x9F\xBF\"}\n",
+           "the valid UTF-8 is copied");
+    Expect(WriteString("\"\\\n\x01") == "{\"s\":\"\\\"\\\\\\n\\u0001\"}\n",
+           "the ASCII escapes are kept");
+}
+
+int main()
+{
+    TestModifiedUtf8IsEscaped();
+    return (failures == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,151 @@
+#include "globals.h"
+#include "log.h"
+#include "scoped_map.h"
+
+#include "dex_file.h"
+#include "method_cfg.h"
+#include "dominance.h"
+#include "method_ssa.h"
+
+
+// The SSA form of code items assembled in memory, declared by a minimal dex
+// file holding the one method "I LT;->m()", an instance method.
+
+static uint32_t failures = 0;
+
+static void Expect(bool cond, const char* what)
+{
+    if (!cond) {
+        LOG(ERROR) << "Failed: " << what;
+        ++failures;
+    }
+}
+
+static void Put16(byte* base, uint32_t off, uint16_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static void Put32(byte* base, uint32_t off, uint32_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static const DexFile* OpenTestDexFile()
+{
+    byte* base = reinterpret_cast<byte*>(mmap(nullptr, kPageSize, PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+        return nullptr;
+    memcpy(base, "dex\n035", 8);
+    Put32(base, 0x20, kPageSize);  // file_size_
+    Put32(base, 0x24, 0x70);       // header_size_
+    Put32(base, 0x28, 0x12345678);  // endian_tag_
+
+    // The strings "I", "LT;" and "m", then the types I and LT;, the proto
+    // ()I and the method LT;->m.
+    Put32(base, 0x38, 3);
+    Put32(base, 0x3C, 0x70);
+    Put32(base, 0x40, 2);
+    Put32(base, 0x44, 0x7C);
+    Put32(base, 0x48, 1);
+    Put32(base, 0x4C, 0x84);
+    Put32(base, 0x58, 1);
+    Put32(base, 0x5C, 0x90);
+    Put32(base, 0x70, 0xA0);
+    Put32(base, 0x74, 0xA3);
+    Put32(base, 0x78, 0xA8);
+    memcpy(base + 0xA0, "\x01I\0\x03LT;\0\x01m", 11);
+    Put32(base, 0x7C, 0);
+    Put32(base, 0x80, 1);
+    Put32(base, 0x84, 0);
+    Put32(base, 0x88, 0);
+    Put16(base, 0x90, 1);
+    Put16(base, 0x92, 0);
+    Put32(base, 0x94, 2);
+
+    ScopedMap mem_map(base, kPageSize, kPageSize);
+    return DexFile::OpenMemory(mem_map);
+}
+
+// Returns the values a read may observe, through the phis it refers to.
+static void CollectReaching(const MethodSsa& ssa, uint32_t value, std::vector<uint32_t>* out)
+{
+    if (ssa.GetValue(value).kind_ != MethodSsa::kPhi) {
+        out->push_back(value);
+        return;
+    }
+    for (uint32_t operand : ssa.Operands(value)) {
+        if (operand != value)
+            CollectReaching(ssa, operand, out);
+    }
+}
+
+// A throwing instruction overwriting a register inside a try item, whose
+// handler is only reached from it:
+//
+//   0000: const/4 v0, #0
+//   0001: iget v0, v1, field@0     (covered by a catch-all to 0004)
+//   0003: return v0
+//   0004: return v0
+//
+// The handler must read the const/4, the fall through the iget.
+static void TestHandlerSeesRegistersBeforeThrow(const DexFile& dex_file)
+{
+    alignas(4) byte buf[64] = {};
+    Put16(buf, 0, 2);   // registers_size_
+    Put16(buf, 2, 1);   // ins_size_
+    Put16(buf, 6, 1);   // tries_size_
+    Put32(buf, 12, 5);  // insns_size_in_code_units_
+    Put16(buf, 16, 0x0012);
+    Put16(buf, 18, 0x1052);
+    Put16(buf, 20, 0x0000);
+    Put16(buf, 22, 0x000F);
+    Put16(buf, 24, 0x000F);
+    Put32(buf, 28, 1);  // start_addr_
+    Put16(buf, 32, 2);  // insn_count_
+    Put16(buf, 34, 1);  // handler_off_
+    memcpy(buf + 36, "\x01\x00\x04", 3);
+    const DexFile::CodeItem* code_item = reinterpret_cast<const DexFile::CodeItem*>(buf);
+
+    MethodCfg cfg;
+    Dominance dominance;
+    MethodSsa ssa;
+    if (!cfg.Build(code_item)) {
+        Expect(false, "the graph is built");
+        return;
+    }
+    dominance.Compute(cfg);
+    if (!ssa.Build(dex_file, 0, 0, code_item, cfg, dominance)) {
+        Expect(false, "the SSA form is built");
+        return;
+    }
+
+    const MethodSsa::Insn* konst = ssa.InsnAt(0);
+    const MethodSsa::Insn* iget = ssa.InsnAt(1);
+    const MethodSsa::Insn* fallthrough = ssa.InsnAt(3);
+    const MethodSsa::Insn* handler = ssa.InsnAt(4);
+    if (konst == nullptr || iget == nullptr || fallthrough == nullptr || handler == nullptr) {
+        Expect(false, "the instructions are reachable");
+        return;
+    }
+
+    std::vector<uint32_t> reaching;
+    CollectReaching(ssa, ssa.Uses(*fallthrough).begin()[0], &reaching);
+    Expect(reaching.size() == 1 && reaching[0] == iget->def_,
+           "the fall through reads the iget");
+
+    reaching.clear();
+    CollectReaching(ssa, ssa.Uses(*handler).begin()[0], &reaching);
+    Expect(reaching.size() == 1 && reaching[0] == konst->def_,
+           "the handler reads the const/4");
+}
+
+int main()
+{
+    std::unique_ptr<const DexFile> dex_file(OpenTestDexFile());
+    if (dex_file.get() == nullptr)
+        return EXIT_FAILURE;
+    TestHandlerSeesRegistersBeforeThrow(*dex_file.get());
+    return (failures == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+
+#include "globals.h"
+#include "log.h"
+#include "scoped_map.h"
+
+#include "dex_file.h"
+#include "pattern_matcher.h"
+
+
+// The gaps between the steps of the pattern rules, scanned over a code item
+// assembled in memory, and the operands resolved against a minimal dex file
+// holding the strings "I", "LT;" and "m".
+
+static uint32_t failures = 0;
+
+static const char* kRulesPath = "pattern_matcher_test.rules";
+
+static void Expect(bool cond, const char* what)
+{
+    if (!cond) {
+        LOG(ERROR) << "Failed: " << what;
+        ++failures;
+    }
+}
+
+static void Put16(byte* base, uint32_t off, uint16_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static void Put32(byte* base, uint32_t off, uint32_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static const DexFile* OpenTestDexFile()
+{
+    byte* base = reinterpret_cast<byte*>(mmap(nullptr, kPageSize, PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+        return nullptr;
+    memcpy(base, "dex\n035", 8);
+    Put32(base, 0x20, kPageSize);  // file_size_
+    Put32(base, 0x24, 0x70);       // header_size_
+    Put32(base, 0x28, 0x12345678);  // endian_tag_
+
+    // The strings "I", "LT;" and "m", then the types I and LT;, the proto
+    // ()I and the method LT;->m.
+    Put32(base, 0x38, 3);
+    Put32(base, 0x3C, 0x70);
+    Put32(base, 0x40, 2);
+    Put32(base, 0x44, 0x7C);
+    Put32(base, 0x48, 1);
+    Put32(base, 0x4C, 0x84);
+    Put32(base, 0x58, 1);
+    Put32(base, 0x5C, 0x90);
+    Put32(base, 0x70, 0xA0);
+    Put32(base, 0x74, 0xA3);
+    Put32(base, 0x78, 0xA8);
+    memcpy(base + 0xA0, "\x01I\0\x03LT;\0\x01m", 11);
+    Put32(base, 0x7C, 0);
+    Put32(base, 0x80, 1);
+    Put32(base, 0x84, 0);
+    Put32(base, 0x88, 0);
+    Put16(base, 0x90, 1);
+    Put16(base, 0x92, 0);
+    Put32(base, 0x94, 2);
+
+    ScopedMap mem_map(base, kPageSize, kPageSize);
+    return DexFile::OpenMemory(mem_map);
+}
+
+// Compile the rules, given as the lines of a rules file.
+static bool CompileRules(PatternMatcher* matcher, const char* rules)
+{
+    {
+        std::ofstream out(kRulesPath);
+        out << rules;
+    }
+    bool compiled = matcher->Compile(kRulesPath);
+    unlink(kRulesPath);
+    return compiled;
+}
+
+static bool ByEndThenRule(const PatternMatcher::Match& lhs, const PatternMatcher::Match& rhs)
+{
+    return (lhs.end_pc_ != rhs.end_pc_)? lhs.end_pc_ < rhs.end_pc_ : lhs.rule_ < rhs.rule_;
+}
+
+// A payload skipped by a goto, which the gaps do not count:
+//
+//   0000: const/4 v0, #0
+//   0001: const/4 v1, #1
+//   0002: const-string v0, string@2
+//   0004: goto +5 (0009)
+//   0005: fill-array-data-payload, of no element
+//   0009: return v0
+static void TestGaps(const DexFile& dex_file)
+{
+    static const uint16_t kInsns[] = {
+        0x0012, 0x1112, 0x001A, 0x0002, 0x0528, 0x0300, 0x0001, 0x0000, 0x0000, 0x000F,
+    };
+    alignas(4) byte buf[64] = {};
+    Put16(buf, 0, 2);   // registers_size_
+    Put32(buf, 12, sizeof(kInsns) / sizeof(kInsns[0]));  // insns_size_in_code_units_
+    memcpy(buf + 16, kInsns, sizeof(kInsns));
+    const DexFile::CodeItem* code_item = reinterpret_cast<const DexFile::CodeItem*>(buf);
+
+    PatternMatcher matcher(dex_file);
+    if (!CompileRules(&matcher,
+                      "skip-payload: const-string ...1 return\n"
+                      "too-tight: const-string ...0 return\n"
+                      "operand: const-string:m goto\n"
+                      "other-operand: const-string:x* goto\n"
+                      "unbounded: const/4 ... return\n"
+                      "# A comment, then a blank line.\n"
+                      "\n"
+                      "adjacent: const/4 const/4\n"
+                      "one-between: const/4 ...1 goto\n")) {
+        Expect(false, "the rules are compiled");
+        return;
+    }
+    Expect(matcher.NumRules() == 7 && matcher.RuleName(6) == "one-between",
+           "the rules are numbered in order");
+
+    PatternMatcher::Scratch scratch;
+    std::vector<PatternMatcher::Match> matches;
+    matcher.Scan(code_item, &scratch, &matches);
+    std::sort(matches.begin(), matches.end(), ByEndThenRule);
+
+    // The matches ending together start at the latest address.
+    static const PatternMatcher::Match kExpected[] = {
+        {5, 0x0, 0x2}, {2, 0x2, 0x5}, {6, 0x1, 0x5}, {0, 0x2, 0xA}, {4, 0x1, 0xA},
+    };
+    uint32_t num_expected = sizeof(kExpected) / sizeof(kExpected[0]);
+    if (matches.size() != num_expected) {
+        Expect(false, "the number of matches");
+        return;
+    }
+    for (uint32_t i = 0 ; i < num_expected ; ++i) {
+        Expect(matches[i].rule_ == kExpected[i].rule_ &&
+               matches[i].begin_pc_ == kExpected[i].begin_pc_ &&
+               matches[i].end_pc_ == kExpected[i].end_pc_,
+               "the match of a rule");
+    }
+}
+
+// A gap must stand between two steps and hold a count.
+static void TestMalformedGaps(const DexFile& dex_file)
+{
+    static const char* kMalformed[] = {
+        "leading: ...2 goto\n",
+        "trailing: goto ...\n",
+        "doubled: goto ... ...1 return\n",
+        "not-a-count: goto ...x return\n",
+        "negative: goto ...-1 return\n",
+    };
+    for (const char* rules : kMalformed) {
+        PatternMatcher matcher(dex_file);
+        Expect(!CompileRules(&matcher, rules), rules);
+    }
+}
+
+int main()
+{
+    std::unique_ptr<const DexFile> dex_file(OpenTestDexFile());
+    if (dex_file.get() == nullptr)
+        return EXIT_FAILURE;
+    TestGaps(*dex_file.get());
+    TestMalformedGaps(*dex_file.get());
+    return (failures == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
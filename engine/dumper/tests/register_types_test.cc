@@ -0,0 +1,145 @@
+#include "globals.h"
+#include "log.h"
+#include "scoped_map.h"
+
+#include "dex_file.h"
+#include "method_cfg.h"
+#include "register_types.h"
+
+
+// The register types inferred for code items assembled in memory, declared
+// by a minimal dex file holding the one method "I LT;->m()", an instance
+// method.
+
+static uint32_t failures = 0;
+
+static void Expect(bool cond, const char* what)
+{
+    if (!cond) {
+        LOG(ERROR) << "Failed: " << what;
+        ++failures;
+    }
+}
+
+static void Put16(byte* base, uint32_t off, uint16_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static void Put32(byte* base, uint32_t off, uint32_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static const DexFile* OpenTestDexFile()
+{
+    byte* base = reinterpret_cast<byte*>(mmap(nullptr, kPageSize, PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+        return nullptr;
+    memcpy(base, "dex\n035", 8);
+    Put32(base, 0x20, kPageSize);  // file_size_
+    Put32(base, 0x24, 0x70);       // header_size_
+    Put32(base, 0x28, 0x12345678);  // endian_tag_
+
+    // The strings "I", "LT;" and "m", then the types I and LT;, the proto
+    // ()I and the method LT;->m.
+    Put32(base, 0x38, 3);
+    Put32(base, 0x3C, 0x70);
+    Put32(base, 0x40, 2);
+    Put32(base, 0x44, 0x7C);
+    Put32(base, 0x48, 1);
+    Put32(base, 0x4C, 0x84);
+    Put32(base, 0x58, 1);
+    Put32(base, 0x5C, 0x90);
+    Put32(base, 0x70, 0xA0);
+    Put32(base, 0x74, 0xA3);
+    Put32(base, 0x78, 0xA8);
+    memcpy(base + 0xA0, "\x01I\0\x03LT;\0\x01m", 11);
+    Put32(base, 0x7C, 0);
+    Put32(base, 0x80, 1);
+    Put32(base, 0x84, 0);
+    Put32(base, 0x88, 0);
+    Put16(base, 0x90, 1);
+    Put16(base, 0x92, 0);
+    Put32(base, 0x94, 2);
+
+    ScopedMap mem_map(base, kPageSize, kPageSize);
+    return DexFile::OpenMemory(mem_map);
+}
+
+static bool IsReference(const RegisterTypes::Type& type, const char* descriptor)
+{
+    return type.kind_ == RegisterTypes::kReference && strcmp(type.descriptor_, descriptor) == 0;
+}
+
+// Two paths writing a different type to each register before they join:
+//
+//   0000: if-eqz v8, +12 (000c)
+//   0002: const/4 v0, #0
+//   0003: const/4 v1, #1
+//   0004: const-string v2, string@0
+//   0006: const/4 v3, #1
+//   0007: instance-of v4, v8, type@1
+//   0009: const-wide/16 v6, #0
+//   000b: goto +11 (0016)
+//   000c: const-class v0, type@1
+//   000e: instance-of v1, v8, type@1
+//   0010: const-class v2, type@1
+//   0012: int-to-float v3, v1
+//   0013: const-class v4, type@1
+//   0015: int-to-long v6, v1
+//   0016: return-void
+//
+// The entry line of the join holds the merged types, v5 being written on
+// neither path and v8 holding this.
+static void TestMergeAtJoin(const DexFile& dex_file)
+{
+    static const uint16_t kInsns[] = {
+        0x0838, 0x000C, 0x0012, 0x1112, 0x021A, 0x0000, 0x1312, 0x8420, 0x0001, 0x0616,
+        0x0000, 0x0B28, 0x001C, 0x0001, 0x8120, 0x0001, 0x021C, 0x0001, 0x1382, 0x041C,
+        0x0001, 0x1681, 0x000E,
+    };
+    alignas(4) byte buf[64] = {};
+    Put16(buf, 0, 9);   // registers_size_
+    Put16(buf, 2, 1);   // ins_size_
+    Put32(buf, 12, sizeof(kInsns) / sizeof(kInsns[0]));  // insns_size_in_code_units_
+    memcpy(buf + 16, kInsns, sizeof(kInsns));
+    const DexFile::CodeItem* code_item = reinterpret_cast<const DexFile::CodeItem*>(buf);
+
+    MethodCfg cfg;
+    RegisterTypes types;
+    if (!cfg.Build(code_item)) {
+        Expect(false, "the graph is built");
+        return;
+    }
+    if (!types.Build(dex_file, 0, 0, code_item, cfg)) {
+        Expect(false, "the types are inferred");
+        return;
+    }
+
+    const RegisterTypes::Type* line = types.EntryLine(cfg.BlockOf(0x16));
+    Expect(IsReference(line[0], "Ljava/lang/Class;"), "zero merges into a reference");
+    Expect(line[1].kind_ == RegisterTypes::kInteger, "a constant and a boolean merge into int");
+    Expect(IsReference(line[2], "Ljava/lang/Object;"),
+           "two distinct references merge into java.lang.Object");
+    Expect(line[3].kind_ == RegisterTypes::kFloat, "a constant merges into float");
+    Expect(line[4].kind_ == RegisterTypes::kConflict, "a boolean and a reference conflict");
+    Expect(line[5].kind_ == RegisterTypes::kUndefined, "an unwritten register stays undefined");
+    Expect(line[6].kind_ == RegisterTypes::kLongLo && line[7].kind_ == RegisterTypes::kLongHi,
+           "a wide constant merges into long");
+    Expect(IsReference(line[8], "LT;"), "this keeps the declaring class");
+    Expect(strcmp(RegisterTypes::Name(line[2]), "Ljava/lang/Object;") == 0 &&
+           strcmp(RegisterTypes::Name(line[6]), "J") == 0 &&
+           RegisterTypes::Name(line[7]) == nullptr,
+           "the names of the merged types");
+}
+
+int main()
+{
+    std::unique_ptr<const DexFile> dex_file(OpenTestDexFile());
+    if (dex_file.get() == nullptr)
+        return EXIT_FAILURE;
+    TestMergeAtJoin(*dex_file.get());
+    return (failures == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
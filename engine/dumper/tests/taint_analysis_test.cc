@@ -0,0 +1,179 @@
+#include "globals.h"
+#include "log.h"
+#include "scoped_map.h"
+#include "cmd_opt.h"
+#include "glob_matcher.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dump_filter.h"
+#include "taint_analysis.h"
+
+
+// The taint summaries computed over a minimal dex file holding the class LT;
+// with the static methods below, LT;->a and LT;->b calling each other, and
+// with the external methods "V LT;->snk(I)" and "I LT;->src()":
+//
+//   I LT;->a(I)
+//     0000: invoke-static {v0}, LT;->snk(I)V
+//     0003: invoke-static {v0}, LT;->b(I)I
+//     0006: return v0
+//
+//   I LT;->b(I)
+//     0000: invoke-static {v0}, LT;->a(I)I
+//     0003: move-result v0
+//     0004: return v0
+//
+//   V LT;->m()
+//     0000: invoke-static {}, LT;->src()I
+//     0003: move-result v0
+//     0004: invoke-static {v0}, LT;->b(I)I
+//     0007: return-void
+
+static uint32_t failures = 0;
+
+static void Expect(bool cond, const char* what)
+{
+    if (!cond) {
+        LOG(ERROR) << "Failed: " << what;
+        ++failures;
+    }
+}
+
+static void Put16(byte* base, uint32_t off, uint16_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+static void Put32(byte* base, uint32_t off, uint32_t value)
+{
+    memcpy(base + off, &value, sizeof(value));
+}
+
+// Lay out a code item of one register, taking the given number of ins.
+static void PutCodeItem(byte* base, uint32_t off, uint16_t ins_size, const uint16_t* insns,
+                        uint32_t size)
+{
+    Put16(base, off, 1);            // registers_size_
+    Put16(base, off + 2, ins_size);
+    Put16(base, off + 4, 1);        // outs_size_
+    Put32(base, off + 12, size);    // insns_size_in_code_units_
+    memcpy(base + off + 16, insns, size * sizeof(uint16_t));
+}
+
+static const DexFile* OpenTestDexFile()
+{
+    byte* base = reinterpret_cast<byte*>(mmap(nullptr, kPageSize, PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+        return nullptr;
+    memcpy(base, "dex\n035", 8);
+    Put32(base, 0x20, kPageSize);  // file_size_
+    Put32(base, 0x24, 0x70);       // header_size_
+    Put32(base, 0x28, 0x12345678);  // endian_tag_
+
+    // The strings, then the types I, LT; and V, the protos ()I, (I)I, ()V
+    // and (I)V, the methods a, b, m, snk and src, and the class LT;.
+    static const char* kStrings[] = {"I", "II", "LT;", "V", "VI", "a", "b", "m", "snk", "src"};
+    Put32(base, 0x38, 10);
+    Put32(base, 0x3C, 0x70);
+    Put32(base, 0x40, 3);
+    Put32(base, 0x44, 0x98);
+    Put32(base, 0x48, 4);
+    Put32(base, 0x4C, 0xA4);
+    Put32(base, 0x58, 5);
+    Put32(base, 0x5C, 0xD4);
+    Put32(base, 0x60, 1);
+    Put32(base, 0x64, 0x100);
+    uint32_t off = 0x130;
+    for (uint32_t i = 0 ; i < 10 ; ++i) {
+        uint32_t length = strlen(kStrings[i]);
+        Put32(base, 0x70 + 4 * i, off);
+        base[off] = length;
+        memcpy(base + off + 1, kStrings[i], length + 1);
+        off += length + 2;
+    }
+    Put32(base, 0x98, 0);
+    Put32(base, 0x9C, 2);
+    Put32(base, 0xA0, 3);
+    static const uint32_t kProtos[][3] = {{0, 0, 0}, {1, 0, 0x120}, {3, 2, 0}, {4, 2, 0x120}};
+    for (uint32_t i = 0 ; i < 4 ; ++i) {
+        Put32(base, 0xA4 + 12 * i, kProtos[i][0]);      // shorty_idx_
+        Put16(base, 0xA8 + 12 * i, kProtos[i][1]);      // return_type_idx_
+        Put32(base, 0xAC + 12 * i, kProtos[i][2]);      // parameters_off_
+    }
+    static const uint16_t kMethods[][2] = {{1, 5}, {1, 6}, {2, 7}, {3, 8}, {0, 9}};
+    for (uint32_t i = 0 ; i < 5 ; ++i) {
+        Put16(base, 0xD4 + 8 * i, 1);               // class_idx_
+        Put16(base, 0xD6 + 8 * i, kMethods[i][0]);  // proto_idx_
+        Put32(base, 0xD8 + 8 * i, kMethods[i][1]);  // name_idx_
+    }
+    Put32(base, 0x120, 1);
+    Put16(base, 0x124, 0);
+
+    Put16(base, 0x100, 1);      // class_idx_
+    Put32(base, 0x104, 0x1);    // access_flags_
+    Put16(base, 0x108, 0xFFFF);  // superclass_idx_
+    Put32(base, 0x110, 0xFFFFFFFF);  // source_file_idx_
+    Put32(base, 0x118, 0x180);  // class_data_off_
+
+    // Three direct methods, public static, whose code items are at 0x200,
+    // 0x240 and 0x280.
+    memcpy(base + 0x180, "\x00\x00\x03\x00\x00\x09\x80\x04\x01\x09\xC0\x04\x01\x09\x80\x05", 16);
+    static const uint16_t kA[] = {0x1071, 0x0003, 0x0000, 0x1071, 0x0001, 0x0000, 0x000F};
+    static const uint16_t kB[] = {0x1071, 0x0000, 0x0000, 0x000A, 0x000F};
+    static const uint16_t kM[] = {0x0071, 0x0004, 0x0000, 0x000A, 0x1071, 0x0001, 0x0000,
+                                  0x000E};
+    PutCodeItem(base, 0x200, 1, kA, sizeof(kA) / sizeof(kA[0]));
+    PutCodeItem(base, 0x240, 1, kB, sizeof(kB) / sizeof(kB[0]));
+    PutCodeItem(base, 0x280, 0, kM, sizeof(kM) / sizeof(kM[0]));
+
+    ScopedMap mem_map(base, kPageSize, kPageSize);
+    return DexFile::OpenMemory(mem_map);
+}
+
+// The summary of b depends on the one of a, which it calls back, so the
+// recursive component must be iterated until both are stable. The source
+// passed to b by m then reaches the sink through a.
+static void TestSummariesAcrossComponents(const DexFile& dex_file)
+{
+    DumperOption opt = DumperOption();
+    DumpFilter filter(opt);
+    std::vector<const DexFile*> dex_files(1, &dex_file);
+    GlobMatcher sources, sinks;
+    sources.Add("*->src*");
+    sinks.Add("*->snk*");
+    ThreadPool pool(2);
+    TaintAnalysis taint(dex_files, filter);
+    taint.Run(sources, sinks, &pool);
+
+    const CallGraph& graph = taint.Graph();
+    uint32_t a = graph.GlobalId(0, 0);
+    uint32_t b = graph.GlobalId(0, 1);
+    uint32_t m = graph.GlobalId(0, 2);
+    Expect(taint.NumComponents() == 4, "a and b form one component");
+    Expect(taint.NumLevels() == 3, "m is analyzed above a and b");
+
+    const TaintAnalysis::Summary& summary_a = taint.SummaryOf(a);
+    const TaintAnalysis::Summary& summary_b = taint.SummaryOf(b);
+    const TaintAnalysis::Summary& summary_m = taint.SummaryOf(m);
+    Expect(summary_a.returns_ == 1 && summary_a.sinks_ == 1, "the summary of a");
+    Expect(summary_b.returns_ == 1 && summary_b.sinks_ == 1,
+           "the summary of b takes the one of a");
+    Expect(summary_m.returns_ == 0 && summary_m.sinks_ == 0, "the summary of m");
+
+    const std::vector<TaintAnalysis::Flow>& flows = taint.FlowsOf(m);
+    Expect(flows.size() == 1 && flows[0].dex_pc_ == 4 && flows[0].callee_ == b,
+           "the source reaches the sink through b");
+    Expect(taint.FlowsOf(a).empty() && taint.FlowsOf(b).empty(),
+           "no source reaches a or b");
+}
+
+int main()
+{
+    std::unique_ptr<const DexFile> dex_file(OpenTestDexFile());
+    if (dex_file.get() == nullptr)
+        return EXIT_FAILURE;
+    TestSummariesAcrossComponents(*dex_file.get());
+    return (failures == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
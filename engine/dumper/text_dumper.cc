@@ -0,0 +1,130 @@
+#include "text_dumper.h"
+#include "cmd_opt.h"
+#include "misc.h"
+#include "stringprintf.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+
+
+TextDumper::TextDumper(const DexFile& dex_file, char opt_granu, const DumpFilter& filter)
+  : dex_file_(dex_file),
+    opt_granu_(opt_granu),
+    filter_(filter)
+{}
+
+bool TextDumper::Dump(OutputSink& sink, DumpIndex* index)
+{
+    std::string buf;
+    std::vector<MethodSpan> spans;
+    uint64_t offset = 0;
+    uint32_t num_class_def = dex_file_.NumClassDefs();
+    for (uint32_t class_def_idx = 0 ; class_def_idx < num_class_def ; ++class_def_idx) {
+        buf.clear();
+        spans.clear();
+        RenderClass(&buf, class_def_idx, (index)? &spans : nullptr);
+        if (!sink.Write(buf))
+            return false;
+        if (index)
+            IndexClass(index, class_def_idx, offset, buf, spans);
+        offset += buf.size();
+    }
+    return true;
+}
+
+void TextDumper::RenderClass(std::string* out, uint32_t class_def_idx,
+                             std::vector<MethodSpan>* spans) const
+{
+    if (!filter_.KeepClass(dex_file_, class_def_idx))
+        return;
+    StringAppendF(out, "%d: %s\n", class_def_idx,
+                  PrettyClass(class_def_idx, dex_file_).c_str());
+    if (opt_granu_ == kGranuCodeClass)
+        return;
+    const DexFile::ClassDef& class_def = dex_file_.GetClassDef(class_def_idx);
+    DumpClass(out, class_def, spans);
+    *out += '\n';
+}
+
+void TextDumper::IndexClass(DumpIndex* index, uint32_t class_def_idx, uint64_t offset,
+                            const std::string& text, const std::vector<MethodSpan>& spans)
+{
+    if (text.empty())  // filtered out
+        return;
+    index->AddClass(class_def_idx, offset, text.size());
+    for (const MethodSpan& span : spans)
+        index->AddMethod(span.dex_method_idx_, class_def_idx, offset + span.begin_,
+                         span.end_ - span.begin_);
+}
+
+void TextDumper::DumpClass(std::string* out, const DexFile::ClassDef& class_def,
+                           std::vector<MethodSpan>* spans) const
+{
+    const byte* class_data = dex_file_.GetClassData(class_def);
+    if (class_data == nullptr)  // empty class such as a marker interface?
+        return;
+
+    ClassDataItemIterator it(dex_file_, class_data);
+    SkipAllFields(it);
+    uint32_t class_method_idx = 0;
+    while (it.HasNext()) {
+        if (filter_.KeepMethod(dex_file_, it.GetMemberIndex())) {
+            size_t begin = out->size();
+            if (opt_granu_ == kGranuCodeSummary)
+                DumpSummary(out, class_method_idx, it);
+            else
+                DumpMethod(out, dex_file_, class_method_idx, it.GetMemberIndex());
+            if (opt_granu_ == kGranuCodeInstruction) {
+                const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+                DumpCode(out, dex_file_, code_item);
+                *out += '\n';
+            }
+            if (spans) {
+                MethodSpan span = {it.GetMemberIndex(), begin, out->size()};
+                spans->push_back(span);
+            }
+        }
+        it.Next();
+        ++class_method_idx;
+    }
+}
+
+void TextDumper::DumpMethod(std::string* out, const DexFile& dex_file,
+                            uint32_t class_method_idx, uint32_t dex_method_idx)
+{
+    StringAppendF(out, "\t%d: %s (dex_method_idx=%d)\n", class_method_idx,
+                  PrettyMethod(dex_method_idx, dex_file, true).c_str(),
+                  dex_method_idx);
+}
+
+void TextDumper::DumpSummary(std::string* out, uint32_t class_method_idx,
+                             const ClassDataItemIterator& it) const
+{
+    uint32_t access_flags = it.GetRawMemberAccessFlags();
+    const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+    const char* kind = (code_item != nullptr)? "code" :
+                       (access_flags & kAccNative)? "native" :
+                       (access_flags & kAccAbstract)? "abstract" : "none";
+    StringAppendF(out, "\t%u\t%u\t0x%04x\t%s", class_method_idx, it.GetMemberIndex(),
+                  access_flags, kind);
+    if (code_item != nullptr)
+        StringAppendF(out, "\t%u\t%u\t%u\t%u\t%u", code_item->registers_size_,
+                      code_item->ins_size_, code_item->outs_size_, code_item->tries_size_,
+                      code_item->insns_size_in_code_units_);
+    else
+        *out += "\t0\t0\t0\t0\t0";
+    StringAppendF(out, "\t%s\n", PrettyMethod(it.GetMemberIndex(), dex_file_, true).c_str());
+}
+
+void TextDumper::DumpCode(std::string* out, const DexFile& dex_file,
+                          const DexFile::CodeItem* code_item)
+{
+    if (!code_item)
+        return;
+    size_t inst_off = 0;
+    while (inst_off < code_item->insns_size_in_code_units_) {
+        const Instruction* instruction = Instruction::At(&code_item->insns_[inst_off]);
+        StringAppendF(out, "\t\t0x%04zx: %s\n", inst_off,
+                      instruction->DumpString(&dex_file).c_str());
+        inst_off += instruction->SizeInCodeUnits();
+    }
+}
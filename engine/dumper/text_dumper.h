@@ -0,0 +1,74 @@
+#ifndef _DUMPER_TEXT_DUMPER_H_
+#define _DUMPER_TEXT_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "dump_filter.h"
+#include "dump_index.h"
+
+
+// Render the kept classes as text, each class followed by its kept methods
+// and, at the instruction granularity, by their decoded code items:
+//
+//   12: Lcom/a/B;
+//   	0: void com.a.B.<init>() (dex_method_idx=52)
+//   		0x0000: invoke-direct {v0}, java.lang.Object.<init>():void // method@3
+//
+// A class is rendered on its own, so that the output modes writing the
+// classes from the workers share the rendering and only differ in how they
+// place the text.
+class TextDumper
+{
+  public:
+    // The text of a method within the text of its class.
+    struct MethodSpan
+    {
+        uint32_t dex_method_idx_;
+        size_t begin_;
+        size_t end_;
+    };
+
+    // The filter is not owned and must outlive the dumper.
+    TextDumper(const DexFile& dex_file, char opt_granu, const DumpFilter& filter);
+
+    // Write the classes in class_def order, and record them in the index if
+    // one is given.
+    bool Dump(OutputSink& sink, DumpIndex* index) WARN_UNUSED;
+
+    // Append the text of a class, nothing if it is filtered out, and the
+    // spans of its methods if spans is not null.
+    void RenderClass(std::string* out, uint32_t class_def_idx,
+                     std::vector<MethodSpan>* spans) const;
+
+    // Record the class rendered at the given offset of the dump and its
+    // methods.
+    static void IndexClass(DumpIndex* index, uint32_t class_def_idx, uint64_t offset,
+                           const std::string& text, const std::vector<MethodSpan>& spans);
+
+    static void DumpMethod(std::string* out, const DexFile& dex_file,
+                           uint32_t class_method_idx, uint32_t dex_method_idx);
+    static void DumpCode(std::string* out, const DexFile& dex_file,
+                         const DexFile::CodeItem* code_item);
+
+  private:
+    void DumpClass(std::string* out, const DexFile::ClassDef& class_def,
+                   std::vector<MethodSpan>* spans) const;
+
+    // Dump the row of a method from its code_item header, leaving the
+    // instructions untouched.
+    void DumpSummary(std::string* out, uint32_t class_method_idx,
+                     const ClassDataItemIterator& it) const;
+
+    const DexFile& dex_file_;
+    const char opt_granu_;
+    const DumpFilter& filter_;
+
+    DISALLOW_COPY_AND_ASSIGN(TextDumper);
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "xref_dumper.h"
+#include "glob_matcher.h"
+#include "misc.h"
+#include "stringprintf.h"
+#include "dex_file-inl.h"
+
+
+XrefDumper::XrefDumper(const DexFile& dex_file, const DumpFilter& filter)
+  : dex_file_(dex_file),
+    filter_(filter)
+{}
+
+bool XrefDumper::Dump(OutputSink& sink, const std::vector<const char*>& globs,
+                      ThreadPool* pool)
+{
+    GlobMatcher targets;
+    for (const char* glob : globs)
+        targets.Add(glob);
+    XrefIndex xrefs(dex_file_);
+    xrefs.Build(filter_, pool);
+
+    std::string buf;
+    std::string name;
+    uint32_t num_method_ids = dex_file_.NumMethodIds();
+    for (uint32_t method_idx = 0 ; method_idx < num_method_ids ; ++method_idx) {
+        Range<XrefIndex::Ref> refs = xrefs.MethodRefs(method_idx);
+        if (refs.size() == 0)
+            continue;
+        const DexFile::MethodId& method_id = dex_file_.GetMethodId(method_idx);
+        name = dex_file_.GetMethodDeclaringClassDescriptor(method_id);
+        name += "->";
+        name += dex_file_.GetMethodName(method_id);
+        if (!targets.Match(name.c_str()))
+            continue;
+        StringAppendF(&buf, "method@%u: %s\n", method_idx,
+                      PrettyMethod(method_idx, dex_file_, true).c_str());
+        DumpTarget(&buf, refs);
+        if (!sink.Write(buf))
+            return false;
+        buf.clear();
+    }
+
+    uint32_t num_field_ids = dex_file_.NumFieldIds();
+    for (uint32_t field_idx = 0 ; field_idx < num_field_ids ; ++field_idx) {
+        Range<XrefIndex::Ref> refs = xrefs.FieldRefs(field_idx);
+        if (refs.size() == 0)
+            continue;
+        const DexFile::FieldId& field_id = dex_file_.GetFieldId(field_idx);
+        name = dex_file_.GetFieldDeclaringClassDescriptor(field_id);
+        name += "->";
+        name += dex_file_.GetFieldName(field_id);
+        if (!targets.Match(name.c_str()))
+            continue;
+        StringAppendF(&buf, "field@%u: %s\n", field_idx,
+                      PrettyField(field_idx, dex_file_, true).c_str());
+        DumpTarget(&buf, refs);
+        if (!sink.Write(buf))
+            return false;
+        buf.clear();
+    }
+
+    uint32_t num_type_ids = dex_file_.NumTypeIds();
+    for (uint32_t type_idx = 0 ; type_idx < num_type_ids ; ++type_idx) {
+        Range<XrefIndex::Ref> refs = xrefs.TypeRefs(type_idx);
+        if (refs.size() == 0)
+            continue;
+        name = dex_file_.GetTypeDescriptor(dex_file_.GetTypeId(type_idx));
+        if (!targets.Match(name.c_str()))
+            continue;
+        StringAppendF(&buf, "type@%u: %s\n", type_idx, PrettyType(type_idx, dex_file_).c_str());
+        DumpTarget(&buf, refs);
+        if (!sink.Write(buf))
+            return false;
+        buf.clear();
+    }
+    return true;
+}
+
+void XrefDumper::DumpTarget(std::string* out, Range<XrefIndex::Ref> refs) const
+{
+    for (const XrefIndex::Ref& ref : refs) {
+        StringAppendF(out, "\t%s\t0x%04x\t%s (dex_method_idx=%u)\n",
+                      XrefIndex::KindName(ref.kind_), ref.dex_pc_,
+                      PrettyMethod(ref.dex_method_idx_, dex_file_, true).c_str(),
+                      ref.dex_method_idx_);
+    }
+    *out += '\n';
+}
@@ -0,0 +1,48 @@
+#ifndef _DUMPER_XREF_DUMPER_H_
+#define _DUMPER_XREF_DUMPER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+#include "range.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dump_filter.h"
+#include "xref_index.h"
+
+
+// List the references to the targets matching the globs, the methods first,
+// then the fields and the types, each in dex index order. A target is
+// followed by its references, one kind, dex_pc and referring method per
+// line, in class_def and dex_pc order:
+//
+//   method@3: int com.a.B.foo(int, long)
+//   	invoke	0x0008	void com.a.C.run() (dex_method_idx=86)
+//
+//   field@7: I com.a.B.count
+//   	iget	0x0002	int com.a.B.size() (dex_method_idx=12)
+//
+// The globs are matched against 'Lcom/a/B;->name' for the methods and fields
+// and the raw descriptor for the types, and only the referred targets are
+// named and matched. The filter selects the referring code, not the targets.
+class XrefDumper
+{
+  public:
+    // The filter is not owned and must outlive the dumper.
+    XrefDumper(const DexFile& dex_file, const DumpFilter& filter);
+
+    bool Dump(OutputSink& sink, const std::vector<const char*>& globs,
+              ThreadPool* pool) WARN_UNUSED;
+
+  private:
+    void DumpTarget(std::string* out, Range<XrefIndex::Ref> refs) const;
+
+    const DexFile& dex_file_;
+    const DumpFilter& filter_;
+
+    DISALLOW_COPY_AND_ASSIGN(XrefDumper);
+};
+
+#endif
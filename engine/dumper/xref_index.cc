@@ -0,0 +1,122 @@
+#include <algorithm>
+
+#include "xref_index.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+#include "misc.h"
+
+
+XrefIndex::XrefIndex(const DexFile& dex_file)
+  : dex_file_(dex_file)
+{
+    num_targets_[kMethodTargets] = dex_file.NumMethodIds();
+    num_targets_[kFieldTargets] = dex_file.NumFieldIds();
+    num_targets_[kTypeTargets] = dex_file.NumTypeIds();
+}
+
+void XrefIndex::Build(const DumpFilter& filter, ThreadPool* pool)
+{
+    uint32_t num_class_def = dex_file_.NumClassDefs();
+    uint32_t num_chunks = (num_class_def + kClassChunkSize - 1) / kClassChunkSize;
+    std::vector<ChunkEdges> chunks(num_chunks);
+    pool->ParallelForChunks(0, num_class_def, kClassChunkSize,
+                            [&](uint32_t, uint32_t chunk, uint32_t begin, uint32_t end) {
+        for (uint32_t class_def_idx = begin ; class_def_idx < end ; ++class_def_idx)
+            ScanClass(filter, class_def_idx, &chunks[chunk]);
+    });
+
+    // Bucket the edges of each target space by target, keeping the chunk order.
+    std::vector<Edges> lists(num_chunks);
+    for (uint32_t space = 0 ; space < kNumTargetSpaces ; ++space) {
+        for (uint32_t chunk = 0 ; chunk < num_chunks ; ++chunk)
+            lists[chunk] = std::move(chunks[chunk].edges_[space]);
+        Table& table = tables_[space];
+        Bucket(lists.data(), num_chunks, num_targets_[space], &table.offsets_, &table.refs_);
+    }
+}
+
+const char* XrefIndex::KindName(Kind kind)
+{
+    switch (kind) {
+      case kInvoke:
+        return "invoke";
+      case kInstanceRead:
+        return "iget";
+      case kInstanceWrite:
+        return "iput";
+      case kStaticRead:
+        return "sget";
+      case kStaticWrite:
+        return "sput";
+      case kConstClass:
+        return "const-class";
+      case kNewInstance:
+        return "new-instance";
+    }
+    return "unknown";
+}
+
+void XrefIndex::ScanClass(const DumpFilter& filter, uint32_t class_def_idx,
+                          ChunkEdges* chunk) const
+{
+    if (!filter.KeepClass(dex_file_, class_def_idx))
+        return;
+    const byte* class_data = dex_file_.GetClassData(dex_file_.GetClassDef(class_def_idx));
+    if (class_data == nullptr)
+        return;
+
+    ClassDataItemIterator it(dex_file_, class_data);
+    SkipAllFields(it);
+    for ( ; it.HasNext() ; it.Next()) {
+        const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+        if (code_item != nullptr && filter.KeepMethod(dex_file_, it.GetMemberIndex()))
+            ScanCode(it.GetMemberIndex(), code_item, chunk);
+    }
+}
+
+void XrefIndex::ScanCode(uint32_t dex_method_idx, const DexFile::CodeItem* code_item,
+                         ChunkEdges* chunk) const
+{
+    uint32_t dex_pc = 0;
+    while (dex_pc < code_item->insns_size_in_code_units_) {
+        const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+        uint32_t inst_pc = dex_pc;
+        dex_pc += inst->SizeInCodeUnits();
+
+        // The quickened opcodes refer to runtime offsets rather than ids.
+        Instruction::Code opcode = inst->Opcode();
+        if (inst->GetVerifyIsRuntimeOnly())
+            continue;
+        TargetSpace space;
+        Kind kind;
+        switch (Instruction::IndexTypeOf(opcode)) {
+          case Instruction::kMethodRef:
+            space = kMethodTargets;
+            kind = kInvoke;
+            break;
+          case Instruction::kFieldRef: {
+            int flags = Instruction::FlagsOf(opcode);
+            bool is_static = (flags & Instruction::kRegBFieldOrConstant) != 0;
+            bool is_read = (flags & Instruction::kLoad) != 0;
+            space = kFieldTargets;
+            kind = (is_static)? ((is_read)? kStaticRead : kStaticWrite) :
+                                ((is_read)? kInstanceRead : kInstanceWrite);
+            break;
+          }
+          case Instruction::kTypeRef:
+            if (opcode != Instruction::CONST_CLASS && opcode != Instruction::NEW_INSTANCE)
+                continue;
+            space = kTypeTargets;
+            kind = (opcode == Instruction::CONST_CLASS)? kConstClass : kNewInstance;
+            break;
+          default:
+            continue;
+        }
+        // An index out of the range of its table refers to no target.
+        uint32_t target = inst->GetIndexOperand();
+        if (target >= num_targets_[space])
+            continue;
+        Ref ref = {dex_method_idx, inst_pc, kind};
+        chunk->edges_[space].push_back(std::make_pair(target, ref));
+    }
+}
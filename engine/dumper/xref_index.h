@@ -0,0 +1,112 @@
+#ifndef _DUMPER_XREF_INDEX_H_
+#define _DUMPER_XREF_INDEX_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "range.h"
+#include "thread_pool.h"
+
+#include "dex_file.h"
+#include "dex_instruction.h"
+#include "dump_filter.h"
+
+
+// The cross references from the kept code items to the methods they invoke,
+// the fields they read or write, and the types they load by const-class or
+// instantiate by new-instance. The index is built by one decoding pass, with
+// the classes scanned in parallel chunks. The references of each kind of
+// target are then stored as a compressed sparse row keyed by the dex index of
+// the target: the references to target t are refs_[offsets_[t], offsets_[t+1])
+// in class_def and dex_pc order, so the referrers of a target are listed in
+// O(degree).
+class XrefIndex
+{
+  public:
+    enum Kind
+    {
+        kInvoke = 0,
+        kInstanceRead,
+        kInstanceWrite,
+        kStaticRead,
+        kStaticWrite,
+        kConstClass,
+        kNewInstance,
+    };
+
+    // A reference from an instruction of a method.
+    struct Ref
+    {
+        uint32_t dex_method_idx_;
+        uint32_t dex_pc_;
+        Kind kind_;
+    };
+
+    explicit XrefIndex(const DexFile& dex_file);
+
+    // Scan the code items of the classes and methods kept by the filter.
+    void Build(const DumpFilter& filter, ThreadPool* pool);
+
+    // The references to a target.
+    Range<Ref> MethodRefs(uint32_t method_idx) const
+    {
+        return tables_[kMethodTargets].Refs(method_idx);
+    }
+
+    Range<Ref> FieldRefs(uint32_t field_idx) const
+    {
+        return tables_[kFieldTargets].Refs(field_idx);
+    }
+
+    Range<Ref> TypeRefs(uint32_t type_idx) const
+    {
+        return tables_[kTypeTargets].Refs(type_idx);
+    }
+
+    static const char* KindName(Kind kind);
+
+  private:
+    enum TargetSpace
+    {
+        kMethodTargets = 0,
+        kFieldTargets,
+        kTypeTargets,
+        kNumTargetSpaces,
+    };
+
+    struct Table
+    {
+        std::vector<uint32_t> offsets_;  // of size num_targets + 1
+        std::vector<Ref> refs_;
+
+        Range<Ref> Refs(uint32_t idx) const
+        {
+            if (idx + 1 >= offsets_.size())
+                return Range<Ref>(nullptr, nullptr);
+            const Ref* base = refs_.data();
+            return Range<Ref>(base + offsets_[idx], base + offsets_[idx + 1]);
+        }
+    };
+
+    // The references found by the scan, paired with their targets before they
+    // are bucketed by target.
+    typedef std::vector<std::pair<uint32_t, Ref>> Edges;
+
+    // The edges found in a chunk of classes, per target space.
+    struct ChunkEdges
+    {
+        Edges edges_[kNumTargetSpaces];
+    };
+
+    void ScanClass(const DumpFilter& filter, uint32_t class_def_idx, ChunkEdges* chunk) const;
+    void ScanCode(uint32_t dex_method_idx, const DexFile::CodeItem* code_item,
+                  ChunkEdges* chunk) const;
+
+    const DexFile& dex_file_;
+    uint32_t num_targets_[kNumTargetSpaces];
+    Table tables_[kNumTargetSpaces];
+
+    DISALLOW_COPY_AND_ASSIGN(XrefIndex);
+};
+
+#endif
@@ -0,0 +1,431 @@
+#include "arrow_writer.h"
+#include "log.h"
+
+
+// The values of the enumerations in the Arrow format specification.
+static constexpr uint16_t kMetadataVersionV5 = 4;
+static constexpr uint16_t kEndiannessLittle = 0;
+static constexpr uint8_t kHeaderSchema = 1;
+static constexpr uint8_t kHeaderDictionaryBatch = 2;
+static constexpr uint8_t kHeaderRecordBatch = 3;
+static constexpr uint8_t kTypeInt = 2;
+static constexpr uint8_t kTypeUtf8 = 5;
+static constexpr uint8_t kTypeList = 12;
+
+static constexpr uint32_t kContinuationMarker = 0xFFFFFFFF;
+
+
+static inline size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+
+// A minimal FlatBuffers serializer for the message headers. Unlike the
+// reference builder, it lays the objects out front to back: a table is
+// written with placeholders for its offset fields, which are patched once
+// the referred objects are appended behind it. That keeps every offset
+// pointing forward, as the format requires.
+class ArrowStreamWriter::FlatBufferBuilder
+{
+  public:
+    FlatBufferBuilder()
+      : buf_(sizeof(uint32_t), '\0')  // the offset to the root table
+    {}
+
+    void StartTable()
+    {
+        fields_.clear();
+    }
+
+    void AddScalar(uint16_t id, uint64_t value, uint32_t size)
+    {
+        PendingField field = {id, size, value, 0};
+        fields_.push_back(field);
+    }
+
+    // Add an offset field to be patched by SetOffset().
+    void AddOffset(uint16_t id)
+    {
+        AddScalar(id, 0, sizeof(uint32_t));
+    }
+
+    // Lay out the table and its vtable. Returns the position of the table.
+    size_t EndTable();
+
+    // Returns the position of the given field of the last ended table.
+    size_t FieldPos(uint16_t id) const
+    {
+        for (const PendingField& field : fields_) {
+            if (field.id_ == id)
+                return field.pos_;
+        }
+        LOG(FATAL) << "No such field in the table.";
+        return 0;
+    }
+
+    // Append a vector of offsets. Returns the position of the vector, and
+    // the i-th slot is at VectorSlot(position, i).
+    size_t AddOffsetVector(uint32_t count)
+    {
+        Align(sizeof(uint32_t));
+        size_t pos = buf_.size();
+        buf_.resize(pos + sizeof(uint32_t) * (count + 1), '\0');
+        Put(pos, count, sizeof(uint32_t));
+        return pos;
+    }
+
+    static size_t VectorSlot(size_t vector, uint32_t idx)
+    {
+        return vector + sizeof(uint32_t) * (idx + 1);
+    }
+
+    // Append a vector of 8 byte aligned structs. Returns its position.
+    size_t AddStructVector(const void* data, uint32_t count, uint32_t size)
+    {
+        // The elements follow the 4 byte length.
+        while (buf_.size() % 8 != 4)
+            buf_ += '\0';
+        size_t pos = buf_.size();
+        buf_.resize(pos + sizeof(uint32_t));
+        Put(pos, count, sizeof(uint32_t));
+        buf_.append(reinterpret_cast<const char*>(data), count * size);
+        return pos;
+    }
+
+    size_t AddString(const char* str)
+    {
+        Align(sizeof(uint32_t));
+        size_t pos = buf_.size();
+        uint32_t len = strlen(str);
+        buf_.resize(pos + sizeof(uint32_t));
+        Put(pos, len, sizeof(uint32_t));
+        buf_.append(str, len + 1);
+        return pos;
+    }
+
+    void SetOffset(size_t slot, size_t target)
+    {
+        CHECK_GT(target, slot);
+        Put(slot, target - slot, sizeof(uint32_t));
+    }
+
+    // The offset to the root table is the first slot of the buffer.
+    void SetRoot(size_t root)
+    {
+        SetOffset(0, root);
+    }
+
+    // Pad the buffer to 8 bytes and return it.
+    const std::string& Finish()
+    {
+        Align(8);
+        return buf_;
+    }
+
+  private:
+    struct PendingField
+    {
+        uint16_t id_;
+        uint32_t size_;
+        uint64_t value_;
+        size_t pos_;
+    };
+
+    void Align(size_t alignment)
+    {
+        buf_.resize(AlignUp(buf_.size(), alignment), '\0');
+    }
+
+    void Put(size_t pos, uint64_t value, uint32_t size)
+    {
+        memcpy(&buf_[pos], &value, size);
+    }
+
+    std::vector<PendingField> fields_;
+    std::string buf_;
+
+    DISALLOW_COPY_AND_ASSIGN(FlatBufferBuilder);
+};
+
+size_t ArrowStreamWriter::FlatBufferBuilder::EndTable()
+{
+    uint16_t num_slots = 0;
+    for (const PendingField& field : fields_)
+        num_slots = std::max<uint16_t>(num_slots, field.id_ + 1);
+
+    // The vtable precedes the table, and the table starts with the signed
+    // distance back to it.
+    Align(sizeof(uint16_t));
+    size_t vtable_pos = buf_.size();
+    size_t vtable_size = sizeof(uint16_t) * (2 + num_slots);
+    size_t table_pos = AlignUp(vtable_pos + vtable_size, sizeof(uint32_t));
+
+    // Place the larger fields first, each aligned to its own size.
+    std::stable_sort(fields_.begin(), fields_.end(),
+                     [](const PendingField& lhs, const PendingField& rhs)
+                     { return lhs.size_ > rhs.size_; });
+    size_t end = table_pos + sizeof(int32_t);
+    for (PendingField& field : fields_) {
+        field.pos_ = AlignUp(end, field.size_);
+        end = field.pos_ + field.size_;
+    }
+
+    buf_.resize(end, '\0');
+    Put(vtable_pos, vtable_size, sizeof(uint16_t));
+    Put(vtable_pos + sizeof(uint16_t), end - table_pos, sizeof(uint16_t));
+    for (const PendingField& field : fields_) {
+        Put(vtable_pos + sizeof(uint16_t) * (2 + field.id_), field.pos_ - table_pos,
+            sizeof(uint16_t));
+        Put(field.pos_, field.value_, field.size_);
+    }
+    Put(table_pos, table_pos - vtable_pos, sizeof(int32_t));
+    return table_pos;
+}
+
+
+ArrowStreamWriter::Column::Column(uint32_t byte_width, bool is_list)
+  : byte_width_(byte_width),
+    is_list_(is_list),
+    length_(0),
+    null_count_(0),
+    offsets_((is_list)? sizeof(int32_t) : 0, '\0')
+{}
+
+void ArrowStreamWriter::Column::AppendNull()
+{
+    SetValid(false);
+    // A null list is empty.
+    if (is_list_)
+        EndList();
+    else
+        values_.append(byte_width_, '\0');
+}
+
+void ArrowStreamWriter::Column::Clear()
+{
+    length_ = 0;
+    null_count_ = 0;
+    values_.clear();
+    validity_.clear();
+    offsets_.assign((is_list_)? sizeof(int32_t) : 0, '\0');
+}
+
+void ArrowStreamWriter::Column::SetValid(bool valid)
+{
+    if (length_ % 8 == 0)
+        validity_ += '\0';
+    if (valid)
+        validity_.back() |= 1 << (length_ % 8);
+    else
+        ++null_count_;
+    ++length_;
+}
+
+void ArrowStreamWriter::Column::EndList()
+{
+    int32_t offset = values_.size() / byte_width_;
+    offsets_.append(reinterpret_cast<const char*>(&offset), sizeof(offset));
+}
+
+
+ArrowStreamWriter::ArrowStreamWriter(OutputSink* sink)
+  : sink_(sink)
+{}
+
+bool ArrowStreamWriter::WriteSchema(const std::vector<Field>& fields)
+{
+    FlatBufferBuilder fbb;
+    size_t header_slot = AddMessage(&fbb, kHeaderSchema, std::vector<BodyBuffer>());
+
+    fbb.StartTable();
+    fbb.AddScalar(0, kEndiannessLittle, sizeof(uint16_t));
+    fbb.AddOffset(1);
+    fbb.SetOffset(header_slot, fbb.EndTable());
+    size_t fields_slot = fbb.FieldPos(1);
+
+    size_t vector = fbb.AddOffsetVector(fields.size());
+    fbb.SetOffset(fields_slot, vector);
+    for (uint32_t i = 0 ; i < fields.size() ; ++i)
+        AddField(&fbb, FlatBufferBuilder::VectorSlot(vector, i), fields[i]);
+    return WriteMessage(&fbb, std::vector<BodyBuffer>());
+}
+
+bool ArrowStreamWriter::WriteDictionary(int64_t id, const std::vector<std::string>& strings,
+                                        size_t begin, size_t end, bool is_delta)
+{
+    std::vector<int32_t> offsets;
+    offsets.reserve(end - begin + 1);
+    std::string data;
+    offsets.push_back(0);
+    for (size_t i = begin ; i < end ; ++i) {
+        data += strings[i];
+        offsets.push_back(data.size());
+    }
+
+    std::vector<BodyBuffer> buffers;
+    buffers.push_back({nullptr, 0});
+    buffers.push_back({reinterpret_cast<const char*>(offsets.data()),
+                       offsets.size() * sizeof(int32_t)});
+    buffers.push_back({data.data(), data.size()});
+    std::vector<FieldNode> nodes(1, {end - begin, 0});
+
+    FlatBufferBuilder fbb;
+    size_t header_slot = AddMessage(&fbb, kHeaderDictionaryBatch, buffers);
+    fbb.StartTable();
+    fbb.AddScalar(0, id, sizeof(int64_t));
+    fbb.AddOffset(1);
+    fbb.AddScalar(2, is_delta, sizeof(uint8_t));
+    fbb.SetOffset(header_slot, fbb.EndTable());
+    size_t data_slot = fbb.FieldPos(1);
+    fbb.SetOffset(data_slot, AddRecordBatch(&fbb, end - begin, nodes, buffers));
+    return WriteMessage(&fbb, buffers);
+}
+
+bool ArrowStreamWriter::WriteRecordBatch(const std::vector<Column*>& columns)
+{
+    uint64_t length = (columns.empty())? 0 : columns[0]->Length();
+    std::vector<FieldNode> nodes;
+    std::vector<BodyBuffer> buffers;
+    for (const Column* column : columns) {
+        CHECK_EQ(column->Length(), length);
+        nodes.push_back({column->length_, column->null_count_});
+        // The validity bitmap may be omitted when there is no null.
+        if (column->null_count_ > 0)
+            buffers.push_back({column->validity_.data(), column->validity_.size()});
+        else
+            buffers.push_back({nullptr, 0});
+        // The items of the lists follow as a child column without null.
+        if (column->is_list_) {
+            buffers.push_back({column->offsets_.data(), column->offsets_.size()});
+            nodes.push_back({column->values_.size() / column->byte_width_, 0});
+            buffers.push_back({nullptr, 0});
+        }
+        buffers.push_back({column->values_.data(), column->values_.size()});
+    }
+
+    FlatBufferBuilder fbb;
+    size_t header_slot = AddMessage(&fbb, kHeaderRecordBatch, buffers);
+    fbb.SetOffset(header_slot, AddRecordBatch(&fbb, length, nodes, buffers));
+    return WriteMessage(&fbb, buffers);
+}
+
+bool ArrowStreamWriter::WriteEnd()
+{
+    uint32_t marker[2] = {kContinuationMarker, 0};
+    return sink_->Write(reinterpret_cast<const char*>(marker), sizeof(marker));
+}
+
+size_t ArrowStreamWriter::AddMessage(FlatBufferBuilder* fbb, uint8_t header_type,
+                                     const std::vector<BodyBuffer>& buffers)
+{
+    uint64_t body_length = 0;
+    for (const BodyBuffer& buffer : buffers)
+        body_length += AlignUp(buffer.size_, 8);
+
+    fbb->StartTable();
+    fbb->AddScalar(0, kMetadataVersionV5, sizeof(uint16_t));
+    fbb->AddScalar(1, header_type, sizeof(uint8_t));
+    fbb->AddOffset(2);
+    fbb->AddScalar(3, body_length, sizeof(int64_t));
+    size_t message = fbb->EndTable();
+    size_t header_slot = fbb->FieldPos(2);
+    fbb->SetRoot(message);
+    return header_slot;
+}
+
+void ArrowStreamWriter::AddField(FlatBufferBuilder* fbb, size_t slot, const Field& field)
+{
+    bool encoded = field.dictionary_id_ != kNoDictionary;
+    CHECK(!encoded || !field.is_list_);
+    uint8_t type = (encoded)? kTypeUtf8 : (field.is_list_)? kTypeList : kTypeInt;
+    fbb->StartTable();
+    fbb->AddOffset(0);
+    fbb->AddScalar(1, field.nullable_, sizeof(uint8_t));
+    fbb->AddScalar(2, type, sizeof(uint8_t));
+    fbb->AddOffset(3);
+    if (encoded)
+        fbb->AddOffset(4);
+    fbb->AddOffset(5);
+    fbb->SetOffset(slot, fbb->EndTable());
+    size_t name_slot = fbb->FieldPos(0);
+    size_t type_slot = fbb->FieldPos(3);
+    size_t dictionary_slot = (encoded)? fbb->FieldPos(4) : 0;
+    size_t children_slot = fbb->FieldPos(5);
+
+    fbb->SetOffset(name_slot, fbb->AddString(field.name_));
+    // A list has an empty type and one child field for its items.
+    if (field.is_list_) {
+        fbb->StartTable();
+        fbb->SetOffset(type_slot, fbb->EndTable());
+        size_t children = fbb->AddOffsetVector(1);
+        fbb->SetOffset(children_slot, children);
+        Field item = {"item", field.bit_width_, field.is_signed_, false, kNoDictionary, false};
+        AddField(fbb, FlatBufferBuilder::VectorSlot(children, 0), item);
+        return;
+    }
+
+    // An encoded field has the type of the dictionary values, and the type
+    // of its indices is given by the encoding.
+    fbb->StartTable();
+    if (encoded) {
+        fbb->SetOffset(type_slot, fbb->EndTable());
+        fbb->StartTable();
+        fbb->AddScalar(0, field.dictionary_id_, sizeof(int64_t));
+        fbb->AddOffset(1);
+        fbb->AddScalar(2, false, sizeof(uint8_t));
+        fbb->SetOffset(dictionary_slot, fbb->EndTable());
+        type_slot = fbb->FieldPos(1);
+        fbb->StartTable();
+    }
+    fbb->AddScalar(0, field.bit_width_, sizeof(int32_t));
+    fbb->AddScalar(1, field.is_signed_, sizeof(uint8_t));
+    fbb->SetOffset(type_slot, fbb->EndTable());
+    fbb->SetOffset(children_slot, fbb->AddOffsetVector(0));
+}
+
+size_t ArrowStreamWriter::AddRecordBatch(FlatBufferBuilder* fbb, uint64_t length,
+                                         const std::vector<FieldNode>& nodes,
+                                         const std::vector<BodyBuffer>& buffers)
+{
+    // The buffers are located relative to the start of the body.
+    std::vector<uint64_t> locations;
+    uint64_t offset = 0;
+    for (const BodyBuffer& buffer : buffers) {
+        locations.push_back(offset);
+        locations.push_back(buffer.size_);
+        offset += AlignUp(buffer.size_, 8);
+    }
+
+    fbb->StartTable();
+    fbb->AddScalar(0, length, sizeof(int64_t));
+    fbb->AddOffset(1);
+    fbb->AddOffset(2);
+    size_t batch = fbb->EndTable();
+    size_t nodes_slot = fbb->FieldPos(1);
+    size_t buffers_slot = fbb->FieldPos(2);
+    fbb->SetOffset(nodes_slot, fbb->AddStructVector(nodes.data(), nodes.size(),
+                                                    sizeof(FieldNode)));
+    fbb->SetOffset(buffers_slot, fbb->AddStructVector(locations.data(), buffers.size(),
+                                                      2 * sizeof(uint64_t)));
+    return batch;
+}
+
+bool ArrowStreamWriter::WriteMessage(FlatBufferBuilder* fbb,
+                                     const std::vector<BodyBuffer>& buffers)
+{
+    static const char kPadding[8] = { 0 };
+    const std::string& metadata = fbb->Finish();
+    uint32_t prefix[2] = {kContinuationMarker, static_cast<uint32_t>(metadata.size())};
+    if (!sink_->Write(reinterpret_cast<const char*>(prefix), sizeof(prefix)) ||
+        !sink_->Write(metadata))
+        return false;
+    for (const BodyBuffer& buffer : buffers) {
+        if (buffer.size_ == 0)
+            continue;
+        if (!sink_->Write(buffer.data_, buffer.size_) ||
+            !sink_->Write(kPadding, AlignUp(buffer.size_, 8) - buffer.size_))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,139 @@
+#ifndef _UTIL_ARROW_WRITER_H_
+#define _UTIL_ARROW_WRITER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+
+
+// A writer of the Apache Arrow IPC streaming format, limited to what the
+// dumper exports: flat tables of integer columns, where a column may instead
+// hold the indices into a dictionary of UTF-8 strings, or variable length
+// lists of integers. A list column is sent as its int32 offsets, one more
+// than its lists, and the child column of all their items. The stream is
+//
+//   Schema, (DictionaryBatch | RecordBatch)*, end of stream marker
+//
+// and each message is a FlatBuffers encoded header followed by its body of
+// 8 byte aligned buffers. Only the little endian hosts are supported.
+class ArrowStreamWriter
+{
+  public:
+    static constexpr int64_t kNoDictionary = -1;
+
+    struct Field
+    {
+        const char* name_;
+        uint32_t bit_width_;  // of the values, or of the dictionary indices
+        bool is_signed_;
+        bool nullable_;
+        int64_t dictionary_id_;  // the UTF-8 dictionary, or kNoDictionary
+        bool is_list_;  // whether the values are lists of such integers, not encoded
+    };
+
+    // The values of a column in the record batch being built.
+    class Column
+    {
+      public:
+        Column(uint32_t byte_width, bool is_list);
+
+        template <typename T>
+        void Append(T value)
+        {
+            SetValid(true);
+            values_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        // Append a list of count items to a list column.
+        template <typename T>
+        void AppendList(const T* items, uint32_t count)
+        {
+            SetValid(true);
+            values_.append(reinterpret_cast<const char*>(items), sizeof(T) * count);
+            EndList();
+        }
+
+        void AppendNull();
+        void Clear();
+
+        uint64_t Length() const
+        {
+            return length_;
+        }
+
+      private:
+        friend class ArrowStreamWriter;
+
+        void SetValid(bool valid);
+
+        // Append the end offset of the list just appended.
+        void EndList();
+
+        const uint32_t byte_width_;
+        const bool is_list_;
+        uint64_t length_;
+        uint64_t null_count_;
+        std::string values_;  // or the items of the lists
+        std::string validity_;  // one bit per value, least significant first
+        std::string offsets_;  // of the lists in the items, starting with 0
+
+        DISALLOW_COPY_AND_ASSIGN(Column);
+    };
+
+    // The sink is not owned and must outlive the writer.
+    explicit ArrowStreamWriter(OutputSink* sink);
+
+    bool WriteSchema(const std::vector<Field>& fields) WARN_UNUSED;
+
+    // Write the strings [begin, end) as the dictionary of the given id. With
+    // is_delta, they are appended to the strings sent before.
+    bool WriteDictionary(int64_t id, const std::vector<std::string>& strings,
+                         size_t begin, size_t end, bool is_delta) WARN_UNUSED;
+
+    // Write the columns, which must be of the same length and in the schema
+    // order, as a record batch.
+    bool WriteRecordBatch(const std::vector<Column*>& columns) WARN_UNUSED;
+
+    bool WriteEnd() WARN_UNUSED;
+
+  private:
+    class FlatBufferBuilder;
+
+    // A buffer in the body of a message.
+    struct BodyBuffer
+    {
+        const char* data_;
+        uint64_t size_;
+    };
+
+    // A field node in the body of a message.
+    struct FieldNode
+    {
+        uint64_t length_;
+        uint64_t null_count_;
+    };
+
+    // Append the root Message table. Returns the slot of the offset to the
+    // header, which is appended next.
+    static size_t AddMessage(FlatBufferBuilder* fbb, uint8_t header_type,
+                             const std::vector<BodyBuffer>& buffers);
+
+    // Append the Field table of the given field, its offset going to slot.
+    static void AddField(FlatBufferBuilder* fbb, size_t slot, const Field& field);
+
+    // Append a RecordBatch table describing the given nodes and buffers.
+    static size_t AddRecordBatch(FlatBufferBuilder* fbb, uint64_t length,
+                                 const std::vector<FieldNode>& nodes,
+                                 const std::vector<BodyBuffer>& buffers);
+
+    // Write the encapsulated message: the continuation marker, the length of
+    // the padded metadata, the metadata and the padded body buffers.
+    bool WriteMessage(FlatBufferBuilder* fbb, const std::vector<BodyBuffer>& buffers);
+
+    OutputSink* sink_;
+
+    DISALLOW_COPY_AND_ASSIGN(ArrowStreamWriter);
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "async_writer.h"
+#include "log.h"
+
+
+AsyncWriter::AsyncWriter(int fd, bool own_fd, bool direct_io)
+  : fd_(fd),
+    own_fd_(own_fd),
+    direct_io_(direct_io),
+    closed_(false),
+    fill_idx_(0),
+    fill_size_(0),
+    pending_(nullptr),
+    pending_size_(0),
+    stop_(false),
+    error_(0)
+{
+    for (byte*& buffer : buffers_) {
+        void* addr = nullptr;
+        if (posix_memalign(&addr, kPageSize, kBufferSize) != 0)
+            LOG(FATAL) << "Fail to allocate the output buffer.";
+        buffer = reinterpret_cast<byte*>(addr);
+    }
+    thread_ = std::thread(&AsyncWriter::Run, this);
+}
+
+AsyncWriter::~AsyncWriter()
+{
+    if (!closed_ && !Close())
+        LOG(ERROR) << "Fail to flush the output.";
+    for (byte* buffer : buffers_)
+        free(buffer);
+}
+
+AsyncWriter* AsyncWriter::Open(const char* path, bool direct_io)
+{
+    if (path == nullptr)
+        return new AsyncWriter(STDOUT_FILENO, false, false);
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    if (direct_io)
+        flags |= O_DIRECT;
+    int fd = open(path, flags, 0644);
+    if (fd == -1 && direct_io) {
+        // Not every file system supports direct I/O.
+        PLOG(WARNING) << "Fail to open the output with O_DIRECT, fall back to buffered I/O";
+        direct_io = false;
+        fd = open(path, flags & ~O_DIRECT, 0644);
+    }
+    if (fd == -1) {
+        PLOG(ERROR) << "Fail to open the output file";
+        return nullptr;
+    }
+    return new AsyncWriter(fd, true, direct_io);
+}
+
+bool AsyncWriter::Write(const char* data, size_t size)
+{
+    CHECK(!closed_);
+    while (size > 0) {
+        size_t chunk = std::min(size, kBufferSize - fill_size_);
+        memcpy(buffers_[fill_idx_] + fill_size_, data, chunk);
+        fill_size_ += chunk;
+        data += chunk;
+        size -= chunk;
+        if (fill_size_ == kBufferSize)
+            Submit();
+    }
+    return error_ == 0;
+}
+
+bool AsyncWriter::Close()
+{
+    CHECK(!closed_);
+    closed_ = true;
+
+    // The tail is not a multiple of the block size, so it cannot be written
+    // with O_DIRECT.
+    if (direct_io_ && fill_size_ % kPageSize != 0) {
+        WaitIdle();
+        int flags = fcntl(fd_, F_GETFL);
+        if (flags == -1 || fcntl(fd_, F_SETFL, flags & ~O_DIRECT) == -1)
+            PLOG(WARNING) << "Fail to leave the direct I/O mode";
+        direct_io_ = false;
+    }
+    if (fill_size_ > 0)
+        Submit();
+
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    thread_.join();
+
+    bool success = (error_ == 0);
+    if (!success) {
+        errno = error_.load();
+        PLOG(ERROR) << "Fail to write the output";
+    }
+    if (own_fd_ && close(fd_) == -1) {
+        PLOG(ERROR) << "Fail to close the output";
+        success = false;
+    }
+    return success;
+}
+
+void AsyncWriter::Submit()
+{
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        cond_.wait(guard, [this] { return pending_ == nullptr; });
+        pending_ = buffers_[fill_idx_];
+        pending_size_ = fill_size_;
+    }
+    cond_.notify_all();
+    fill_idx_ ^= 1;
+    fill_size_ = 0;
+}
+
+void AsyncWriter::WaitIdle()
+{
+    std::unique_lock<std::mutex> guard(lock_);
+    cond_.wait(guard, [this] { return pending_ == nullptr; });
+}
+
+void AsyncWriter::Run()
+{
+    std::unique_lock<std::mutex> guard(lock_);
+    while (true) {
+        cond_.wait(guard, [this] { return pending_ != nullptr || stop_; });
+        if (pending_ == nullptr)
+            break;
+
+        const byte* data = pending_;
+        size_t size = pending_size_;
+        bool skip = (error_ != 0);
+        guard.unlock();
+        int error = (skip || WriteFully(data, size))? 0 : errno;
+        guard.lock();
+
+        if (error_ == 0)
+            error_ = error;
+        pending_ = nullptr;
+        cond_.notify_all();
+    }
+}
+
+bool AsyncWriter::WriteFully(const byte* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t count = write(fd_, data, size);
+        if (count == -1) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += count;
+        size -= count;
+    }
+    return true;
+}
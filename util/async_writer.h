@@ -0,0 +1,68 @@
+#ifndef _UTIL_ASYNC_WRITER_H_
+#define _UTIL_ASYNC_WRITER_H_
+
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+
+
+// A file sink with two large page aligned buffers. The producer fills one
+// buffer while a background thread writes the other one to the file, so the
+// formatting and the I/O overlap.
+class AsyncWriter : public OutputSink
+{
+  public:
+    static constexpr size_t kBufferSize = 8 * MB;
+
+    ~AsyncWriter();
+
+    // Create a writer for the given pathname, or for the standard output if
+    // the pathname is nullptr. With direct_io, the file is opened with
+    // O_DIRECT to bypass the page cache.
+    static AsyncWriter* Open(const char* path, bool direct_io);
+
+    bool Write(const char* data, size_t size) override WARN_UNUSED;
+    bool Close() override WARN_UNUSED;
+
+  private:
+    AsyncWriter(int fd, bool own_fd, bool direct_io);
+
+    // Hand the buffer being filled to the writer thread and switch to the
+    // other buffer once the writer thread is done with it.
+    void Submit();
+
+    // Block until the writer thread has drained its buffer.
+    void WaitIdle();
+
+    // The writer thread loop.
+    void Run();
+
+    bool WriteFully(const byte* data, size_t size);
+
+    const int fd_;
+    const bool own_fd_;
+    bool direct_io_;
+    bool closed_;
+
+    byte* buffers_[2];
+    uint32_t fill_idx_;  // the buffer owned by the producer
+    size_t fill_size_;
+
+    std::mutex lock_;
+    std::condition_variable cond_;
+    const byte* pending_;  // the buffer owned by the writer thread, if any
+    size_t pending_size_;
+    bool stop_;
+    std::atomic<int> error_;  // the errno of the first failed write, or 0
+    std::thread thread_;
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncWriter);
+};
+
+#endif
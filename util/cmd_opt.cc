@@ -1,4 +1,3 @@
-
 #include "cmd_opt.h"
 
 
@@ -7,44 +6,225 @@ static void PrintDumperUsage()
     const char *usage = \
     "Usage: dumper [options]\n"
     "    Example: dumper --granularity=instruction --input=/PATH/TO/MY/DEX --output=PATH/TO/MY/TXT\n\n"
-    "  --granularity=(class|method|instruction): For data granularity\n"
+    "  --granularity=(class|method|instruction|stats|summary|const-string|cfg|ssa|\n"
+    "    types|reflection): For data granularity\n"
     "    class      : List class names only\n"
     "    method     : List method signatures only\n"
-    "    instruction: Full dump\n\n"
-    "  --input=<classes.dex>: Specify the input dex pathname\n\n"
-    "  --output=<dump.txt>: Specify the output dump pathname\n\n";
+    "    instruction: Full dump\n"
+    "    stats      : Decode the code items into counters and histograms only,\n"
+    "                 see stats_dumper.h\n"
+    "    summary    : List one row per method from its code_item header only:\n"
+    "                 class_method_idx, dex_method_idx, access_flags, kind,\n"
+    "                 registers, ins, outs, tries, insns and signature, tab\n"
+    "                 separated, where kind is code, native or abstract\n"
+    "    const-string: List each string loaded by const-string once, with the\n"
+    "                 methods loading it, see const_string_dumper.h\n"
+    "    cfg        : List the basic blocks of each method with their dominators,\n"
+    "                 post-dominators and loop nest, see cfg_dumper.h\n"
+    "    ssa        : List the registers of each method in static single\n"
+    "                 assignment form, with the phis and the values written and\n"
+    "                 read by each instruction, see method_ssa.h\n"
+    "    types      : List the types of the registers of each method at the\n"
+    "                 blocks and as written by each instruction, see\n"
+    "                 register_types.h\n"
+    "    reflection : List the constant arguments of the invokes in the methods\n"
+    "                 calling reflection, see cfg_dumper.h\n\n"
+    "  --input=<classes.dex>: Specify the input dex pathname. Can be repeated\n"
+    "    with --call-graph, --hierarchy, --source or --ioc, for the classes*.dex\n"
+    "    of a multidex app\n\n"
+    "  --output=<dump.txt>: Specify the output dump pathname. With a .gz suffix,\n"
+    "    the dump is compressed in parallel into concatenated gzip members\n\n"
+    "  --order=(class|offset): For code item traversal order\n"
+    "    class      : Decode methods in class_def order (default)\n"
+    "    offset     : Decode methods in ascending code_off order and reassemble\n"
+    "                 the output in class_def order. Text format at the\n"
+    "                 instruction granularity only, not with --pwrite,\n"
+    "                 --shard-depth or the modes replacing the code below\n\n"
+    "  --direct-io: Write the output file with O_DIRECT to bypass the page cache\n\n"
+    "  --jobs=<N>: Specify the number of worker threads, default to the CPU count\n\n"
+    "  --pwrite: Render the classes in parallel and pwrite each of them to its\n"
+    "    final offset in the preallocated output file. Requires a plain --output\n\n"
+    "  --format=(text|binary|jsonl|arrow): For output format\n"
+    "    text       : Human readable dump (default)\n"
+    "    binary     : Sectioned records with a string dictionary, see binary_dumper.h\n"
+    "    jsonl      : One JSON object per line, see json_dumper.h\n"
+    "    arrow      : Arrow IPC streams per table, named after the --output prefix,\n"
+    "                 see arrow_dumper.h\n\n"
+    "  --index=<dump.idx>: Also write a sidecar index of the byte offset and length\n"
+    "    of every class and method section in the text dump, see dump_index.h\n\n"
+    "  --include=<glob>: Dump only the classes whose raw descriptor matches, such as\n"
+    "    'Lcom/target/*'. '*' matches any run of characters and '?' any one of them.\n"
+    "    Can be repeated\n\n"
+    "  --exclude=<glob>: Skip the classes whose raw descriptor matches. Can be repeated\n\n"
+    "  --method=<glob>: Dump only the methods whose name matches. Can be repeated\n\n"
+    "  --shard-depth=<N>: Shard the text dump by the first N package components\n"
+    "    into one file per package under the --output directory, such as\n"
+    "    com.target.txt for N=2. The shards are written in parallel\n\n"
+    "  --strings: Export the whole string table instead of the code, one\n"
+    "    string_idx and printable string per line, tab separated\n\n"
+    "  --xref=<glob>: List the references to the matching methods, fields and\n"
+    "    types instead of the code: the invokes, the instance and static field\n"
+    "    reads and writes, and the const-class and new-instance. The glob is\n"
+    "    matched against 'Lcom/a/B;->name' for the methods and fields and the\n"
+    "    raw descriptor for the types. Can be repeated\n\n"
+    "  --call-graph=<graph.cg>: Write the call graph of all the --input files\n"
+    "    instead of the code, with the methods linked across the files by class,\n"
+    "    name and signature, see call_graph.h. Takes no --output, --format,\n"
+    "    --direct-io, --pwrite, --index or --shard-depth\n\n"
+    "  --hierarchy: List the class hierarchy of all the --input files instead of\n"
+    "    the code: the preorder interval, superclass, implemented interfaces and\n"
+    "    virtual method table of every class, see class_hierarchy.h\n\n"
+    "  --source=<glob>: Run the taint analysis of all the --input files instead\n"
+    "    of the code, listing the invokes where a value returned by a matching\n"
+    "    method reaches a --sink method, directly or through the callee. The glob\n"
+    "    is matched against 'Lcom/a/B;->name(I)V'. Can be repeated, see\n"
+    "    taint_analysis.h\n\n"
+    "  --sink=<glob>: The sink methods of the taint analysis. Can be repeated\n\n"
+    "  --patterns=<rules.txt>: List the instruction sequences matching the rules\n"
+    "    of the file instead of the code, such as\n"
+    "    'cipher: const-string ...5 invoke-static:Ljavax/crypto/Cipher;->getInstance'\n"
+    "    with all the rules matched in one pass, see pattern_matcher.h\n\n"
+    "  --ioc=<iocs.txt>: List the strings of all the --input files containing\n"
+    "    an indicator of the file, one literal per line, instead of the code,\n"
+    "    each with its indicators and the const-string loading it. All the\n"
+    "    indicators are matched in one pass, see ioc_matcher.h\n\n"
+    "  The --strings, --xref, --call-graph, --hierarchy, --source, --patterns and\n"
+    "  --ioc modes exclude each other, and take no --granularity\n\n";
     std::cerr << usage;
 }
 
 
-bool ParseDumperOption(int argc, char **argv,
-                       char *opt_granu, char **opt_in, char **opt_out)
+bool ParseDumperOption(int argc, char **argv, DumperOption* opt)
 {
     struct option opts[] = {
         {kOptLongGranularity, required_argument, 0, kOptGranularity},
         {kOptLongInput, required_argument, 0, kOptInput},
         {kOptLongOutput, required_argument, 0, kOptOutput},
+        {kOptLongOrder, required_argument, 0, kOptOrder},
+        {kOptLongDirectIo, no_argument, 0, kOptDirectIo},
+        {kOptLongJobs, required_argument, 0, kOptJobs},
+        {kOptLongPwrite, no_argument, 0, kOptPwrite},
+        {kOptLongFormat, required_argument, 0, kOptFormat},
+        {kOptLongIndex, required_argument, 0, kOptIndex},
+        {kOptLongInclude, required_argument, 0, kOptInclude},
+        {kOptLongExclude, required_argument, 0, kOptExclude},
+        {kOptLongMethod, required_argument, 0, kOptMethod},
+        {kOptLongShardDepth, required_argument, 0, kOptShardDepth},
+        {kOptLongStrings, no_argument, 0, kOptStrings},
+        {kOptLongXref, required_argument, 0, kOptXref},
+        {kOptLongCallGraph, required_argument, 0, kOptCallGraph},
+        {kOptLongHierarchy, no_argument, 0, kOptHierarchy},
+        {kOptLongSource, required_argument, 0, kOptSource},
+        {kOptLongSink, required_argument, 0, kOptSink},
+        {kOptLongPatterns, required_argument, 0, kOptPatterns},
+        {kOptLongIoc, required_argument, 0, kOptIoc},
+        {0, 0, 0, 0},
     };
 
     char order[kBlahSizeTiny];
     memset(order, 0, sizeof(char) * kBlahSizeTiny);
-    sprintf(order, "%c:%c:%c:", kOptGranularity, kOptInput, kOptOutput);
+    sprintf(order, "%c:%c:%c:%c:%c%c:%c%c:%c:%c:%c:%c:%c:%c%c:%c:%c%c:%c:%c:%c:",
+            kOptGranularity, kOptInput, kOptOutput, kOptOrder, kOptDirectIo, kOptJobs,
+            kOptPwrite, kOptFormat, kOptIndex, kOptInclude, kOptExclude, kOptMethod,
+            kOptShardDepth, kOptStrings, kOptXref, kOptCallGraph, kOptHierarchy, kOptSource,
+            kOptSink, kOptPatterns, kOptIoc);
 
-    char *granu_str = nullptr;
-    *opt_in = *opt_out = nullptr;
-    int opt, idx_opt;
-    pid_t pid_zygote = 0;
-    char *sz_app = NULL, *sz_path = NULL;
-    while ((opt = getopt_long(argc, argv, order, opts, &idx_opt)) != -1) {
-        switch (opt) {
+    char *granu_str = nullptr, *order_str = nullptr, *format_str = nullptr;
+    opt->in = opt->out = opt->index = opt->call_graph = opt->patterns = opt->ioc = nullptr;
+    opt->inputs.clear();
+    opt->direct_io = false;
+    opt->jobs = 0;
+    opt->shard_depth = 0;
+    opt->strings = false;
+    opt->hierarchy = false;
+    opt->pwrite = false;
+    opt->includes.clear();
+    opt->excludes.clear();
+    opt->methods.clear();
+    opt->xrefs.clear();
+    opt->sources.clear();
+    opt->sinks.clear();
+    int opt_code, idx_opt;
+    while ((opt_code = getopt_long(argc, argv, order, opts, &idx_opt)) != -1) {
+        switch (opt_code) {
           case kOptGranularity:
             granu_str = optarg;
             break;
           case kOptInput:
-            *opt_in = optarg;
+            if (opt->in == nullptr)
+                opt->in = optarg;
+            opt->inputs.push_back(optarg);
             break;
           case kOptOutput:
-            *opt_out = optarg;
+            opt->out = optarg;
+            break;
+          case kOptOrder:
+            order_str = optarg;
+            break;
+          case kOptDirectIo:
+            opt->direct_io = true;
+            break;
+          case kOptJobs: {
+            char* end;
+            long jobs = strtol(optarg, &end, 10);
+            if (*end != '\0' || jobs <= 0) {
+                PrintDumperUsage();
+                return false;
+            }
+            opt->jobs = static_cast<uint32_t>(jobs);
+            break;
+          }
+          case kOptPwrite:
+            opt->pwrite = true;
+            break;
+          case kOptFormat:
+            format_str = optarg;
+            break;
+          case kOptIndex:
+            opt->index = optarg;
+            break;
+          case kOptInclude:
+            opt->includes.push_back(optarg);
+            break;
+          case kOptExclude:
+            opt->excludes.push_back(optarg);
+            break;
+          case kOptMethod:
+            opt->methods.push_back(optarg);
+            break;
+          case kOptShardDepth: {
+            char* end;
+            long depth = strtol(optarg, &end, 10);
+            if (*end != '\0' || depth <= 0) {
+                PrintDumperUsage();
+                return false;
+            }
+            opt->shard_depth = static_cast<uint32_t>(depth);
+            break;
+          }
+          case kOptStrings:
+            opt->strings = true;
+            break;
+          case kOptXref:
+            opt->xrefs.push_back(optarg);
+            break;
+          case kOptCallGraph:
+            opt->call_graph = optarg;
+            break;
+          case kOptHierarchy:
+            opt->hierarchy = true;
+            break;
+          case kOptSource:
+            opt->sources.push_back(optarg);
+            break;
+          case kOptSink:
+            opt->sinks.push_back(optarg);
+            break;
+          case kOptPatterns:
+            opt->patterns = optarg;
+            break;
+          case kOptIoc:
+            opt->ioc = optarg;
             break;
           default:
             PrintDumperUsage();
@@ -52,26 +232,153 @@ bool ParseDumperOption(int argc, char **argv,
         }
     }
 
-    if (*opt_in == nullptr) {
+    if (opt->in == nullptr) {
         PrintDumperUsage();
         return false;
     }
+    if (opt->sources.empty() != opt->sinks.empty()) {
+        std::cerr << "The taint analysis needs both a --source and a --sink.\n";
+        return false;
+    }
+    if (opt->inputs.size() > 1 && opt->call_graph == nullptr && !opt->hierarchy &&
+        opt->sources.empty() && opt->ioc == nullptr) {
+        std::cerr << "Only the --call-graph, --hierarchy, --source and --ioc modes take more"
+                     " than one --input.\n";
+        return false;
+    }
+    if (opt->pwrite && (opt->out == nullptr || opt->direct_io)) {
+        std::cerr << "The --pwrite mode needs an --output file and no --direct-io.\n";
+        return false;
+    }
+    uint32_t num_modes = opt->strings + !opt->xrefs.empty() + (opt->call_graph != nullptr) +
+                         opt->hierarchy + !opt->sources.empty() + (opt->patterns != nullptr) +
+                         (opt->ioc != nullptr);
+    if (num_modes > 1) {
+        std::cerr << "The --strings, --xref, --call-graph, --hierarchy, --source, --patterns"
+                     " and --ioc modes exclude each other.\n";
+        return false;
+    }
     if (granu_str == nullptr)
         granu_str = const_cast<char*>(kGranularityInstruction);
+    if (order_str == nullptr)
+        order_str = const_cast<char*>(kOrderClass);
+    if (format_str == nullptr)
+        format_str = const_cast<char*>(kFormatText);
 
     if (strcmp(granu_str, kGranularityClass) == 0)
-        *opt_granu = kGranuCodeClass;
+        opt->granu = kGranuCodeClass;
     else {
         if (strcmp(granu_str, kGranularityMethod) == 0)
-            *opt_granu = kGranuCodeMethod;
+            opt->granu = kGranuCodeMethod;
         else {
             if (strcmp(granu_str, kGranularityInstruction) == 0)
-                *opt_granu = kGranuCodeInstruction;
+                opt->granu = kGranuCodeInstruction;
+            else if (strcmp(granu_str, kGranularityStats) == 0)
+                opt->granu = kGranuCodeStats;
+            else if (strcmp(granu_str, kGranularitySummary) == 0)
+                opt->granu = kGranuCodeSummary;
+            else if (strcmp(granu_str, kGranularityConstString) == 0)
+                opt->granu = kGranuCodeConstString;
+            else if (strcmp(granu_str, kGranularityCfg) == 0)
+                opt->granu = kGranuCodeCfg;
+            else if (strcmp(granu_str, kGranularitySsa) == 0)
+                opt->granu = kGranuCodeSsa;
+            else if (strcmp(granu_str, kGranularityTypes) == 0)
+                opt->granu = kGranuCodeTypes;
+            else if (strcmp(granu_str, kGranularityReflection) == 0)
+                opt->granu = kGranuCodeReflection;
             else {
                 PrintDumperUsage();
                 return false;
             }
         }
     }
+
+    if (strcmp(order_str, kOrderClass) == 0)
+        opt->order = kOrderCodeClass;
+    else {
+        if (strcmp(order_str, kOrderOffset) == 0)
+            opt->order = kOrderCodeOffset;
+        else {
+            PrintDumperUsage();
+            return false;
+        }
+    }
+
+    if (strcmp(format_str, kFormatText) == 0)
+        opt->format = kFormatCodeText;
+    else {
+        if (strcmp(format_str, kFormatBinary) == 0)
+            opt->format = kFormatCodeBinary;
+        else if (strcmp(format_str, kFormatJsonl) == 0)
+            opt->format = kFormatCodeJsonl;
+        else if (strcmp(format_str, kFormatArrow) == 0)
+            opt->format = kFormatCodeArrow;
+        else {
+            PrintDumperUsage();
+            return false;
+        }
+    }
+    if (opt->call_graph != nullptr &&
+        (opt->out != nullptr || opt->format != kFormatCodeText || opt->direct_io ||
+         opt->pwrite || opt->index != nullptr || opt->shard_depth > 0)) {
+        std::cerr << "The --call-graph mode writes its own file, and takes no --output,"
+                     " --format, --direct-io, --pwrite, --index or --shard-depth.\n";
+        return false;
+    }
+    if (opt->order == kOrderCodeOffset &&
+        (opt->granu != kGranuCodeInstruction || opt->format != kFormatCodeText ||
+         opt->pwrite || opt->shard_depth > 0 || num_modes > 0)) {
+        std::cerr << "The offset order supports the text format at the instruction"
+                     " granularity only, and no --pwrite, --shard-depth or mode replacing"
+                     " the code.\n";
+        return false;
+    }
+    if (opt->pwrite && opt->format != kFormatCodeText) {
+        std::cerr << "The --pwrite mode supports the text format only.\n";
+        return false;
+    }
+    if (opt->index != nullptr && opt->format != kFormatCodeText) {
+        std::cerr << "The --index option supports the text format only.\n";
+        return false;
+    }
+    if (opt->shard_depth > 0 && (opt->out == nullptr || opt->format != kFormatCodeText ||
+                                 opt->pwrite || opt->index != nullptr)) {
+        std::cerr << "The --shard-depth mode needs an --output directory, the text format,"
+                     " and no --pwrite or --index.\n";
+        return false;
+    }
+    if ((opt->granu == kGranuCodeStats || opt->granu == kGranuCodeConstString ||
+         opt->granu == kGranuCodeCfg || opt->granu == kGranuCodeSsa ||
+         opt->granu == kGranuCodeTypes || opt->granu == kGranuCodeReflection) &&
+        (opt->format != kFormatCodeText || opt->pwrite || opt->index != nullptr ||
+         opt->shard_depth > 0)) {
+        std::cerr << "The stats, const-string, cfg, ssa, types and reflection granularities"
+                     " support the text format only, and no --pwrite, --index or"
+                     " --shard-depth.\n";
+        return false;
+    }
+    if (opt->granu == kGranuCodeSummary && opt->format != kFormatCodeText) {
+        std::cerr << "The summary granularity supports the text format only.\n";
+        return false;
+    }
+    if ((opt->strings || !opt->xrefs.empty() || opt->hierarchy || !opt->sources.empty() ||
+         opt->patterns != nullptr || opt->ioc != nullptr) &&
+        (opt->format != kFormatCodeText || opt->pwrite || opt->index != nullptr ||
+         opt->shard_depth > 0)) {
+        std::cerr << "The --strings, --xref, --hierarchy, --source, --patterns and --ioc modes"
+                     " support the text format only, and no --pwrite, --index or"
+                     " --shard-depth.\n";
+        return false;
+    }
+    if (num_modes > 0 && opt->granu != kGranuCodeInstruction) {
+        std::cerr << "The --strings, --xref, --call-graph, --hierarchy, --source, --patterns"
+                     " and --ioc modes take no --granularity.\n";
+        return false;
+    }
+    if (opt->format == kFormatCodeArrow && opt->out == nullptr) {
+        std::cerr << "The arrow format needs an --output prefix.\n";
+        return false;
+    }
     return true;
-}
\ No newline at end of file
+}
@@ -1,4 +1,3 @@
-
 #ifndef _UTIL_CMD_OPT_H_
 #define _UTIL_CMD_OPT_H_
 
@@ -9,20 +8,113 @@
 static const char* kOptLongGranularity      = "granularity";
 static const char* kOptLongInput            = "input";
 static const char* kOptLongOutput           = "output";
+static const char* kOptLongOrder            = "order";
+static const char* kOptLongDirectIo         = "direct-io";
+static const char* kOptLongJobs             = "jobs";
+static const char* kOptLongPwrite           = "pwrite";
+static const char* kOptLongFormat           = "format";
+static const char* kOptLongIndex            = "index";
+static const char* kOptLongInclude          = "include";
+static const char* kOptLongExclude          = "exclude";
+static const char* kOptLongMethod           = "method";
+static const char* kOptLongShardDepth       = "shard-depth";
+static const char* kOptLongStrings          = "strings";
+static const char* kOptLongXref             = "xref";
+static const char* kOptLongCallGraph        = "call-graph";
+static const char* kOptLongHierarchy        = "hierarchy";
+static const char* kOptLongSource           = "source";
+static const char* kOptLongSink             = "sink";
+static const char* kOptLongPatterns         = "patterns";
+static const char* kOptLongIoc              = "ioc";
 
 static const char kOptGranularity           = 'g';
 static const char kOptInput                 = 'i';
 static const char kOptOutput                = 'o';
+static const char kOptOrder                 = 'r';
+static const char kOptDirectIo              = 'd';
+static const char kOptJobs                  = 'j';
+static const char kOptPwrite                = 'p';
+static const char kOptFormat                = 'f';
+static const char kOptIndex                 = 'x';
+static const char kOptInclude               = 'n';
+static const char kOptExclude               = 'e';
+static const char kOptMethod                = 'm';
+static const char kOptShardDepth            = 's';
+static const char kOptStrings               = 't';
+static const char kOptXref                  = 'c';
+static const char kOptCallGraph             = 'a';
+static const char kOptHierarchy             = 'y';
+static const char kOptSource                = 'u';
+static const char kOptSink                  = 'k';
+static const char kOptPatterns              = 'q';
+static const char kOptIoc                   = 'l';
 
 static const char* kGranularityClass        = "class";
 static const char* kGranularityMethod       = "method";
 static const char* kGranularityInstruction  = "instruction";
+static const char* kGranularityStats        = "stats";
+static const char* kGranularitySummary      = "summary";
+static const char* kGranularityConstString  = "const-string";
+static const char* kGranularityCfg          = "cfg";
+static const char* kGranularitySsa          = "ssa";
+static const char* kGranularityTypes        = "types";
+static const char* kGranularityReflection   = "reflection";
 
 static const char kGranuCodeClass           = 'c';
 static const char kGranuCodeMethod          = 'm';
 static const char kGranuCodeInstruction     = 'i';
+static const char kGranuCodeStats           = 's';
+static const char kGranuCodeSummary         = 'u';
+static const char kGranuCodeConstString     = 'k';
+static const char kGranuCodeCfg             = 'g';
+static const char kGranuCodeSsa             = 'v';
+static const char kGranuCodeTypes           = 't';
+static const char kGranuCodeReflection      = 'r';
+
+static const char* kOrderClass              = "class";
+static const char* kOrderOffset             = "offset";
+
+static const char kOrderCodeClass           = 'c';
+static const char kOrderCodeOffset          = 'f';
+
+static const char* kFormatText              = "text";
+static const char* kFormatBinary            = "binary";
+static const char* kFormatJsonl             = "jsonl";
+static const char* kFormatArrow             = "arrow";
+
+static const char kFormatCodeText           = 't';
+static const char kFormatCodeBinary         = 'b';
+static const char kFormatCodeJsonl          = 'j';
+static const char kFormatCodeArrow          = 'a';
+
+
+// The parsed command line options of the dumper.
+struct DumperOption
+{
+    char granu;  // the data granularity, one of kGranuCode*
+    char order;  // the traversal order, one of kOrderCode*
+    char format;  // the output format, one of kFormatCode*
+    char* in;  // the input dex pathname
+    std::vector<const char*> inputs;  // every input dex pathname, in being the first
+    char* out;  // the output dump pathname, nullptr for stdout
+    bool direct_io;  // whether to bypass the page cache for the output
+    uint32_t jobs;  // the number of worker threads, 0 for the hardware default
+    bool pwrite;  // whether the workers pwrite the classes to the output file
+    char* index;  // the sidecar index pathname, nullptr for no index
+    std::vector<const char*> includes;  // the class descriptor globs to keep
+    std::vector<const char*> excludes;  // the class descriptor globs to drop
+    std::vector<const char*> methods;  // the method name globs to keep
+    uint32_t shard_depth;  // the package depth of the output shards, 0 for no sharding
+    bool strings;  // whether to export the string table instead of the code
+    std::vector<const char*> xrefs;  // the globs of the targets to cross reference
+    char* call_graph;  // the call graph pathname, nullptr for no call graph
+    bool hierarchy;  // whether to export the class hierarchy instead of the code
+    std::vector<const char*> sources;  // the method key globs of the taint sources
+    std::vector<const char*> sinks;  // the method key globs of the taint sinks
+    char* patterns;  // the pattern rules pathname, nullptr for no pattern search
+    char* ioc;  // the indicators pathname, nullptr for no indicator scan
+};
 
-bool ParseDumperOption(int argc, char **argv,
-                       char *opt_granu, char **opt_in, char **opt_out);
+bool ParseDumperOption(int argc, char **argv, DumperOption* opt);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,115 @@
+#include "glob_matcher.h"
+
+
+GlobMatcher::GlobMatcher()
+  : nodes_(1),
+    num_patterns_(0)
+{}
+
+void GlobMatcher::Add(const char* pattern)
+{
+    uint32_t node = 0;
+    const char* cur = pattern;
+    for ( ; *cur != '\0' && *cur != '*' && *cur != '?' ; ++cur) {
+        uint32_t child = Child(node, *cur);
+        if (child == 0) {
+            child = nodes_.size();
+            nodes_.emplace_back();
+            std::vector<std::pair<char, uint32_t>>& edges = nodes_[node].edges_;
+            edges.insert(std::upper_bound(edges.begin(), edges.end(),
+                                          std::make_pair(*cur, child)),
+                         std::make_pair(*cur, child));
+        }
+        node = child;
+    }
+
+    Node& entry = nodes_[node];
+    if (*cur == '\0') {
+        entry.match_exact_ = true;
+        entry.exact_patterns_.push_back(num_patterns_);
+    } else if (strcmp(cur, "*") == 0) {
+        entry.match_any_ = true;
+        entry.any_patterns_.push_back(num_patterns_);
+    } else {
+        entry.tails_.push_back(cur);
+        entry.tail_patterns_.push_back(num_patterns_);
+    }
+    ++num_patterns_;
+}
+
+bool GlobMatcher::Match(const char* str) const
+{
+    uint32_t node = 0;
+    const char* cur = str;
+    while (true) {
+        const Node& entry = nodes_[node];
+        if (entry.match_any_)
+            return true;
+        for (const std::string& tail : entry.tails_) {
+            if (MatchTail(tail.c_str(), cur))
+                return true;
+        }
+        if (*cur == '\0')
+            return entry.match_exact_;
+        node = Child(node, *cur);
+        if (node == 0)
+            return false;
+        ++cur;
+    }
+}
+
+void GlobMatcher::MatchAll(const char* str, std::vector<uint32_t>* patterns) const
+{
+    uint32_t node = 0;
+    const char* cur = str;
+    while (true) {
+        const Node& entry = nodes_[node];
+        patterns->insert(patterns->end(), entry.any_patterns_.begin(),
+                         entry.any_patterns_.end());
+        for (uint32_t i = 0 ; i < entry.tails_.size() ; ++i) {
+            if (MatchTail(entry.tails_[i].c_str(), cur))
+                patterns->push_back(entry.tail_patterns_[i]);
+        }
+        if (*cur == '\0') {
+            patterns->insert(patterns->end(), entry.exact_patterns_.begin(),
+                             entry.exact_patterns_.end());
+            return;
+        }
+        node = Child(node, *cur);
+        if (node == 0)
+            return;
+        ++cur;
+    }
+}
+
+uint32_t GlobMatcher::Child(uint32_t node, char ch) const
+{
+    const std::vector<std::pair<char, uint32_t>>& edges = nodes_[node].edges_;
+    auto iter = std::lower_bound(edges.begin(), edges.end(), std::make_pair(ch, 0u));
+    return (iter != edges.end() && iter->first == ch)? iter->second : 0;
+}
+
+// Match a pattern against the whole string. On a mismatch after a '*', the
+// star is retried one character further, which is linear in the string for
+// the usual patterns.
+bool GlobMatcher::MatchTail(const char* pattern, const char* str)
+{
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (*str != '\0') {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = str;
+        } else if (*pattern == '?' || *pattern == *str) {
+            ++pattern;
+            ++str;
+        } else if (star != nullptr) {
+            pattern = star + 1;
+            str = ++resume;
+        } else
+            return false;
+    }
+    while (*pattern == '*')
+        ++pattern;
+    return *pattern == '\0';
+}
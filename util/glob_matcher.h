@@ -0,0 +1,68 @@
+#ifndef _UTIL_GLOB_MATCHER_H_
+#define _UTIL_GLOB_MATCHER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+
+
+// A set of glob patterns compiled for matching many strings. The pattern
+// syntax is '*' for any run of characters and '?' for any single character.
+//
+// The literal prefix of every pattern, up to its first wildcard, is stored
+// in a trie, so a string is walked once along the prefixes it shares with
+// the patterns. Only the patterns whose prefix matched get their remainder
+// run on the rest of the string, and the common "prefix*" form matches as
+// soon as the prefix node is reached.
+class GlobMatcher
+{
+  public:
+    GlobMatcher();
+
+    void Add(const char* pattern);
+
+    bool Empty() const
+    {
+        return num_patterns_ == 0;
+    }
+
+    // Returns true if any of the patterns matches the whole string.
+    bool Match(const char* str) const;
+
+    // Append the index of every pattern matching the whole string, the
+    // patterns being numbered in the order they were added.
+    void MatchAll(const char* str, std::vector<uint32_t>* patterns) const;
+
+  private:
+    struct Node
+    {
+        Node()
+          : match_exact_(false),
+            match_any_(false)
+        {}
+
+        // The sorted (character, child) pairs.
+        std::vector<std::pair<char, uint32_t>> edges_;
+        // The remainders of the patterns whose literal prefix ends here.
+        std::vector<std::string> tails_;
+        bool match_exact_;  // a pattern is exactly the prefix
+        bool match_any_;  // a pattern is the prefix followed by '*'
+
+        // The indices of the patterns of each kind ending here.
+        std::vector<uint32_t> exact_patterns_;
+        std::vector<uint32_t> any_patterns_;
+        std::vector<uint32_t> tail_patterns_;  // parallel to tails_
+    };
+
+    // Returns the child of the given node, or 0 if there is none.
+    uint32_t Child(uint32_t node, char ch) const;
+
+    static bool MatchTail(const char* pattern, const char* str);
+
+    std::vector<Node> nodes_;
+    uint32_t num_patterns_;
+
+    DISALLOW_COPY_AND_ASSIGN(GlobMatcher);
+};
+
+#endif
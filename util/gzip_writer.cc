@@ -0,0 +1,128 @@
+#include <zlib.h>
+
+#include "gzip_writer.h"
+#include "log.h"
+
+
+// The window bits for deflate with the gzip wrapper instead of the zlib one.
+static constexpr int kGzipWindowBits = 15 + 16;
+static constexpr int kGzipMemLevel = 8;
+
+static const char* kGzipSuffix = ".gz";
+
+
+GzipWriter::GzipWriter(OutputSink* downstream, ThreadPool* pool)
+  : downstream_(downstream),
+    pool_(pool),
+    max_inflight_(pool->GetThreadCount() * 2),
+    closed_(false),
+    failed_(false),
+    fill_(new Block())
+{
+    fill_->in_.reserve(kBlockSize);
+}
+
+GzipWriter::~GzipWriter()
+{
+    if (!closed_ && !Close())
+        LOG(ERROR) << "Fail to flush the compressed output.";
+}
+
+bool GzipWriter::IsGzipPath(const char* path)
+{
+    if (path == nullptr)
+        return false;
+    size_t len = strlen(path);
+    size_t suffix_len = strlen(kGzipSuffix);
+    return len > suffix_len && strcmp(path + len - suffix_len, kGzipSuffix) == 0;
+}
+
+bool GzipWriter::Write(const char* data, size_t size)
+{
+    CHECK(!closed_);
+    while (size > 0) {
+        size_t chunk = std::min(size, kBlockSize - fill_->in_.size());
+        fill_->in_.append(data, chunk);
+        data += chunk;
+        size -= chunk;
+        if (fill_->in_.size() == kBlockSize)
+            Submit();
+    }
+    return !failed_;
+}
+
+bool GzipWriter::Close()
+{
+    CHECK(!closed_);
+    closed_ = true;
+    if (!fill_->in_.empty())
+        Submit();
+    while (!inflight_.empty())
+        Retire();
+    bool success = downstream_->Close();
+    return !failed_ && success;
+}
+
+void GzipWriter::Submit()
+{
+    while (inflight_.size() >= max_inflight_)
+        Retire();
+
+    Block* block = fill_.get();
+    block->done_ = false;
+    inflight_.push_back(std::move(fill_));
+    pool_->AddTask([this, block] {
+        bool success = Compress(block);
+        std::lock_guard<std::mutex> guard(lock_);
+        block->success_ = success;
+        block->done_ = true;
+        cond_.notify_all();
+    });
+
+    if (free_.empty())
+        fill_.reset(new Block());
+    else {
+        fill_ = std::move(free_.back());
+        free_.pop_back();
+    }
+    fill_->in_.clear();
+    fill_->in_.reserve(kBlockSize);
+}
+
+bool GzipWriter::Retire()
+{
+    std::unique_ptr<Block> block(std::move(inflight_.front()));
+    inflight_.pop_front();
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        cond_.wait(guard, [&block] { return block->done_; });
+    }
+
+    if (!block->success_) {
+        LOG(ERROR) << "Fail to compress the output block.";
+        failed_ = true;
+    }
+    if (!failed_ && !downstream_->Write(block->out_))
+        failed_ = true;
+    free_.push_back(std::move(block));
+    return !failed_;
+}
+
+bool GzipWriter::Compress(Block* block)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, kGzipWindowBits,
+                     kGzipMemLevel, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    block->out_.resize(deflateBound(&stream, block->in_.size()));
+    stream.next_in = reinterpret_cast<Bytef*>(&block->in_[0]);
+    stream.avail_in = block->in_.size();
+    stream.next_out = reinterpret_cast<Bytef*>(&block->out_[0]);
+    stream.avail_out = block->out_.size();
+    int result = deflate(&stream, Z_FINISH);
+    block->out_.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
@@ -0,0 +1,68 @@
+#ifndef _UTIL_GZIP_WRITER_H_
+#define _UTIL_GZIP_WRITER_H_
+
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+#include "thread_pool.h"
+
+
+// A sink compressing fixed size blocks concurrently on a thread pool. Each
+// block becomes an independent gzip member, and the members are forwarded to
+// the downstream sink in order. A concatenation of gzip members is a valid
+// gzip file, so the output can be read by the standard tools.
+class GzipWriter : public OutputSink
+{
+  public:
+    static constexpr size_t kBlockSize = 1 * MB;
+
+    // The writer owns the downstream sink and borrows the pool. The number
+    // of blocks in flight is bounded by twice the pool size.
+    GzipWriter(OutputSink* downstream, ThreadPool* pool);
+    ~GzipWriter();
+
+    // Returns true if the pathname asks for the compressed output.
+    static bool IsGzipPath(const char* path);
+
+    bool Write(const char* data, size_t size) override WARN_UNUSED;
+    bool Close() override WARN_UNUSED;
+
+  private:
+    struct Block
+    {
+        std::string in_;
+        std::string out_;
+        bool done_;
+        bool success_;
+    };
+
+    // Hand the block being filled to the pool.
+    void Submit();
+
+    // Wait for the oldest block in flight and forward it downstream.
+    bool Retire();
+
+    static bool Compress(Block* block);
+
+    std::unique_ptr<OutputSink> downstream_;
+    ThreadPool* pool_;
+    const size_t max_inflight_;
+    bool closed_;
+    bool failed_;
+
+    std::unique_ptr<Block> fill_;
+    std::deque<std::unique_ptr<Block>> inflight_;
+    std::vector<std::unique_ptr<Block>> free_;
+
+    std::mutex lock_;
+    std::condition_variable cond_;
+
+    DISALLOW_COPY_AND_ASSIGN(GzipWriter);
+};
+
+#endif
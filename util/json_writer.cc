@@ -0,0 +1,183 @@
+#include "json_writer.h"
+#include "utf-inl.h"
+
+
+// The escape of each byte: 0 for the bytes copied as is, the letter of the
+// short escape sequence, 'u' for the \u00XX form, or 'm' for the lead bytes
+// of the modified UTF-8 sequences that are not valid UTF-8.
+static const char* BuildEscapeTable()
+{
+    static char table[256];
+    for (uint32_t ch = 0 ; ch < 0x20 ; ++ch)
+        table[ch] = 'u';
+    table['\b'] = 'b';
+    table['\f'] = 'f';
+    table['\n'] = 'n';
+    table['\r'] = 'r';
+    table['\t'] = 't';
+    table['"'] = '"';
+    table['\\'] = '\\';
+    table[0xC0] = 'm';
+    table[0xED] = 'm';
+    return table;
+}
+
+static const char* const kEscapeTable = BuildEscapeTable();
+
+// Returns the length of the modified UTF-8 NUL or surrogate at the given lead
+// byte, or 0 if the sequence is valid UTF-8.
+static size_t ModifiedUtf8Length(const char* cur, const char* end)
+{
+    if (static_cast<uint8_t>(cur[0]) == 0xC0)
+        return (end - cur >= 2 && static_cast<uint8_t>(cur[1]) == 0x80)? 2 : 0;
+    return (end - cur >= 3 && (static_cast<uint8_t>(cur[1]) & 0xE0) == 0xA0)? 3 : 0;
+}
+
+// The longest decimal form of a 64 bit unsigned integer.
+static constexpr size_t kMaxIntegerLength = 20;
+
+
+JsonLinesWriter::JsonLinesWriter(OutputSink* sink)
+  : sink_(sink),
+    failed_(false),
+    first_member_(true),
+    pos_(0)
+{}
+
+void JsonLinesWriter::BeginRecord()
+{
+    Append('{');
+    first_member_ = true;
+}
+
+void JsonLinesWriter::EndRecord()
+{
+    Reserve(2);
+    buffer_[pos_++] = '}';
+    buffer_[pos_++] = '\n';
+}
+
+void JsonLinesWriter::AddUint(const char* key, uint64_t value)
+{
+    AddKey(key);
+    AppendDecimal(value);
+}
+
+void JsonLinesWriter::AddInt(const char* key, int64_t value)
+{
+    AddKey(key);
+    if (value >= 0) {
+        AppendDecimal(value);
+        return;
+    }
+    // Negate in the unsigned domain so that INT64_MIN does not overflow.
+    Append('-');
+    AppendDecimal(~static_cast<uint64_t>(value) + 1);
+}
+
+void JsonLinesWriter::AddUintArray(const char* key, const uint32_t* values, size_t count)
+{
+    AddKey(key);
+    Append('[');
+    for (size_t i = 0 ; i < count ; ++i) {
+        if (i > 0)
+            Append(',');
+        AppendDecimal(values[i]);
+    }
+    Append(']');
+}
+
+void JsonLinesWriter::AddString(const char* key, const char* str, size_t len)
+{
+    AddKey(key);
+    Append('"');
+    AddEscaped(str, len);
+    Append('"');
+}
+
+bool JsonLinesWriter::Flush()
+{
+    Drain();
+    return !failed_;
+}
+
+void JsonLinesWriter::AddKey(const char* key)
+{
+    if (!first_member_)
+        Append(',');
+    first_member_ = false;
+    Append('"');
+    Append(key, strlen(key));
+    Append('"');
+    Append(':');
+}
+
+void JsonLinesWriter::AddEscaped(const char* str, size_t len)
+{
+    static const char kHexDigits[] = "0123456789abcdef";
+    const char* run = str;
+    const char* end = str + len;
+    for (const char* cur = str ; cur < end ; ++cur) {
+        char escape = kEscapeTable[static_cast<uint8_t>(*cur)];
+        if (LIKELY(escape == 0))
+            continue;
+        size_t size = 1;
+        uint16_t unit = static_cast<uint8_t>(*cur);
+        if (escape == 'm') {
+            // The two byte NUL and the surrogates of modified UTF-8 are
+            // written as \uXXXX, so a supplementary character becomes the
+            // escapes of its surrogate pair.
+            size = ModifiedUtf8Length(cur, end);
+            if (size == 0)
+                continue;
+            const char* next = cur;
+            unit = GetUtf16FromUtf8(&next);
+            escape = 'u';
+        }
+        Append(run, cur - run);
+        cur += size - 1;
+        run = cur + 1;
+        Reserve(6);
+        buffer_[pos_++] = '\\';
+        buffer_[pos_++] = escape;
+        if (escape == 'u') {
+            buffer_[pos_++] = kHexDigits[unit >> 12];
+            buffer_[pos_++] = kHexDigits[(unit >> 8) & 0xf];
+            buffer_[pos_++] = kHexDigits[(unit >> 4) & 0xf];
+            buffer_[pos_++] = kHexDigits[unit & 0xf];
+        }
+    }
+    Append(run, end - run);
+}
+
+void JsonLinesWriter::AppendDecimal(uint64_t value)
+{
+    char digits[kMaxIntegerLength];
+    char* end = digits + kMaxIntegerLength;
+    char* begin = end;
+    do {
+        *--begin = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    Append(begin, end - begin);
+}
+
+void JsonLinesWriter::Append(const char* data, size_t size)
+{
+    while (size > 0) {
+        if (pos_ == kBufferSize)
+            Drain();
+        size_t count = std::min(size, kBufferSize - pos_);
+        memcpy(buffer_ + pos_, data, count);
+        pos_ += count;
+        data += count;
+        size -= count;
+    }
+}
+
+void JsonLinesWriter::Drain()
+{
+    if (pos_ > 0 && !failed_ && !sink_->Write(buffer_, pos_))
+        failed_ = true;
+    pos_ = 0;
+}
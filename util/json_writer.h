@@ -0,0 +1,75 @@
+#ifndef _UTIL_JSON_WRITER_H_
+#define _UTIL_JSON_WRITER_H_
+
+
+#include "globals.h"
+#include "macros.h"
+#include "output_sink.h"
+
+
+// A streaming JSON Lines writer. Each record is a flat JSON object on its own
+// line. The keys, the escaped strings and the formatted integers are copied
+// straight into a fixed buffer which is handed to the sink when it fills up,
+// so writing a record never touches the heap.
+class JsonLinesWriter
+{
+  public:
+    static constexpr size_t kBufferSize = 64 * KB;
+
+    // The sink is not owned and must outlive the writer.
+    explicit JsonLinesWriter(OutputSink* sink);
+
+    void BeginRecord();
+    void EndRecord();
+
+    // Append a member to the current record. The key is written verbatim and
+    // must not need escaping. The strings are modified UTF-8, as in the dex
+    // files: their NULs and surrogates are written as \uXXXX escapes, so the
+    // records stay valid UTF-8.
+    void AddUint(const char* key, uint64_t value);
+    void AddInt(const char* key, int64_t value);
+    void AddUintArray(const char* key, const uint32_t* values, size_t count);
+    void AddString(const char* key, const char* str, size_t len);
+    void AddString(const char* key, const char* str)
+    {
+        AddString(key, str, strlen(str));
+    }
+    void AddString(const char* key, const std::string& str)
+    {
+        AddString(key, str.data(), str.size());
+    }
+
+    // Hand the buffered records to the sink. Returns false if any write
+    // failed since the writer was created.
+    bool Flush() WARN_UNUSED;
+
+  private:
+    void AddKey(const char* key);
+    void AddEscaped(const char* str, size_t len);
+    void AppendDecimal(uint64_t value);
+    void Append(const char* data, size_t size);
+    void Append(char ch)
+    {
+        if (UNLIKELY(pos_ == kBufferSize))
+            Drain();
+        buffer_[pos_++] = ch;
+    }
+
+    // Make room for at least the given number of bytes.
+    void Reserve(size_t size)
+    {
+        if (UNLIKELY(pos_ + size > kBufferSize))
+            Drain();
+    }
+    void Drain();
+
+    OutputSink* sink_;
+    bool failed_;
+    bool first_member_;
+    size_t pos_;
+    char buffer_[kBufferSize];
+
+    DISALLOW_COPY_AND_ASSIGN(JsonLinesWriter);
+};
+
+#endif
@@ -1,4 +1,8 @@
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "globals.h"
 #include "stringprintf.h"
 #include "misc.h"
@@ -7,29 +11,79 @@
 #include "utf-inl.h"
 
 
+// Returns whether the byte is a printable ASCII character copied as is.
+static inline bool IsVerbatimAscii(char ch)
+{
+    return ch >= ' ' && ch <= '~' && ch != '\\';
+}
+
+// Returns the first byte from p that is not copied as is: the terminating
+// NUL, the lead byte of a multi-byte character, a control character or a
+// backslash. The SSE2 path checks 16 bytes at a time, and falls back to single
+// bytes near a page end, since the bytes past the NUL may not be mapped.
+static inline const char* SkipVerbatimAscii(const char* p)
+{
+#if defined(__SSE2__)
+    const __m128i below = _mm_set1_epi8(' ' - 1);
+    const __m128i above = _mm_set1_epi8('~' + 1);
+    const __m128i backslash = _mm_set1_epi8('\\');
+#endif
+    while (true) {
+#if defined(__SSE2__)
+        if ((reinterpret_cast<uintptr_t>(p) & (kPageSize - 1)) <= kPageSize - 16) {
+            // The comparisons are signed, so the non-ASCII bytes fall below.
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i verbatim = _mm_and_si128(_mm_cmpgt_epi8(chunk, below),
+                                             _mm_cmplt_epi8(chunk, above));
+            verbatim = _mm_andnot_si128(_mm_cmpeq_epi8(chunk, backslash), verbatim);
+            uint32_t stops = ~_mm_movemask_epi8(verbatim) & 0xFFFF;
+            if (stops != 0)
+                return p + __builtin_ctz(stops);
+            p += 16;
+            continue;
+        }
+#endif
+        if (!IsVerbatimAscii(*p))
+            return p;
+        ++p;
+    }
+}
+
 std::string PrintableString(const char* utf)
 {
     std::string result;
-    result += '"';
-    const char* p = utf;
-    size_t char_count = CountModifiedUtf8Chars(p);
-    for (size_t i = 0; i < char_count; ++i) {
+    AppendPrintableString(&result, utf);
+    return result;
+}
+
+void AppendPrintableString(std::string* out, const char* utf8)
+{
+    *out += '"';
+    const char* p = utf8;
+    while (true) {
+        // Copy the plain ASCII runs in bulk and decode the rest one character
+        // at a time. Like CountModifiedUtf8Chars(), only a NUL at a character
+        // boundary ends the string.
+        const char* run = SkipVerbatimAscii(p);
+        out->append(p, run - p);
+        p = run;
+        if (*p == '\0')
+            break;
         uint16_t ch = GetUtf16FromUtf8(&p);
         if (ch == '\\')
-            result += "\\\\";
+            *out += "\\\\";
         else if (ch == '\n')
-            result += "\\n";
+            *out += "\\n";
         else if (ch == '\r')
-            result += "\\r";
+            *out += "\\r";
         else if (ch == '\t')
-            result += "\\t";
+            *out += "\\t";
         else if (NeedsEscaping(ch))
-            StringAppendF(&result, "\\u%04x", ch);
+            StringAppendF(out, "\\u%04x", ch);
         else
-            result += ch;
+            *out += ch;
     }
-    result += '"';
-    return result;
+    *out += '"';
 }
 
 std::string PrettyDescriptor(const char* descriptor)
@@ -18,6 +18,10 @@ static inline bool NeedsEscaping(uint16_t ch)
 // Java escapes are used for non-ASCII characters.
 std::string PrintableString(const char* utf8);
 
+// Append the quoted printable form of the given modified UTF-8 string, the
+// same as PrintableString() returns.
+void AppendPrintableString(std::string* out, const char* utf8);
+
 // Used to implement PrettyClass, PrettyField, PrettyMethod, and PrettyTypeOf,
 // one of which is probably more useful to you.
 // Returns a human-readable equivalent of 'descriptor'. So "I" would be "int",
@@ -42,5 +46,41 @@ std::string PrettyClass(uint32_t class_def_idx, const DexFile& dex_file);
 // Example outputs: char[], java.lang.String.
 std::string PrettyType(uint32_t type_idx, const DexFile& dex_file);
 
+// Bucket the (key, item) pairs of the given lists by key into compressed
+// sparse rows: the items of key k end up in items[offsets[k]] to
+// items[offsets[k + 1] - 1], in the order of the lists and of the pairs in
+// each list, and offsets has num_keys + 1 entries. The lists collected by the
+// chunks of a parallel scan are thus bucketed without being concatenated.
+template <typename T>
+void Bucket(const std::vector<std::pair<uint32_t, T>>* lists, size_t num_lists,
+            uint32_t num_keys, std::vector<uint32_t>* offsets, std::vector<T>* items)
+{
+    // Scattering moves each offset to the end of its row, which is the start
+    // of the next row, so the offsets are shifted back afterwards.
+    std::vector<uint32_t>& offset = *offsets;
+    offset.assign(num_keys + 1, 0);
+    for (size_t list = 0 ; list < num_lists ; ++list) {
+        for (const auto& pair : lists[list])
+            ++offset[pair.first + 1];
+    }
+    for (uint32_t key = 0 ; key < num_keys ; ++key)
+        offset[key + 1] += offset[key];
+    items->resize(offset[num_keys]);
+    for (size_t list = 0 ; list < num_lists ; ++list) {
+        for (const auto& pair : lists[list])
+            (*items)[offset[pair.first]++] = pair.second;
+    }
+    for (uint32_t key = num_keys ; key > 0 ; --key)
+        offset[key] = offset[key - 1];
+    offset[0] = 0;
+}
+
+template <typename T>
+void Bucket(const std::vector<std::pair<uint32_t, T>>& pairs, uint32_t num_keys,
+            std::vector<uint32_t>* offsets, std::vector<T>* items)
+{
+    Bucket(&pairs, 1, num_keys, offsets, items);
+}
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef _UTIL_OUTPUT_SINK_H_
+#define _UTIL_OUTPUT_SINK_H_
+
+
+#include "globals.h"
+#include "macros.h"
+
+
+// The destination of the dumped text. A sink buffers what it is given and
+// reports failures lazily, so a failed Write() may surface only on Close().
+class OutputSink
+{
+  public:
+    OutputSink()
+    {}
+
+    virtual ~OutputSink()
+    {}
+
+    // Append the given bytes to the sink.
+    virtual bool Write(const char* data, size_t size) WARN_UNUSED = 0;
+
+    // Flush all the buffered bytes and release the underlying resources.
+    virtual bool Close() WARN_UNUSED = 0;
+
+    bool Write(const std::string& str) WARN_UNUSED
+    {
+        return Write(str.data(), str.size());
+    }
+
+  private:
+    DISALLOW_COPY_AND_ASSIGN(OutputSink);
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef _UTIL_RANGE_H_
+#define _UTIL_RANGE_H_
+
+
+#include "globals.h"
+
+
+// A view of the elements [begin, end) of an array, such as a row of a table
+// stored as the concatenated rows and their offsets.
+template <typename T>
+class Range
+{
+  public:
+    Range(const T* begin, const T* end)
+      : begin_(begin),
+        end_(end)
+    {}
+
+    const T* begin() const
+    {
+        return begin_;
+    }
+
+    const T* end() const
+    {
+        return end_;
+    }
+
+    uint32_t size() const
+    {
+        return end_ - begin_;
+    }
+
+  private:
+    const T* begin_;
+    const T* end_;
+};
+
+#endif
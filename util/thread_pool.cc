@@ -0,0 +1,111 @@
+#include <atomic>
+
+#include "thread_pool.h"
+#include "log.h"
+
+
+ThreadPool::ThreadPool(uint32_t num_threads)
+  : num_busy_(0),
+    stop_(false)
+{
+    CHECK_GT(num_threads, 0U);
+    for (uint32_t i = 0 ; i < num_threads ; ++i)
+        threads_.emplace_back(&ThreadPool::Run, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stop_ = true;
+    }
+    task_cond_.notify_all();
+    for (std::thread& thread : threads_)
+        thread.join();
+}
+
+void ThreadPool::AddTask(Task task)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        tasks_.push_back(std::move(task));
+    }
+    task_cond_.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> guard(lock_);
+    idle_cond_.wait(guard, [this] { return tasks_.empty() && num_busy_ == 0; });
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+{
+    std::atomic<uint32_t> next(0);
+    std::mutex done_lock;
+    std::condition_variable done_cond;
+    uint32_t num_done = 0;
+
+    uint32_t num_workers = std::min<uint32_t>(count, GetThreadCount());
+    for (uint32_t i = 0 ; i < num_workers ; ++i) {
+        AddTask([&] {
+            uint32_t idx;
+            while ((idx = next++) < count)
+                func(idx);
+            std::lock_guard<std::mutex> guard(done_lock);
+            ++num_done;
+            done_cond.notify_all();
+        });
+    }
+
+    // Only wait for the tasks of this loop, the pool may be shared.
+    std::unique_lock<std::mutex> guard(done_lock);
+    done_cond.wait(guard, [&] { return num_done == num_workers; });
+}
+
+uint32_t ThreadPool::NumChunkWorkers(uint32_t count, uint32_t chunk_size) const
+{
+    uint32_t num_chunks = (count + chunk_size - 1) / chunk_size;
+    return std::max<uint32_t>(1, std::min(num_chunks, GetThreadCount()));
+}
+
+void ThreadPool::ParallelForChunks(uint32_t begin, uint32_t end, uint32_t chunk_size,
+                                   const ChunkFunc& func)
+{
+    uint32_t count = end - begin;
+    uint32_t num_chunks = (count + chunk_size - 1) / chunk_size;
+    std::atomic<uint32_t> next_chunk(0);
+    ParallelFor(NumChunkWorkers(count, chunk_size), [&](uint32_t worker) {
+        uint32_t chunk;
+        while ((chunk = next_chunk++) < num_chunks) {
+            uint32_t chunk_begin = begin + chunk * chunk_size;
+            func(worker, chunk, chunk_begin, std::min(chunk_begin + chunk_size, end));
+        }
+    });
+}
+
+uint32_t ThreadPool::GetDefaultThreadCount()
+{
+    uint32_t count = std::thread::hardware_concurrency();
+    return (count > 0)? count : 1;
+}
+
+void ThreadPool::Run()
+{
+    std::unique_lock<std::mutex> guard(lock_);
+    while (true) {
+        task_cond_.wait(guard, [this] { return !tasks_.empty() || stop_; });
+        if (tasks_.empty())
+            break;
+
+        Task task(std::move(tasks_.front()));
+        tasks_.pop_front();
+        ++num_busy_;
+        guard.unlock();
+        task();
+        guard.lock();
+        --num_busy_;
+        if (tasks_.empty() && num_busy_ == 0)
+            idle_cond_.notify_all();
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef _UTIL_THREAD_POOL_H_
+#define _UTIL_THREAD_POOL_H_
+
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+
+#include "globals.h"
+#include "macros.h"
+
+
+// The number of class defs in a chunk handed to a worker, and of ids, such
+// as string_ids or method_ids, which are much cheaper each.
+static constexpr uint32_t kClassChunkSize = 64;
+static constexpr uint32_t kIdChunkSize = 4096;
+
+// The number of chunks per worker rendered in a round, when the output of
+// the chunks is held until written in order.
+static constexpr uint32_t kChunksPerWorker = 4;
+
+// A fixed set of worker threads consuming tasks in FIFO order.
+class ThreadPool
+{
+  public:
+    typedef std::function<void()> Task;
+
+    // Called with the worker, the chunk counted from the start of the range,
+    // and the range of the chunk.
+    typedef std::function<void(uint32_t, uint32_t, uint32_t, uint32_t)> ChunkFunc;
+
+    explicit ThreadPool(uint32_t num_threads);
+
+    // Finish the queued tasks and join the workers.
+    ~ThreadPool();
+
+    uint32_t GetThreadCount() const
+    {
+        return threads_.size();
+    }
+
+    void AddTask(Task task);
+
+    // Block until every task added so far has completed.
+    void Wait();
+
+    // Run func(idx) for each idx in [0, count) on the workers and block until
+    // all of them have completed. The indices are handed out dynamically, so
+    // uneven work items balance across the workers. Must not be called from
+    // a task of the same pool.
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+    // Returns the number of workers ParallelForChunks() uses for count
+    // indices, at least 1, to size the state kept by each of them.
+    uint32_t NumChunkWorkers(uint32_t count, uint32_t chunk_size) const;
+
+    // Split [begin, end) into chunks of chunk_size indices, and run
+    // func(worker, chunk, chunk_begin, chunk_end) for each of them on the
+    // workers, blocking until all of them have completed. Each worker pulls
+    // the chunks in order with its own index below NumChunkWorkers(), so the
+    // state it keeps by this index is never shared.
+    void ParallelForChunks(uint32_t begin, uint32_t end, uint32_t chunk_size,
+                           const ChunkFunc& func);
+
+    // Returns the number of hardware threads, at least 1.
+    static uint32_t GetDefaultThreadCount();
+
+  private:
+    void Run();
+
+    std::vector<std::thread> threads_;
+    std::deque<Task> tasks_;
+    std::mutex lock_;
+    std::condition_variable task_cond_;
+    std::condition_variable idle_cond_;
+    uint32_t num_busy_;
+    bool stop_;
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+#endif
@@ -59,3 +59,42 @@ void ConvertUtf16ToModifiedUtf8(char* utf8_out, const uint16_t* utf16_in,
         }
     }
 }
+
+void ConvertModifiedUtf8ToUtf8(std::string* utf8_out, const char* utf8_in, size_t byte_count)
+{
+    // Only the lead bytes C0 and ED start the sequences to rewrite, and they
+    // are never continuation bytes, so the rest is copied in runs.
+    const char* end = utf8_in + byte_count;
+    const char* run = utf8_in;
+    const char* cur = utf8_in;
+    while (cur < end) {
+        uint8_t one = *cur;
+        if (one == 0xc0 && end - cur >= 2 && static_cast<uint8_t>(cur[1]) == 0x80) {
+            utf8_out->append(run, cur - run);
+            utf8_out->push_back('\0');
+            cur += 2;
+            run = cur;
+            continue;
+        }
+        if (one != 0xed || end - cur < 3 || (static_cast<uint8_t>(cur[1]) & 0xe0) != 0xa0) {
+            ++cur;
+            continue;
+        }
+        utf8_out->append(run, cur - run);
+        uint16_t high = GetUtf16FromUtf8(&cur);
+        uint32_t code_point = 0xfffd;
+        if (high < 0xdc00 && end - cur >= 3 && static_cast<uint8_t>(cur[0]) == 0xed &&
+            (static_cast<uint8_t>(cur[1]) & 0xf0) == 0xb0) {
+            uint16_t low = GetUtf16FromUtf8(&cur);
+            code_point = 0x10000 + ((high - 0xd800) << 10) + (low - 0xdc00);
+            utf8_out->push_back((code_point >> 18) | 0xf0);
+            utf8_out->push_back(((code_point >> 12) & 0x3f) | 0x80);
+        } else {
+            utf8_out->push_back((code_point >> 12) | 0xe0);
+        }
+        utf8_out->push_back(((code_point >> 6) & 0x3f) | 0x80);
+        utf8_out->push_back((code_point & 0x3f) | 0x80);
+        run = cur;
+    }
+    utf8_out->append(run, end - run);
+}
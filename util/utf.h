@@ -55,4 +55,12 @@ uint16_t GetUtf16FromUtf8(const char** utf8_data_in);
  */
 void ConvertUtf16ToModifiedUtf8(char* utf8_out, const uint16_t* utf16_in, size_t char_count);
 
+/*
+ * Append the standard UTF-8 form of a Modified UTF-8 string of the given
+ * length. The two-byte NUL becomes a single byte and each surrogate pair a
+ * four-byte sequence. An unpaired surrogate, which has no UTF-8 form, becomes
+ * U+FFFD.
+ */
+void ConvertModifiedUtf8ToUtf8(std::string* utf8_out, const char* utf8_in, size_t byte_count);
+
 #endif
\ No newline at end of file